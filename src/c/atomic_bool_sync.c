@@ -3,18 +3,21 @@
   @author  Melwin Svensson.
   @date    6-4-2025.
 
+  Note that this used the legacy `__sync` builtins, where even a plain get was a full barrier.  Now a get is an acquire
+  load, and a set is a release store.
+
  */
 #include "../include/proto.h"
 
 
 int atomic_bool_sync_get(atomic_bool_sync *const b) {
-  return __sync_fetch_and_add(&b->value, 0);
+  return __atomic_load_n(&b->value, __ATOMIC_ACQUIRE);
 }
 
 void atomic_bool_sync_set_true(atomic_bool_sync *const b) {
-  __sync_lock_test_and_set(&b->value, TRUE);
+  __atomic_store_n(&b->value, TRUE, __ATOMIC_RELEASE);
 }
 
 void atomic_bool_sync_set_false(atomic_bool_sync *const b) {
-  __sync_lock_test_and_set(&b->value, FALSE);
+  __atomic_store_n(&b->value, FALSE, __ATOMIC_RELEASE);
 }
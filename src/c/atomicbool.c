@@ -3,21 +3,23 @@
   @author  Melwin Svensson.
   @date    7-4-2025.
 
+  Heap allocated atomic bool.  This used to guard a plain int with a mutex, now it's an `aflag_t`, so a get is a single
+  acquire load and a set a single release store.  New code should use `aflag_t` directly.
+
  */
 #include "../include/proto.h"
+#include "../include/statics.h"
 
 #if !__WIN__
 
 struct atomicbool {
-  mutex_t mutex;
-  int value;
+  aflag_t flag;
 };
 
 
 atomicbool *atomicbool_create(void) {
   atomicbool *ab = xmalloc(sizeof(*ab));
-  mutex_init(&ab->mutex, NULL);
-  ab->value = FALSE;
+  ab->flag.value = FALSE;
   return ab;
 }
 
@@ -25,31 +27,22 @@ void atomicbool_free(atomicbool *ab) {
   if (!ab) {
     return;
   }
-  mutex_destroy(&ab->mutex);
   free(ab);
 }
 
 bool atomicbool_get(atomicbool *ab) {
   ASSERT(ab);
-  bool ret;
-  mutex_action(&ab->mutex,
-    ret = ab->value;
-  );
-  return ret;
+  return aflag_get(&ab->flag);
 }
 
 void atomicbool_set_true(atomicbool *ab) {
   ASSERT(ab);
-  mutex_action(&ab->mutex,
-    ab->value = TRUE;
-  );
+  aflag_set(&ab->flag);
 }
 
 void atomicbool_set_false(atomicbool *ab) {
   ASSERT(ab);
-  mutex_action(&ab->mutex,
-    ab->value = FALSE;
-  );
+  aflag_clear(&ab->flag);
 }
 
 #endif
\ No newline at end of file
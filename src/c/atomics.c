@@ -0,0 +1,214 @@
+/** @file atomics.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Blocking primitives on top of the typed atomics in `statics.h`.
+
+  `atomic_wait()` and `atomic_notify_*()` park and wake threads on a single 32-bit word, like C++'s `std::atomic::wait`.
+  On top of them, `event_t` is a one-shot (resettable) flag that threads can wait for, `latch_t` a countdown that
+  releases all waiters when it hits zero, and `barrier_t` a reusable rendezvous of a fixed number of threads.  None of
+  them enter the kernel unless someone actually has to wait, or has to be woken.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+#include "../include/statics.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+#define EVENT_UNSET   (0)
+#define EVENT_SET     (1)
+#define EVENT_PARKED  (2)
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* Wait on `addr` while it holds `old`, until `deadline` (in `hiactime_now_ns()` time) when it's not negative.  Return's
+ * `FALSE` only when the deadline passed. */
+static bool atomic_wait_until(Uint *const addr, Uint old, Llong deadline) {
+  struct timespec ts;
+  Llong left;
+  if (deadline < 0) {
+    futex_wait(addr, old, NULL);
+    return TRUE;
+  }
+  if ((left = (deadline - hiactime_now_ns())) <= 0) {
+    return FALSE;
+  }
+  ts.tv_sec  = (left / 1000000000LL);
+  ts.tv_nsec = (left % 1000000000LL);
+  futex_wait(addr, old, &ts);
+  return TRUE;
+}
+
+/* Return's the deadline for `timeout_ns` from now, or `-1` when `timeout_ns` is negative, meaning no timeout. */
+static inline Llong atomic_deadline(Llong timeout_ns) {
+  return ((timeout_ns < 0) ? -1 : (hiactime_now_ns() + timeout_ns));
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Wait/notify ----------------------------- */
+
+/* Block for as long as `*addr` holds `old`, or `timeout_ns` expires when it's not negative.  Return's `FALSE` when it
+ * timed out, and `TRUE` when the value changed.  Note that waiters are only woken by `atomic_notify_*()`, a plain
+ * store does not wake anyone. */
+bool atomic_wait(Uint *const addr, Uint old, Llong timeout_ns) {
+  ASSERT(addr);
+  Llong deadline = atomic_deadline(timeout_ns);
+  while (__atomic_load_n(addr, __ATOMIC_ACQUIRE) == old) {
+    if (!atomic_wait_until(addr, old, deadline)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/* Wake one thread blocked in `atomic_wait()` on `addr`. */
+void atomic_notify_one(Uint *const addr) {
+  ASSERT(addr);
+  futex_wake(addr, 1);
+}
+
+/* Wake all threads blocked in `atomic_wait()` on `addr`. */
+void atomic_notify_all(Uint *const addr) {
+  ASSERT(addr);
+  futex_wake(addr, INT_MAX);
+}
+
+/* ----------------------------- Event ----------------------------- */
+
+void event_init(event_t *const e) {
+  ASSERT(e);
+  e->state = EVENT_UNSET;
+}
+
+/* Set `e` and release everyone waiting for it.  Only makes a syscall when someone is waiting. */
+void event_set(event_t *const e) {
+  ASSERT(e);
+  if (__atomic_exchange_n(&e->state, EVENT_SET, __ATOMIC_RELEASE) == EVENT_PARKED) {
+    futex_wake(&e->state, INT_MAX);
+  }
+}
+
+/* Unset `e`, so it can be waited for again.  Note that this must not race with `event_set()`. */
+void event_reset(event_t *const e) {
+  ASSERT(e);
+  Uint expected = EVENT_SET;
+  __atomic_compare_exchange_n(&e->state, &expected, EVENT_UNSET, FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+bool event_is_set(event_t *const e) {
+  ASSERT(e);
+  return (__atomic_load_n(&e->state, __ATOMIC_ACQUIRE) == EVENT_SET);
+}
+
+/* Wait until `e` is set, or `timeout_ns` expires when it's not negative.  Return's `TRUE` when the event was set. */
+bool event_wait(event_t *const e, Llong timeout_ns) {
+  ASSERT(e);
+  Llong deadline;
+  Uint state;
+  if (__atomic_load_n(&e->state, __ATOMIC_ACQUIRE) == EVENT_SET) {
+    return TRUE;
+  }
+  deadline = atomic_deadline(timeout_ns);
+  while ((state = __atomic_load_n(&e->state, __ATOMIC_ACQUIRE)) != EVENT_SET) {
+    /* Tell the setter it has to wake someone, unless it just did set it. */
+    if (state == EVENT_UNSET && !__atomic_compare_exchange_n(&e->state, &state, EVENT_PARKED, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+      continue;
+    }
+    if (!atomic_wait_until(&e->state, EVENT_PARKED, deadline)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/* ----------------------------- Latch ----------------------------- */
+
+/* Init `l` to release its waiters after `count` calls to `latch_count_down()`. */
+void latch_init(latch_t *const l, Uint count) {
+  ASSERT(l);
+  l->count   = count;
+  l->waiters = 0;
+}
+
+/* Count `l` down by `n`, releasing all waiters when it reaches zero. */
+void latch_count_down(latch_t *const l, Uint n) {
+  ASSERT(l);
+  Uint count = __atomic_sub_fetch(&l->count, n, __ATOMIC_SEQ_CST);
+  ALWAYS_ASSERT_MSG(((Uint)(count + n) >= n), "latch counted down below zero");
+  /* Both this and `latch_wait()` are sequentially consistent, so either we see the waiter, or it sees zero. */
+  if (!count && __atomic_load_n(&l->waiters, __ATOMIC_SEQ_CST)) {
+    futex_wake(&l->count, INT_MAX);
+  }
+}
+
+/* Return's `TRUE` when `l` has reached zero. */
+bool latch_try_wait(latch_t *const l) {
+  ASSERT(l);
+  return !__atomic_load_n(&l->count, __ATOMIC_ACQUIRE);
+}
+
+/* Wait until `l` reaches zero, or `timeout_ns` expires when it's not negative.  Return's `TRUE` when it reached zero. */
+bool latch_wait(latch_t *const l, Llong timeout_ns) {
+  ASSERT(l);
+  Llong deadline;
+  Uint count;
+  bool ret = TRUE;
+  if (!__atomic_load_n(&l->count, __ATOMIC_ACQUIRE)) {
+    return TRUE;
+  }
+  deadline = atomic_deadline(timeout_ns);
+  __atomic_add_fetch(&l->waiters, 1, __ATOMIC_SEQ_CST);
+  while ((count = __atomic_load_n(&l->count, __ATOMIC_SEQ_CST))) {
+    if (!atomic_wait_until(&l->count, count, deadline)) {
+      ret = FALSE;
+      break;
+    }
+  }
+  __atomic_sub_fetch(&l->waiters, 1, __ATOMIC_RELAXED);
+  return ret;
+}
+
+/* ----------------------------- Barrier ----------------------------- */
+
+/* Init `b` as a rendezvous of `count` threads. */
+void barrier_init(barrier_t *const b, Uint count) {
+  ASSERT(b);
+  ALWAYS_ASSERT(count);
+  b->count      = count;
+  b->remaining  = count;
+  b->generation = 0;
+}
+
+/* Wait until all `count` threads of `b` have arrived, after which `b` is ready for the next round.  Return's `TRUE` in
+ * exactly one of the threads of every round, which can then do any serial work between rounds. */
+bool barrier_wait(barrier_t *const b) {
+  ASSERT(b);
+  Uint generation = __atomic_load_n(&b->generation, __ATOMIC_ACQUIRE);
+  if (__atomic_sub_fetch(&b->remaining, 1, __ATOMIC_ACQ_REL)) {
+    while (__atomic_load_n(&b->generation, __ATOMIC_ACQUIRE) == generation) {
+      futex_wait(&b->generation, generation, NULL);
+    }
+    return FALSE;
+  }
+  /* We are the last to arrive.  Reset the count before starting the next generation, as the waiters can
+   * enter the next round as soon as they see it. */
+  __atomic_store_n(&b->remaining, b->count, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&b->generation, 1, __ATOMIC_RELEASE);
+  if (b->count > 1) {
+    futex_wake(&b->generation, INT_MAX);
+  }
+  return TRUE;
+}
+
+#endif
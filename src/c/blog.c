@@ -0,0 +1,880 @@
+/** @file blog.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Binary deferred-format logging.
+
+  A `FCIO_BLOG()` call does no formatting at all.  Its format, and the types of its arguments, are known at compile
+  time and live in a static `fcio_blog_site_t`, so at runtime it only appends a small record, the site id, a tsc
+  timestamp and the raw arguments, to a per-thread buffer, that is written to the log once it's full.  Every site in
+  the program is written to the head of the log by `fcio_blog_open()`, and `fcio_blog_decode()`, or the `blogdecode`
+  tool, turns the records back into the usual text lines, offline.
+
+  The log is in host byte order, and starts with a header, "FCIOBLG1", the nanoseconds per cycle, and a tsc together
+  with the realtime clock in nanoseconds at that tsc.  After that every record is a u32 size, a u32 site id, a u64
+  tsc, and then the arguments, 4 bytes for a 32-bit integer, 8 for a 64-bit integer, a double or a pointer, and a u32
+  length, the bytes and a nul-terminator for a string.  Records with the id `BLOG_SITE_RECORD` describe a site, they
+  hold its u32 id, i32 line, i32 level, u8 number of arguments and their types, followed by the file, the function and
+  the format as strings.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+#define BLOG_MAGIC  "FCIOBLG1"
+
+/* The size of the header at the start of the log. */
+#define BLOG_HEADER_SIZE  (32)
+
+/* The size of the per-thread buffer records are appended to. */
+#define BLOG_BUFFER_SIZE  (64 * 1024)
+
+/* Longer string arguments are cut off. */
+#define BLOG_STR_MAX  (1024)
+
+/* The size, id and tsc in front of every record. */
+#define BLOG_RECORD_HEAD  (16)
+
+/* The largest a record of a log call can be. */
+#define BLOG_RECORD_MAX  (BLOG_RECORD_HEAD + (FCIO_BLOG_MAX_ARGS * (4 + BLOG_STR_MAX + 1)))
+
+/* The id of records that describe a site, rather then a log call. */
+#define BLOG_SITE_RECORD  (0xFFFFFFFFU)
+
+/* The size of the line the fallback formats into, longer lines are allocated. */
+#define BLOG_LINE_MAX  (1024)
+
+/* Length modifiers of a conversion, as far as the decoder cares. */
+#define BLOG_LEN_HH   (0)
+#define BLOG_LEN_H    (1)
+#define BLOG_LEN_INT  (2)
+#define BLOG_LEN_L    (3)
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+typedef struct BlogBuffer {
+  fmutex_t lock;
+  /* Set while a thread uses this buffer.  The buffers of exited threads are reused. */
+  Uint owned;
+  Ulong len;
+  struct BlogBuffer *next;
+  char data[BLOG_BUFFER_SIZE];
+} BlogBuffer;
+
+/* One decoded argument. */
+typedef struct {
+  Uchar type;
+  union {
+    Llong i;
+    Ulong u;
+    double f;
+    const char *s;
+  } v;
+} BlogArg;
+
+/* One data record of the log being decoded. */
+typedef struct {
+  Ulong tsc;
+  Ulong offset;
+} BlogEntry;
+
+/* The text the decoder builds. */
+typedef struct {
+  char *data;
+  Ulong len;
+  Ulong cap;
+} BlogOut;
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+/* The log, or `-1` when it's not open, in which case log calls are formatted and passed to `fcio_log()`. */
+static int blog_fd = -1;
+
+/* Every buffer ever made. */
+static BlogBuffer *blog_buffers = NULL;
+
+static _THREAD BlogBuffer *blog_buffer = NULL;
+
+static pthread_once_t blog_once = PTHREAD_ONCE_INIT;
+static pthread_key_t blog_key;
+
+/* The last site id handed out. */
+static Uint blog_last_id = 0;
+
+/* The bounds of the `fcio_blog_sites` section, made by the linker, where `FCIO_BLOG()` puts a pointer to every site. */
+extern fcio_blog_site_t *const __start_fcio_blog_sites[] __attribute__((__weak__));
+extern fcio_blog_site_t *const __stop_fcio_blog_sites[] __attribute__((__weak__));
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Write ----------------------------- */
+
+/* Write all `len` bytes of `data` to `fd`.  A failed write is dropped, as there is nowhere left to report it. */
+static void blog_write_fd(int fd, const char *data, Ulong len) {
+  long written;
+  while (len) {
+    if ((written = write(fd, data, len)) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    data += written;
+    len  -= written;
+  }
+}
+
+/* Write out everything in `b`.  Note that `b->lock` must be held. */
+static void blog_buffer_flush(BlogBuffer *const b) {
+  int fd = __atomic_load_n(&blog_fd, __ATOMIC_ACQUIRE);
+  if (b->len && fd != -1) {
+    blog_write_fd(fd, b->data, b->len);
+  }
+  b->len = 0;
+}
+
+/* Called at thread exit, so nothing the thread logged is lost, and the buffer can be reused. */
+static void blog_buffer_release(void *arg) {
+  BlogBuffer *b = arg;
+  FMUTEX_ACTION(&b->lock,
+    blog_buffer_flush(b);
+  );
+  __atomic_store_n(&b->owned, FALSE, __ATOMIC_RELEASE);
+}
+
+static void blog_init(void) {
+  pthread_key_create(&blog_key, blog_buffer_release);
+  atexit(fcio_blog_close);
+}
+
+/* Return's the buffer of the calling thread, taking over the buffer of an exited thread when there is one. */
+static BlogBuffer *blog_buffer_get(void) {
+  BlogBuffer *b = blog_buffer;
+  Uint expected;
+  if (b) {
+    return b;
+  }
+  for (b=__atomic_load_n(&blog_buffers, __ATOMIC_ACQUIRE); b; b=b->next) {
+    expected = FALSE;
+    if (__atomic_compare_exchange_n(&b->owned, &expected, TRUE, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+  if (!b) {
+    b = xmalloc_aligned(_CACHELINE_SIZE, sizeof(*b));
+    fmutex_init(&b->lock);
+    b->owned = TRUE;
+    b->len   = 0;
+    b->next  = __atomic_load_n(&blog_buffers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&blog_buffers, &b->next, b, TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  }
+  pthread_setspecific(blog_key, b);
+  blog_buffer = b;
+  return b;
+}
+
+/* ----------------------------- Records ----------------------------- */
+
+static inline char *blog_put(char *const p, const void *const data, Ulong len) {
+  memcpy(p, data, len);
+  return (p + len);
+}
+
+/* Put a string argument of `len` bytes at `p`. */
+static inline char *blog_put_str(char *p, const char *const s, Uint len) {
+  p = blog_put(p, &len, 4);
+  p = blog_put(p, s, len);
+  *p = '\0';
+  return (p + 1);
+}
+
+static inline char *blog_put_head(char *p, Uint size, Uint id, Ulong tsc) {
+  p = blog_put(p, &size, 4);
+  p = blog_put(p, &id, 4);
+  return blog_put(p, &tsc, 8);
+}
+
+/* Return's the id of `site`, giving it one when it has none.  Sets `fresh` when the id was given by this call. */
+static Uint blog_site_id(fcio_blog_site_t *const site, bool *const fresh) {
+  Uint expected = 0;
+  Uint id;
+  *fresh = FALSE;
+  if ((id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE))) {
+    return id;
+  }
+  id = __atomic_add_fetch(&blog_last_id, 1, __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&site->id, &expected, id, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    return expected;
+  }
+  *fresh = TRUE;
+  return id;
+}
+
+/* Return's an allocated record describing `site`, and its size in `size`. */
+static char *blog_site_record(const fcio_blog_site_t *const site, Uint *const size) {
+  Uint file_len   = strlen(site->file);
+  Uint func_len   = strlen(site->func);
+  Uint format_len = strlen(site->format);
+  char *record;
+  char *p;
+  *size  = (BLOG_RECORD_HEAD + 13 + site->nargs + 15 + file_len + func_len + format_len);
+  record = xmalloc(*size);
+  p = blog_put_head(record, *size, BLOG_SITE_RECORD, 0);
+  p = blog_put(p, &site->id, 4);
+  p = blog_put(p, &site->line, 4);
+  p = blog_put(p, &site->level, 4);
+  p = blog_put(p, &site->nargs, 1);
+  p = blog_put(p, site->types, site->nargs);
+  p = blog_put_str(p, site->file, file_len);
+  p = blog_put_str(p, site->func, func_len);
+  blog_put_str(p, site->format, format_len);
+  return record;
+}
+
+/* Describe `site` in the buffer `b`.  This is only needed for sites that were not in the `fcio_blog_sites` section when
+ * the log was opened.  Note that `b->lock` must be held. */
+static void blog_site_append(BlogBuffer *const b, const fcio_blog_site_t *const site) {
+  Uint size;
+  char *record = blog_site_record(site, &size);
+  if ((BLOG_BUFFER_SIZE - b->len) < size) {
+    blog_buffer_flush(b);
+  }
+  if (size > BLOG_BUFFER_SIZE) {
+    blog_write_fd(__atomic_load_n(&blog_fd, __ATOMIC_ACQUIRE), record, size);
+  }
+  else {
+    memcpy((b->data + b->len), record, size);
+    b->len += size;
+  }
+  free(record);
+}
+
+/* When the log is not open, format the call right away, and log it as a normal text line. */
+_PRINTFLIKE(2, 0)
+static void blog_fallback(const fcio_blog_site_t *const site, const char *const restrict format, va_list ap) {
+  char buf[BLOG_LINE_MAX];
+  char *text = buf;
+  va_list copy;
+  int len;
+  va_copy(copy, ap);
+  len = vsnprintf(buf, sizeof(buf), format, copy);
+  va_end(copy);
+  if (len >= BLOG_LINE_MAX) {
+    text = xmalloc(len + 1);
+    vsnprintf(text, (len + 1), format, ap);
+  }
+  fcio_log(site->level, site->line, site->func, "%s", text);
+  if (text != buf) {
+    free(text);
+  }
+}
+
+/* ----------------------------- Decode ----------------------------- */
+
+_PRINTFLIKE(2, 3)
+static void blog_out_printf(BlogOut *const out, const char *const restrict format, ...) {
+  va_list ap;
+  int len;
+  va_start(ap, format);
+  len = vsnprintf((out->data + out->len), (out->cap - out->len), format, ap);
+  va_end(ap);
+  if ((out->len + len) >= out->cap) {
+    while ((out->len + len) >= out->cap) {
+      out->cap *= 2;
+    }
+    out->data = xrealloc(out->data, out->cap);
+    va_start(ap, format);
+    vsnprintf((out->data + out->len), (out->cap - out->len), format, ap);
+    va_end(ap);
+  }
+  out->len += len;
+}
+
+static void blog_out_append(BlogOut *const out, const char *const restrict data, Ulong len) {
+  if ((out->len + len) >= out->cap) {
+    while ((out->len + len) >= out->cap) {
+      out->cap *= 2;
+    }
+    out->data = xrealloc(out->data, out->cap);
+  }
+  memcpy((out->data + out->len), data, len);
+  out->len += len;
+}
+
+/* Read the next argument of the type `type` at `*p`, and advance `*p` past it.  Return's `FALSE` when it does not fit
+ * before `end`. */
+static bool blog_arg_read(BlogArg *const arg, Uchar type, const char **p, const char *const end) {
+  int i32;
+  Uint u32;
+  Uint len;
+  arg->type = type;
+  switch (type) {
+    case FCIO_BLOG_I32:
+    case FCIO_BLOG_U32: {
+      if ((end - *p) < 4) {
+        return FALSE;
+      }
+      if (type == FCIO_BLOG_I32) {
+        memcpy(&i32, *p, 4);
+        arg->v.i = i32;
+      }
+      else {
+        memcpy(&u32, *p, 4);
+        arg->v.u = u32;
+      }
+      *p += 4;
+      return TRUE;
+    }
+    case FCIO_BLOG_STR: {
+      if ((end - *p) < 4) {
+        return FALSE;
+      }
+      memcpy(&len, *p, 4);
+      /* The string is printed with `%s` later, so a corrupt log must not make it run past its end. */
+      if ((Ulong)(end - *p) < (len + 5UL) || (*p)[4 + len] != '\0') {
+        return FALSE;
+      }
+      arg->v.s = (*p + 4);
+      *p += (len + 5);
+      return TRUE;
+    }
+    default: {
+      if ((end - *p) < 8) {
+        return FALSE;
+      }
+      memcpy(&arg->v.u, *p, 8);
+      *p += 8;
+      return TRUE;
+    }
+  }
+}
+
+/* Return's `arg` as a signed integer, cut down to the length modifier `len`, like `printf()` would. */
+static Llong blog_arg_signed(const BlogArg *const arg, int len) {
+  Llong value;
+  switch (arg->type) {
+    case FCIO_BLOG_F64:
+    case FCIO_BLOG_LDBL: {
+      value = (Llong)arg->v.f;
+      break;
+    }
+    case FCIO_BLOG_STR: {
+      value = 0;
+      break;
+    }
+    default: {
+      value = arg->v.i;
+    }
+  }
+  switch (len) {
+    case BLOG_LEN_HH: {
+      return (signed char)value;
+    }
+    case BLOG_LEN_H: {
+      return (short)value;
+    }
+    case BLOG_LEN_INT: {
+      return (int)value;
+    }
+    default: {
+      return value;
+    }
+  }
+}
+
+static Ulong blog_arg_unsigned(const BlogArg *const arg, int len) {
+  Ulong value = (Ulong)blog_arg_signed(arg, BLOG_LEN_L);
+  switch (len) {
+    case BLOG_LEN_HH: {
+      return (Uchar)value;
+    }
+    case BLOG_LEN_H: {
+      return (Ushort)value;
+    }
+    case BLOG_LEN_INT: {
+      return (Uint)value;
+    }
+    default: {
+      return value;
+    }
+  }
+}
+
+static double blog_arg_double(const BlogArg *const arg) {
+  switch (arg->type) {
+    case FCIO_BLOG_F64:
+    case FCIO_BLOG_LDBL: {
+      return arg->v.f;
+    }
+    case FCIO_BLOG_U32:
+    case FCIO_BLOG_U64:
+    case FCIO_BLOG_PTR: {
+      return (double)arg->v.u;
+    }
+    case FCIO_BLOG_STR: {
+      return 0.0;
+    }
+    default: {
+      return (double)arg->v.i;
+    }
+  }
+}
+
+/* Append `format` formatted with `args` to `out`.  Every conversion is re-built with its width and precision filled
+ * in, and its argument widened to the largest type, so it can be passed to `snprintf()` no matter how it was stored. */
+static void blog_format(BlogOut *const out, const char *format, const BlogArg *const args, int nargs) {
+  const char *start;
+  char spec[64];
+  int next = 0;
+  int speclen;
+  int len;
+  char conv;
+  while (*format) {
+    if (*format != '%') {
+      start = format;
+      while (*format && *format != '%') {
+        ++format;
+      }
+      blog_out_append(out, start, (format - start));
+      continue;
+    }
+    if (format[1] == '%') {
+      blog_out_append(out, "%", 1);
+      format += 2;
+      continue;
+    }
+    start   = format++;
+    speclen = 0;
+    spec[speclen++] = '%';
+    /* Flags. */
+    while (*format && strchr("-+ #0'", *format)) {
+      if (speclen < 8) {
+        spec[speclen++] = *format;
+      }
+      ++format;
+    }
+    /* Width. */
+    if (*format == '*') {
+      speclen += snprintf((spec + speclen), 16, "%d", ((next < nargs) ? (int)blog_arg_signed(&args[next++], BLOG_LEN_INT) : 0));
+      ++format;
+    }
+    while (*format >= '0' && *format <= '9') {
+      if (speclen < 24) {
+        spec[speclen++] = *format;
+      }
+      ++format;
+    }
+    /* Precision. */
+    if (*format == '.') {
+      spec[speclen++] = *format++;
+      if (*format == '*') {
+        speclen += snprintf((spec + speclen), 16, "%d", ((next < nargs) ? (int)blog_arg_signed(&args[next++], BLOG_LEN_INT) : 0));
+        ++format;
+      }
+      while (*format >= '0' && *format <= '9') {
+        if (speclen < 48) {
+          spec[speclen++] = *format;
+        }
+        ++format;
+      }
+    }
+    /* Length. */
+    len = BLOG_LEN_INT;
+    while (*format && strchr("hljztLq", *format)) {
+      len = ((*format == 'h') ? ((len == BLOG_LEN_H) ? BLOG_LEN_HH : BLOG_LEN_H) : BLOG_LEN_L);
+      ++format;
+    }
+    if (!(conv = *format)) {
+      blog_out_append(out, start, (format - start));
+      break;
+    }
+    ++format;
+    if (conv == 'n') {
+      ++next;
+      continue;
+    }
+    if (!strchr("diuoxXcfFeEgGaAsp", conv)) {
+      blog_out_append(out, start, (format - start));
+      continue;
+    }
+    if (next >= nargs) {
+      blog_out_append(out, "<?>", 3);
+      continue;
+    }
+    switch (conv) {
+      case 'd':
+      case 'i': {
+        memcpy((spec + speclen), "lld", 4);
+        blog_out_printf(out, spec, blog_arg_signed(&args[next], len));
+        break;
+      }
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X': {
+        spec[speclen++] = 'l';
+        spec[speclen++] = 'l';
+        spec[speclen++] = conv;
+        spec[speclen]   = '\0';
+        blog_out_printf(out, spec, blog_arg_unsigned(&args[next], len));
+        break;
+      }
+      case 'c': {
+        memcpy((spec + speclen), "c", 2);
+        blog_out_printf(out, spec, (int)blog_arg_signed(&args[next], BLOG_LEN_INT));
+        break;
+      }
+      case 's': {
+        memcpy((spec + speclen), "s", 2);
+        blog_out_printf(out, spec, ((args[next].type == FCIO_BLOG_STR) ? args[next].v.s : "<?>"));
+        break;
+      }
+      case 'p': {
+        memcpy((spec + speclen), "p", 2);
+        blog_out_printf(out, spec, (void *)args[next].v.u);
+        break;
+      }
+      default: {
+        spec[speclen++] = conv;
+        spec[speclen]   = '\0';
+        blog_out_printf(out, spec, blog_arg_double(&args[next]));
+      }
+    }
+    ++next;
+  }
+}
+
+static int blog_entry_compare(const void *a, const void *b) {
+  const BlogEntry *x = a;
+  const BlogEntry *y = b;
+  if (x->tsc != y->tsc) {
+    return ((x->tsc < y->tsc) ? -1 : 1);
+  }
+  return ((x->offset < y->offset) ? -1 : (x->offset > y->offset));
+}
+
+/* Read all of `path` into an allocated buffer.  Return's `NULL` when it can't be read. */
+static char *blog_read_file(const char *const restrict path, Ulong *const size) {
+  struct stat info;
+  char *data;
+  long got;
+  int fd;
+  if ((fd = open(path, (O_RDONLY | O_CLOEXEC))) == -1) {
+    return NULL;
+  }
+  if (fstat(fd, &info) == -1) {
+    close(fd);
+    return NULL;
+  }
+  data  = xmalloc(info.st_size + 1);
+  *size = 0;
+  while (*size < (Ulong)info.st_size && ((got = read(fd, (data + *size), (info.st_size - *size))) > 0 || (got == -1 && errno == EINTR))) {
+    if (got > 0) {
+      *size += got;
+    }
+  }
+  close(fd);
+  return data;
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Fcio blog open ----------------------------- */
+
+/* Start writing binary log records to `path`, which is truncated.  Every site in the program is written to the head
+ * of the log, so the records that follow only need the site id. */
+void fcio_blog_open(const char *const restrict path) {
+  ASSERT(path);
+  fcio_blog_site_t *const *site;
+  struct timespec ts;
+  char header[BLOG_HEADER_SIZE];
+  double ns_per_cycle;
+  char *record;
+  Ulong tsc;
+  Llong ns;
+  Uint size;
+  bool fresh;
+  int fd;
+  pthread_once(&blog_once, blog_init);
+  fcio_blog_close();
+  if ((fd = open(path, (O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC), 0644)) == -1) {
+    die_callback("Failed to open '%s': %s\n", path, strerror(errno));
+  }
+  ns_per_cycle = (fcio_cycles_to_ns(1000000000UL) / 1e9);
+  clock_gettime(CLOCK_REALTIME, &ts);
+  tsc = fcio_cycles();
+  ns  = ((ts.tv_sec * 1000000000LL) + ts.tv_nsec);
+  memcpy(header, BLOG_MAGIC, 8);
+  memcpy((header + 8), &ns_per_cycle, 8);
+  memcpy((header + 16), &tsc, 8);
+  memcpy((header + 24), &ns, 8);
+  blog_write_fd(fd, header, BLOG_HEADER_SIZE);
+  /* The registry, of every site in the program. */
+  if (__start_fcio_blog_sites) {
+    for (site=__start_fcio_blog_sites; site<__stop_fcio_blog_sites; ++site) {
+      blog_site_id(*site, &fresh);
+      record = blog_site_record(*site, &size);
+      blog_write_fd(fd, record, size);
+      free(record);
+    }
+  }
+  __atomic_store_n(&blog_fd, fd, __ATOMIC_RELEASE);
+}
+
+/* ----------------------------- Fcio blog write ----------------------------- */
+
+/* Record a call of `site`, with the arguments it describes.  This is what `FCIO_BLOG()` calls, and should not be called
+ * directly.  `format` is the format of `site`, and is only passed so the compiler can check the arguments against it.
+ * When the log is not open, the line is formatted and logged by `fcio_log()` instead. */
+void fcio_blog_write(fcio_blog_site_t *const site, const char *const restrict format, ...) {
+  ASSERT(site);
+  ASSERT(format);
+  BlogBuffer *b;
+  va_list ap;
+  const char *s;
+  char *start;
+  char *p;
+  Llong i64;
+  double f64;
+  void *ptr;
+  Uint size;
+  Uint len;
+  Uint id;
+  bool fresh;
+  int i32;
+  if (__atomic_load_n(&blog_fd, __ATOMIC_RELAXED) == -1) {
+    va_start(ap, format);
+    blog_fallback(site, format, ap);
+    va_end(ap);
+    return;
+  }
+  b = blog_buffer_get();
+  fmutex_lock(&b->lock);
+  id = blog_site_id(site, &fresh);
+  if (fresh) {
+    blog_site_append(b, site);
+  }
+  if ((BLOG_BUFFER_SIZE - b->len) < BLOG_RECORD_MAX) {
+    blog_buffer_flush(b);
+  }
+  start = (b->data + b->len);
+  p     = (start + BLOG_RECORD_HEAD);
+  va_start(ap, format);
+  for (int i=0; i<site->nargs; ++i) {
+    switch (site->types[i]) {
+      case FCIO_BLOG_I32:
+      case FCIO_BLOG_U32: {
+        i32 = va_arg(ap, int);
+        p = blog_put(p, &i32, 4);
+        break;
+      }
+      case FCIO_BLOG_I64:
+      case FCIO_BLOG_U64: {
+        i64 = va_arg(ap, Llong);
+        p = blog_put(p, &i64, 8);
+        break;
+      }
+      case FCIO_BLOG_F64: {
+        f64 = va_arg(ap, double);
+        p = blog_put(p, &f64, 8);
+        break;
+      }
+      case FCIO_BLOG_LDBL: {
+        f64 = (double)va_arg(ap, long double);
+        p = blog_put(p, &f64, 8);
+        break;
+      }
+      case FCIO_BLOG_STR: {
+        if (!(s = va_arg(ap, const char *))) {
+          s = "(null)";
+        }
+        len = strnlen(s, BLOG_STR_MAX);
+        p   = blog_put_str(p, s, len);
+        break;
+      }
+      default: {
+        ptr = va_arg(ap, void *);
+        p = blog_put(p, &ptr, 8);
+      }
+    }
+  }
+  va_end(ap);
+  size = (p - start);
+  blog_put_head(start, size, id, fcio_cycles());
+  b->len += size;
+  fmutex_unlock(&b->lock);
+}
+
+/* ----------------------------- Fcio blog flush ----------------------------- */
+
+/* Write out the buffered records of every thread. */
+void fcio_blog_flush(void) {
+  for (BlogBuffer *b=__atomic_load_n(&blog_buffers, __ATOMIC_ACQUIRE); b; b=b->next) {
+    FMUTEX_ACTION(&b->lock,
+      blog_buffer_flush(b);
+    );
+  }
+}
+
+/* ----------------------------- Fcio blog close ----------------------------- */
+
+/* Write out every buffered record and close the log, after which log calls go to `fcio_log()` again.  Note that no
+ * other thread may log while this runs.  This also runs at exit. */
+void fcio_blog_close(void) {
+  int fd;
+  if (__atomic_load_n(&blog_fd, __ATOMIC_ACQUIRE) == -1) {
+    return;
+  }
+  fcio_blog_flush();
+  if ((fd = __atomic_exchange_n(&blog_fd, -1, __ATOMIC_ACQ_REL)) != -1) {
+    close(fd);
+  }
+}
+
+/* ----------------------------- Fcio blog decode ----------------------------- */
+
+/* Decode the binary log at `path` into text lines, in timestamp order, written to `out_fd`.  Return's the number of
+ * lines, or `-1` when `path` can't be read or is not a binary log. */
+long fcio_blog_decode(const char *const restrict path, int out_fd) {
+  ASSERT(path);
+  fcio_blog_site_t *sites = NULL;
+  fcio_blog_site_t *site;
+  BlogEntry *entries = NULL;
+  BlogArg args[FCIO_BLOG_MAX_ARGS];
+  BlogOut out;
+  struct tm tm;
+  time_t secs;
+  const char *p;
+  const char *end;
+  char stamp[32];
+  double ns_per_cycle;
+  Ulong size;
+  Ulong nentries = 0;
+  Ulong tsc0;
+  Ulong tsc;
+  Llong ns0;
+  Llong ns;
+  Uint nsites = 0;
+  Uint rsize;
+  Uint id;
+  int nargs;
+  char *data;
+  if (!(data = blog_read_file(path, &size))) {
+    return -1;
+  }
+  if (size < BLOG_HEADER_SIZE || memcmp(data, BLOG_MAGIC, 8) != 0) {
+    free(data);
+    return -1;
+  }
+  memcpy(&ns_per_cycle, (data + 8), 8);
+  memcpy(&tsc0, (data + 16), 8);
+  memcpy(&ns0, (data + 24), 8);
+  /* First collect the sites, as a record can be flushed before the record of its site, when that site was described
+   * by an other thread.  The strings are nul-terminated in the log, so the sites can point right into it. */
+  entries = xmalloc(sizeof(*entries) * ((size / BLOG_RECORD_HEAD) + 1));
+  for (Ulong off=BLOG_HEADER_SIZE; (off + BLOG_RECORD_HEAD) <= size; off+=rsize) {
+    memcpy(&rsize, (data + off), 4);
+    memcpy(&id, (data + off + 4), 4);
+    memcpy(&tsc, (data + off + 8), 8);
+    if (rsize < BLOG_RECORD_HEAD || rsize > (size - off)) {
+      break;
+    }
+    if (id != BLOG_SITE_RECORD) {
+      entries[nentries].tsc      = tsc;
+      entries[nentries++].offset = off;
+      continue;
+    }
+    p   = (data + off + BLOG_RECORD_HEAD);
+    end = (data + off + rsize);
+    if ((end - p) < 13) {
+      continue;
+    }
+    memcpy(&id, p, 4);
+    if (id >= nsites) {
+      sites = xrealloc(sites, (sizeof(*sites) * (id + 1)));
+      memset((sites + nsites), 0, (sizeof(*sites) * (id + 1 - nsites)));
+      nsites = (id + 1);
+    }
+    site = &sites[id];
+    memcpy(&site->line, (p + 4), 4);
+    memcpy(&site->level, (p + 8), 4);
+    site->nargs = (Uchar)p[12];
+    p += 13;
+    if (site->nargs > FCIO_BLOG_MAX_ARGS || (end - p) < site->nargs) {
+      site->id = 0;
+      continue;
+    }
+    memcpy(site->types, p, site->nargs);
+    p += site->nargs;
+    if (!blog_arg_read(&args[0], FCIO_BLOG_STR, &p, end) || !blog_arg_read(&args[1], FCIO_BLOG_STR, &p, end)
+     || !blog_arg_read(&args[2], FCIO_BLOG_STR, &p, end)) {
+      site->id = 0;
+      continue;
+    }
+    site->file   = args[0].v.s;
+    site->func   = args[1].v.s;
+    site->format = args[2].v.s;
+    site->id     = id;
+  }
+  qsort(entries, nentries, sizeof(*entries), blog_entry_compare);
+  out.cap  = (64 * 1024);
+  out.len  = 0;
+  out.data = xmalloc(out.cap);
+  for (Ulong i=0; i<nentries; ++i) {
+    memcpy(&rsize, (data + entries[i].offset), 4);
+    memcpy(&id, (data + entries[i].offset + 4), 4);
+    p   = (data + entries[i].offset + BLOG_RECORD_HEAD);
+    end = (data + entries[i].offset + rsize);
+    ns  = (ns0 + (Llong)((double)(Llong)(entries[i].tsc - tsc0) * ns_per_cycle));
+    secs = (ns / 1000000000LL);
+    localtime_r(&secs, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    if (id >= nsites || !sites[id].id) {
+      blog_out_printf(&out, "%s.%09ld [??????]: Unknown site %u\n", stamp, (ns % 1000000000L), id);
+      continue;
+    }
+    site  = &sites[id];
+    nargs = 0;
+    while (nargs < site->nargs && blog_arg_read(&args[nargs], site->types[nargs], &p, end)) {
+      ++nargs;
+    }
+    blog_out_printf(&out, "%s.%09ld [%s]:[LINE]:[%d]%*s:[FUNC]:[%s]: ",
+      stamp,
+      (ns % 1000000000L),
+      fcio_log_tag(site->level),
+      site->line,
+      ((digits(site->line) < 5) ? (5 - digits(site->line)) : 0),
+      " ",
+      site->func
+    );
+    blog_format(&out, site->format, args, nargs);
+    blog_out_append(&out, "\n", 1);
+    if (out.len >= (32 * 1024)) {
+      blog_write_fd(out_fd, out.data, out.len);
+      out.len = 0;
+    }
+  }
+  blog_write_fd(out_fd, out.data, out.len);
+  free(out.data);
+  free(entries);
+  free(sites);
+  free(data);
+  return nentries;
+}
+
+#endif
@@ -0,0 +1,255 @@
+/** @file clock.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Cheap monotonic clock on top of the tsc.
+
+  On the first call the invariant tsc is calibrated against `CLOCK_MONOTONIC`, after which `fcio_now_ns()` is a
+  `rdtsc`, a multiply and a shift, without ever entering the vDSO.  About once a second a caller also re-reads the
+  monotonic clock, and steers the rate so the two never drift apart, while keeping the returned time monotonic.  The
+  steering only lasts as long as the error needs, after which the clock runs at the calibrated rate again, so a long
+  time without calls never leaves it running steered.  When
+  the tsc is not invariant, `fcio_now_ns()` is just `clock_gettime(CLOCK_MONOTONIC)`.
+
+  Note that this is in the time base of `hiactime_now_ns()`, so the two can be mixed.
+
+ */
+#include "../include/proto.h"
+#include "../include/statics.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+#if defined(__x86_64__) || defined(__i386__)
+# define CLOCK_HAS_TSC  (1)
+#else
+# define CLOCK_HAS_TSC  (0)
+#endif
+
+/* The fixed point shift of `ClockParams.mult`. */
+#define CLOCK_SHIFT  (32)
+
+/* How long the first calibration runs for. */
+#define CLOCK_CALIBRATE_NS  (1000000LL)
+
+/* How often the rate is corrected against the monotonic clock. */
+#define CLOCK_RESYNC_NS  (1000000000LL)
+
+/* Errors larger then this are stepped away right away, rather then steered away over the next period. */
+#define CLOCK_STEP_NS  (1000000LL)
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+/* For the 64x64 bit products of the fixed point math.  `__extension__` keeps `-pedantic` quiet about it. */
+__extension__ typedef unsigned __int128 ClockU128;
+
+/* The current mapping from tsc to nanoseconds, `ns = base_ns + (((tsc - base_tsc) * mult) >> CLOCK_SHIFT)` up to
+ * `steer_tsc`, and `steer_ns + (((tsc - steer_tsc) * rate) >> CLOCK_SHIFT)` after it. */
+typedef struct {
+  Ulong base_tsc;
+  Llong base_ns;
+  /* The steered rate, that brings us back onto the monotonic clock by `steer_tsc`. */
+  Ulong mult;
+  Ulong steer_tsc;
+  Llong steer_ns;
+  /* The calibrated rate. */
+  Ulong rate;
+  /* The tsc at which the next resync is due. */
+  Ulong resync_tsc;
+} ClockParams;
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+static pthread_once_t clock_once = PTHREAD_ONCE_INIT;
+static bool clock_ready = FALSE;
+static bool clock_use_tsc = FALSE;
+
+static seqlock_t clock_lock;
+static ClockParams clock_params;
+
+/* The first calibration point, every resync measures the rate from here, so it gets more accurate over time. */
+static Ulong clock_origin_tsc;
+static Llong clock_origin_ns;
+
+/* Set while a thread is resyncing, so only one of the callers that notice it's due does it. */
+static Uint clock_resyncing = 0;
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+static inline Ulong clock_rdtsc(void) {
+#if CLOCK_HAS_TSC
+  Uint low;
+  Uint high;
+  RDTSC(low, high);
+  return (((Ulong)high << 32) | low);
+#else
+  return (Ulong)hiactime_now_ns();
+#endif
+}
+
+/* Read the tsc and the monotonic clock as close together as we can, taking the tightest of a few tries. */
+static void clock_sample(Ulong *const tsc, Llong *const ns) {
+  Ulong best = ULONG_MAX;
+  Ulong before;
+  Ulong after;
+  Llong now;
+  *tsc = 0;
+  *ns  = 0;
+  for (int i=0; i<5; ++i) {
+    before = clock_rdtsc();
+    now    = hiactime_now_ns();
+    after  = clock_rdtsc();
+    if ((after - before) < best) {
+      best = (after - before);
+      *tsc = (before + ((after - before) / 2));
+      *ns  = now;
+    }
+  }
+}
+
+/* Return's the fixed point nanoseconds per cycle for `ns` nanoseconds over `cycles` cycles. */
+static inline Ulong clock_mult(Llong ns, Ulong cycles) {
+  return (Ulong)((((ClockU128)ns) << CLOCK_SHIFT) / (cycles ? cycles : 1));
+}
+
+/* Return's the cycles that take `ns` nanoseconds at the fixed point rate `mult`. */
+static inline Ulong clock_cycles(Llong ns, Ulong mult) {
+  return (Ulong)((((ClockU128)ns) << CLOCK_SHIFT) / mult);
+}
+
+static inline Llong clock_tsc_to_ns(const ClockParams *const p, Ulong tsc) {
+  if (tsc >= p->steer_tsc) {
+    return (p->steer_ns + (Llong)(((ClockU128)(tsc - p->steer_tsc) * p->rate) >> CLOCK_SHIFT));
+  }
+  return (p->base_ns + (Llong)(((ClockU128)(tsc - p->base_tsc) * p->mult) >> CLOCK_SHIFT));
+}
+
+static void clock_init(void) {
+  Ulong tsc;
+  Llong ns;
+#if CLOCK_HAS_TSC
+  clock_use_tsc = has_inveriant_tsc();
+#endif
+  seqlock_init(&clock_lock);
+  clock_sample(&clock_origin_tsc, &clock_origin_ns);
+  do {
+    clock_sample(&tsc, &ns);
+  } while ((ns - clock_origin_ns) < CLOCK_CALIBRATE_NS);
+  clock_params.base_tsc   = tsc;
+  clock_params.base_ns    = ns;
+  clock_params.rate       = clock_mult((ns - clock_origin_ns), (tsc - clock_origin_tsc));
+  clock_params.mult       = clock_params.rate;
+  clock_params.steer_tsc  = tsc;
+  clock_params.steer_ns   = ns;
+  clock_params.resync_tsc = (tsc + clock_cycles(CLOCK_RESYNC_NS, clock_params.rate));
+  __atomic_store_n(&clock_ready, TRUE, __ATOMIC_RELEASE);
+}
+
+static inline void clock_ensure_init(void) {
+  if (!__atomic_load_n(&clock_ready, __ATOMIC_ACQUIRE)) {
+    pthread_once(&clock_once, clock_init);
+  }
+}
+
+/* Re-read the monotonic clock, and steer the rate so we are back onto it by the end of the steering.  The new mapping
+ * starts where the current one is right now, so the returned time never jumps backwards. */
+static void clock_resync(void) {
+  ClockParams p = clock_params;
+  Ulong tsc;
+  Llong ns;
+  Llong ours;
+  Llong error;
+  Ulong steer;
+  clock_sample(&tsc, &ns);
+  ours = clock_tsc_to_ns(&p, tsc);
+  /* The true rate, measured over everything since the origin. */
+  p.rate     = clock_mult((ns - clock_origin_ns), (tsc - clock_origin_tsc));
+  error      = (ns - ours);
+  p.base_tsc = tsc;
+  p.base_ns  = ours;
+  if (error > CLOCK_STEP_NS) {
+    /* Most likely a suspend, so just step forward. */
+    p.base_ns = ns;
+    p.mult    = p.rate;
+    steer     = 0;
+  }
+  else if (error > -CLOCK_STEP_NS) {
+    /* Steer towards the monotonic clock over the next period. */
+    steer  = clock_cycles(CLOCK_RESYNC_NS, p.rate);
+    p.mult = clock_mult((CLOCK_RESYNC_NS + error), steer);
+  }
+  else {
+    /* We are far ahead, so run at half speed until it catches up, which takes twice the error, rather then going
+     * backwards. */
+    steer  = clock_cycles((-error * 2), p.rate);
+    p.mult = (p.rate / 2);
+  }
+  p.steer_tsc  = (tsc + steer);
+  p.steer_ns   = (p.base_ns + (Llong)(((ClockU128)steer * p.mult) >> CLOCK_SHIFT));
+  p.resync_tsc = (tsc + clock_cycles(CLOCK_RESYNC_NS, p.rate));
+  seqlock_write_lock(&clock_lock);
+  clock_params = p;
+  seqlock_write_unlock(&clock_lock);
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* Return's the raw cycle counter, the tsc on x86, and the monotonic clock in nanoseconds elsewhere.  Only differences
+ * between two calls mean anything, see `fcio_cycles_to_ns()`. */
+Ulong fcio_cycles(void) {
+  return clock_rdtsc();
+}
+
+/* Return's the current time of the monotonic clock in nanoseconds, in the same time base as `hiactime_now_ns()`, but
+ * only a few nanoseconds per call when the tsc is invariant. */
+Llong fcio_now_ns(void) {
+  ClockParams p;
+  Ulong tsc;
+  Uint seq;
+  clock_ensure_init();
+  if (!clock_use_tsc) {
+    return hiactime_now_ns();
+  }
+  do {
+    seq = seqlock_read_begin(&clock_lock);
+    p   = clock_params;
+  } while (seqlock_read_retry(&clock_lock, seq));
+  tsc = clock_rdtsc();
+  if (tsc >= p.resync_tsc && !__atomic_exchange_n(&clock_resyncing, 1, __ATOMIC_ACQUIRE)) {
+    clock_resync();
+    __atomic_store_n(&clock_resyncing, 0, __ATOMIC_RELEASE);
+  }
+  return clock_tsc_to_ns(&p, tsc);
+}
+
+/* Convert a difference of `fcio_cycles()` to nanoseconds, at the calibrated rate. */
+double fcio_cycles_to_ns(Ulong cycles) {
+  ClockParams p;
+  Uint seq;
+  clock_ensure_init();
+  do {
+    seq = seqlock_read_begin(&clock_lock);
+    p   = clock_params;
+  } while (seqlock_read_retry(&clock_lock, seq));
+  return ((double)cycles * ((double)p.rate / (double)(1UL << CLOCK_SHIFT)));
+}
+
+/* Return's `TRUE` when `fcio_now_ns()` is backed by the tsc, rather then `clock_gettime()`. */
+bool fcio_clock_is_tsc(void) {
+  clock_ensure_init();
+  return clock_use_tsc;
+}
+
+#endif
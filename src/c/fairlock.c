@@ -0,0 +1,158 @@
+/** @file fairlock.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Fair locks, that hand the lock over in strict arrival order, so no waiter can be overtaken and starved, and the time
+  to acquire is bounded by the number of threads ahead of it.
+
+  `ticketlock_t` is two counters, a thread takes a ticket and waits until it's served.  It's as small as a lock gets,
+  but all waiters poll the same cache line, so every handoff invalidates it on every waiting cpu.
+
+  `mcslock_t` queues waiters as a linked list of nodes, that live on the waiters own stack, where every waiter polls a
+  flag in its own node.  So a handoff only touches the line of the next waiter, which is what makes it scale to many
+  contending cpu's.
+
+  Both spin for a while, and then park on a futex, so they also behave when there are more threads then cpu's, where
+  a pure spinning fair lock would wait for a descheduled thread whose turn it is.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+#include "../include/statics.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* The number of `pause` rounds before a waiter parks. */
+#ifndef FAIRLOCK_SPIN_COUNT
+# define FAIRLOCK_SPIN_COUNT  (256)
+#endif
+
+#define MCS_GRANTED  (0)
+#define MCS_WAITING  (1)
+#define MCS_PARKED   (2)
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Ticket lock ----------------------------- */
+
+void ticketlock_init(ticketlock_t *const l) {
+  ASSERT(l);
+  l->next   = 0;
+  l->owner  = 0;
+  l->parked = 0;
+}
+
+void ticketlock_lock(ticketlock_t *const l) {
+  ASSERT(l);
+  Uint ticket = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED);
+  Uint owner;
+  int spin = 0;
+  while ((owner = __atomic_load_n(&l->owner, __ATOMIC_ACQUIRE)) != ticket) {
+    /* Only the next in line spins, everyone further back parks right away, as they have at least one whole critical
+     * section to wait for, and spinning would only take cpu time from the holder when threads outnumber cpu's. */
+    if ((ticket - owner) == 1 && spin++ < FAIRLOCK_SPIN_COUNT) {
+      CPU_RELAX();
+      continue;
+    }
+    __atomic_add_fetch(&l->parked, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&l->owner, __ATOMIC_SEQ_CST) == owner) {
+      futex_wait(&l->owner, owner, NULL);
+    }
+    __atomic_sub_fetch(&l->parked, 1, __ATOMIC_RELAXED);
+  }
+}
+
+/* Lock `l` only when no one holds or waits for it.  Return's `TRUE` when the lock was taken. */
+bool ticketlock_trylock(ticketlock_t *const l) {
+  ASSERT(l);
+  Uint owner = __atomic_load_n(&l->owner, __ATOMIC_ACQUIRE);
+  Uint next  = owner;
+  return __atomic_compare_exchange_n(&l->next, &next, (owner + 1), FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void ticketlock_unlock(ticketlock_t *const l) {
+  ASSERT(l);
+  __atomic_store_n(&l->owner, (l->owner + 1), __ATOMIC_SEQ_CST);
+  /* Parked waiters can't tell which of them is next, so all of them have to check. */
+  if (__atomic_load_n(&l->parked, __ATOMIC_SEQ_CST)) {
+    futex_wake(&l->owner, INT_MAX);
+  }
+}
+
+/* ----------------------------- MCS lock ----------------------------- */
+
+void mcslock_init(mcslock_t *const l) {
+  ASSERT(l);
+  l->tail = NULL;
+}
+
+/* Lock `l`, where `node` is the calling threads place in the queue.  It's usually a local, and must stay valid and
+ * untouched until the matching `mcslock_unlock()`, see `MCSLOCK_ACTION()`. */
+void mcslock_lock(mcslock_t *const l, mcs_node_t *const node) {
+  ASSERT(l);
+  ASSERT(node);
+  mcs_node_t *prev;
+  Uint state = MCS_WAITING;
+  node->next   = NULL;
+  node->locked = MCS_WAITING;
+  prev = __atomic_exchange_n(&l->tail, node, __ATOMIC_ACQ_REL);
+  /* The queue was empty, so the lock is ours. */
+  if (!prev) {
+    return;
+  }
+  __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+  for (int i=0; i<FAIRLOCK_SPIN_COUNT; ++i) {
+    if (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE) == MCS_GRANTED) {
+      return;
+    }
+    CPU_RELAX();
+  }
+  /* Tell our predecessor it has to wake us, unless it just granted us the lock. */
+  if (__atomic_compare_exchange_n(&node->locked, &state, MCS_PARKED, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+    while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE) != MCS_GRANTED) {
+      futex_wait(&node->locked, MCS_PARKED, NULL);
+    }
+  }
+}
+
+/* Lock `l` only when the queue is empty.  Return's `TRUE` when the lock was taken. */
+bool mcslock_trylock(mcslock_t *const l, mcs_node_t *const node) {
+  ASSERT(l);
+  ASSERT(node);
+  mcs_node_t *expected = NULL;
+  node->next   = NULL;
+  node->locked = MCS_WAITING;
+  return __atomic_compare_exchange_n(&l->tail, &expected, node, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void mcslock_unlock(mcslock_t *const l, mcs_node_t *const node) {
+  ASSERT(l);
+  ASSERT(node);
+  mcs_node_t *next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+  mcs_node_t *expected;
+  if (!next) {
+    /* No one is queued behind us, so just empty the queue. */
+    expected = node;
+    if (__atomic_compare_exchange_n(&l->tail, &expected, NULL, FALSE, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+      return;
+    }
+    /* Someone swapped themself in as tail, but has not linked to us yet. */
+    while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE))) {
+      CPU_RELAX();
+    }
+  }
+  /* Note that `next` can return and drop its node right after the exchange, the wake is still safe, as a stray
+   * futex wake is only ever a spurious wakeup for whatever else lives there. */
+  if (__atomic_exchange_n(&next->locked, MCS_GRANTED, __ATOMIC_RELEASE) == MCS_PARKED) {
+    futex_wake(&next->locked, 1);
+  }
+}
+
+#endif
@@ -0,0 +1,677 @@
+/** @file fiber.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Stackful fibers, run by a per-thread scheduler built around epoll.  A fiber can block on fd readiness, a timer or a
+  channel, and while it does the scheduler runs the other fibers, so straight-line code can wait on thousands of things
+  at once, where every wait only costs the pages of its stack that are actually touched.
+
+  On x86-64 a hand-written context switch is used, that only saves the callee-saved registers.  On anything else we
+  fall back to `ucontext`.  Stacks are mapped with a guard page below them, and finished stacks are kept for reuse.
+
+  Note that a scheduler and all its fibers and channels belong to the thread that runs it.  The only thing that is
+  safe to do from other threads is `fiber_sched_post()`, for instance from a `FILE_LISTENER` callback.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+
+#if !__WIN__
+
+#if !defined(__x86_64__)
+# include <ucontext.h>
+#endif
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+#define FIBER_DEFAULT_STACK_SIZE  (64 * 1024)
+#define FIBER_MIN_STACK_SIZE      (16 * 1024)
+
+/* The max number of finished stacks kept for reuse, any more are unmapped. */
+#define FIBER_STACK_POOL_MAX  (64)
+
+#define FIBER_EPOLL_BATCH  (64)
+#define FIBER_POST_CAP     (4096)
+
+#define ASSERT_FIBER_SCHED(x)  \
+  DO_WHILE(                    \
+    ASSERT((x));               \
+    ASSERT((x)->timers);       \
+    ASSERT((x)->posts);        \
+  )
+
+#define ASSERT_FIBER_CHAN(x)  \
+  DO_WHILE(                   \
+    ASSERT((x));              \
+    ASSERT((x)->buf);         \
+  )
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+#if defined(__x86_64__)
+typedef struct {
+  void *sp;
+} FiberContext;
+#else
+typedef struct {
+  ucontext_t uc;
+} FiberContext;
+#endif
+
+/* Every fiber lives at the top of its own stack mapping, so spawning a fiber is a single pop from the stack pool. */
+typedef struct Fiber {
+  FiberContext ctx;
+  FIBER_SCHED sched;
+  void (*func)(void *);
+  void *arg;
+  /* The run-queue or channel wait-list this fiber is on, a fiber is only ever on one at a time. */
+  struct Fiber *next;
+  /* All live fibers of the scheduler, so the blocked ones can be released when it's freed. */
+  struct Fiber *all_prev;
+  struct Fiber *all_next;
+  /* The whole mapping, including the guard page. */
+  char *map;
+  Ulong map_size;
+  PQUEUE_HANDLE timer;
+  int wait_fd;
+  Uint revents;
+  /* The value passed through a channel, and whether the transfer happened. */
+  void *value;
+  bool ok;
+  bool done;
+} _ALIGNED(64) Fiber;
+
+typedef struct {
+  Fiber *head;
+  Fiber *tail;
+} FiberList;
+
+typedef struct {
+  void (*func)(void *);
+  void *arg;
+} FiberPost;
+
+struct FIBER_SCHED_T {
+  FiberContext ctx;
+  Fiber *current;
+  FiberList runq;
+  Fiber *all;
+  Ulong nfibers;
+  Fiber *pool;
+  Ulong npool;
+  Ulong stack_size;
+  Ulong page_size;
+  PQUEUE timers;
+  /* Work posted from other threads, `wfd` is the eventfd that wakes the scheduler for it. */
+  MPMC posts;
+  int wfd;
+  int efd;
+  bool running;
+};
+
+struct FIBER_CHAN_T {
+  void **buf;
+  Ulong cap;
+  Ulong head;
+  Ulong len;
+  FiberList senders;
+  FiberList receivers;
+  bool closed;
+};
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+static _THREAD FIBER_SCHED current_sched = NULL;
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Context switch ----------------------------- */
+
+#if defined(__x86_64__)
+
+/* Save the callee-saved registers and the fpu control words of the caller onto its own stack, store the stack pointer in `from`, then
+ * load `to` and return into whatever it was doing.  Everything else is already caller-saved by the abi, so this is all we need. */
+__attribute__((__visibility__("hidden"))) void fcio_fiber_switch(FiberContext *from, FiberContext *to);
+
+__asm__(
+  ".text\n"
+  ".globl fcio_fiber_switch\n"
+  ".hidden fcio_fiber_switch\n"
+  ".type fcio_fiber_switch, @function\n"
+  "fcio_fiber_switch:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  subq $8, %rsp\n"
+  "  stmxcsr (%rsp)\n"
+  "  fnstcw 4(%rsp)\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq (%rsi), %rsp\n"
+  "  ldmxcsr (%rsp)\n"
+  "  fldcw 4(%rsp)\n"
+  "  addq $8, %rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  ".size fcio_fiber_switch, .-fcio_fiber_switch\n"
+);
+
+# define fiber_switch(from, to)  fcio_fiber_switch((from), (to))
+
+#else
+
+# define fiber_switch(from, to)  swapcontext(&(from)->uc, &(to)->uc)
+
+#endif
+
+/* The first thing every fiber runs.  When `func` returns, the fiber is marked done, and the scheduler releases its stack. */
+static _NO_RETURN void fiber_entry(void) {
+  FIBER_SCHED sched = current_sched;
+  Fiber *f = sched->current;
+  f->func(f->arg);
+  f->done = TRUE;
+  fiber_switch(&f->ctx, &sched->ctx);
+  __builtin_unreachable();
+}
+
+/* Set up `f` so that the first switch to it starts `fiber_entry()` on its own stack. */
+static void fiber_context_init(Fiber *f) {
+  ASSERT(f);
+#if defined(__x86_64__)
+  /* The fiber struct sits right above the stack and is 64 byte aligned, so the top is as well. */
+  void **sp = (void **)f;
+  Uint *csr;
+  /* So that `rsp` is 8 mod 16 at the start of `fiber_entry()`, as if it was called. */
+  *--sp = NULL;
+  /* The return address, stored as an integer, as ISO C has no conversion from a function ptr to `void *`. */
+  *(Ulong *)--sp = (Ulong)fiber_entry;
+  /* rbp, rbx, r12 - r15. */
+  for (int i=0; i<6; ++i) {
+    *--sp = NULL;
+  }
+  --sp;
+  csr = (Uint *)sp;
+  __asm__ volatile ("stmxcsr %0" : "=m" (csr[0]));
+  __asm__ volatile ("fnstcw %0" : "=m" (csr[1]));
+  f->ctx.sp = sp;
+#else
+  if (getcontext(&f->ctx.uc) < 0) {
+    die_callback("Failed when calling 'getcontext': %s\n", strerror(errno));
+  }
+  f->ctx.uc.uc_stack.ss_sp   = (f->map + f->sched->page_size);
+  f->ctx.uc.uc_stack.ss_size = ((char *)f - (f->map + f->sched->page_size));
+  f->ctx.uc.uc_link          = NULL;
+  makecontext(&f->ctx.uc, fiber_entry, 0);
+#endif
+}
+
+/* Return's the running fiber.  Note that this must only be used from inside a fiber. */
+static inline Fiber *fiber_self(void) {
+  ALWAYS_ASSERT_MSG((current_sched && current_sched->current), "Must be called from a fiber");
+  return current_sched->current;
+}
+
+/* ----------------------------- Fiber list ----------------------------- */
+
+static void fiber_list_push(FiberList *const list, Fiber *f) {
+  f->next = NULL;
+  if (list->tail) {
+    list->tail->next = f;
+  }
+  else {
+    list->head = f;
+  }
+  list->tail = f;
+}
+
+static Fiber *fiber_list_pop(FiberList *const list) {
+  Fiber *f = list->head;
+  if (f) {
+    list->head = f->next;
+    if (!list->head) {
+      list->tail = NULL;
+    }
+    f->next = NULL;
+  }
+  return f;
+}
+
+/* ----------------------------- Stacks ----------------------------- */
+
+/* Return's a fiber with a stack, reusing a pooled one when possible. */
+static Fiber *fiber_alloc(FIBER_SCHED sched) {
+  ASSERT_FIBER_SCHED(sched);
+  Fiber *f;
+  char *map;
+  Ulong size;
+  if (sched->pool) {
+    f = sched->pool;
+    sched->pool = f->next;
+    --sched->npool;
+    return f;
+  }
+  /* The guard page goes first, as the stack grows down towards it. */
+  size = (sched->stack_size + sched->page_size);
+  map = mmap(NULL, size, (PROT_READ | PROT_WRITE), (MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK), -1, 0);
+  if (map == MAP_FAILED) {
+    die_callback("Failed to map a fiber stack: %s\n", strerror(errno));
+  }
+  if (mprotect(map, sched->page_size, PROT_NONE) < 0) {
+    die_callback("Failed to protect the guard page of a fiber stack: %s\n", strerror(errno));
+  }
+  f = (Fiber *)(map + ((size - sizeof(*f)) & ~(Ulong)63));
+  f->map      = map;
+  f->map_size = size;
+  return f;
+}
+
+static void fiber_release(FIBER_SCHED sched, Fiber *f) {
+  ASSERT_FIBER_SCHED(sched);
+  ASSERT(f);
+  if (f->all_prev) {
+    f->all_prev->all_next = f->all_next;
+  }
+  else {
+    sched->all = f->all_next;
+  }
+  if (f->all_next) {
+    f->all_next->all_prev = f->all_prev;
+  }
+  --sched->nfibers;
+  if (sched->npool < FIBER_STACK_POOL_MAX) {
+    f->next = sched->pool;
+    sched->pool = f;
+    ++sched->npool;
+  }
+  else {
+    munmap(f->map, f->map_size);
+  }
+}
+
+/* ----------------------------- Scheduling ----------------------------- */
+
+static void fiber_make_runnable(FIBER_SCHED sched, Fiber *f) {
+  fiber_list_push(&sched->runq, f);
+}
+
+/* Switch from the running fiber back to the scheduler.  Something must already have arranged for it to be made runnable again. */
+static void fiber_suspend(Fiber *f) {
+  fiber_switch(&f->ctx, &f->sched->ctx);
+}
+
+static void fiber_resume(FIBER_SCHED sched, Fiber *f) {
+  sched->current = f;
+  fiber_switch(&sched->ctx, &f->ctx);
+  sched->current = NULL;
+  if (f->done) {
+    fiber_release(sched, f);
+  }
+}
+
+/* Called when the fd or the timer `f` was waiting on fired.  Whichever did not fire is disarmed. */
+static void fiber_wake_waiter(FIBER_SCHED sched, Fiber *f, Uint revents) {
+  if (f->timer) {
+    pqueue_remove(sched->timers, f->timer);
+    f->timer = NULL;
+  }
+  if (f->wait_fd >= 0) {
+    /* The wait is oneshot, so when the fd fired it's already disarmed, otherwise remove it so it can never wake a stale fiber. */
+    if (!revents) {
+      epoll_ctl(sched->efd, EPOLL_CTL_DEL, f->wait_fd, NULL);
+    }
+    f->wait_fd = -1;
+  }
+  f->revents = revents;
+  fiber_make_runnable(sched, f);
+}
+
+static void fiber_sched_drain_posts(FIBER_SCHED sched) {
+  FiberPost *post;
+  while (mpmc_try_pop(sched->posts, (void **)&post)) {
+    fiber_spawn(sched, post->func, post->arg);
+    free(post);
+  }
+}
+
+/* Return's the epoll timeout in milliseconds until the next timer, rounded up so we never wake early. */
+static int fiber_sched_timeout(FIBER_SCHED sched) {
+  Llong deadline;
+  Llong now;
+  if (sched->runq.head) {
+    return 0;
+  }
+  if (!pqueue_size(sched->timers)) {
+    return -1;
+  }
+  pqueue_peek(sched->timers, &deadline);
+  now = hiactime_now_ns();
+  if (deadline <= now) {
+    return 0;
+  }
+  deadline = ((deadline - now + 999999) / 1000000);
+  return ((deadline > INT_MAX) ? INT_MAX : (int)deadline);
+}
+
+/* Block until a fd or a timer fires, or something is posted, and make every fiber that was waiting on it runnable. */
+static void fiber_sched_poll(FIBER_SCHED sched) {
+  struct epoll_event events[FIBER_EPOLL_BATCH];
+  Ulong val;
+  Llong now;
+  Fiber *f;
+  int n = epoll_wait(sched->efd, events, FIBER_EPOLL_BATCH, fiber_sched_timeout(sched));
+  if (n < 0 && errno != EINTR) {
+    die_callback("Failed when calling 'epoll_wait': %s\n", strerror(errno));
+  }
+  for (int i=0; i<n; ++i) {
+    if (!events[i].data.ptr) {
+      read(sched->wfd, &val, sizeof(val));
+      fiber_sched_drain_posts(sched);
+    }
+    else {
+      fiber_wake_waiter(sched, events[i].data.ptr, events[i].events);
+    }
+  }
+  now = hiactime_now_ns();
+  while (pqueue_pop_if_le(sched->timers, now, (void **)&f)) {
+    f->timer = NULL;
+    fiber_wake_waiter(sched, f, 0);
+  }
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Scheduler ----------------------------- */
+
+/* Create a fiber scheduler, where every fiber gets a stack of `stack_size` bytes, or 64 KiB when zero.  Note that only the pages a fiber
+ * actually touches are ever backed by memory. */
+FIBER_SCHED fiber_sched_create(Ulong stack_size) {
+  FIBER_SCHED sched = xmalloc(sizeof(*sched));
+  struct epoll_event ev;
+  sched->page_size  = (Ulong)sysconf(_SC_PAGESIZE);
+  sched->stack_size = (!stack_size ? FIBER_DEFAULT_STACK_SIZE : (stack_size < FIBER_MIN_STACK_SIZE) ? FIBER_MIN_STACK_SIZE : stack_size);
+  sched->stack_size = ((sched->stack_size + sched->page_size - 1) & ~(sched->page_size - 1));
+  sched->current    = NULL;
+  sched->runq.head  = NULL;
+  sched->runq.tail  = NULL;
+  sched->all        = NULL;
+  sched->nfibers    = 0;
+  sched->pool       = NULL;
+  sched->npool      = 0;
+  sched->running    = FALSE;
+  sched->timers     = pqueue_create();
+  sched->posts      = mpmc_create(FIBER_POST_CAP);
+  mpmc_set_free_func(sched->posts, free);
+  if ((sched->efd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    die_callback("Failed when calling 'epoll_create1': %s\n", strerror(errno));
+  }
+  if ((sched->wfd = eventfd(0, (EFD_CLOEXEC | EFD_NONBLOCK))) < 0) {
+    die_callback("Failed when calling 'eventfd': %s\n", strerror(errno));
+  }
+  ev.events   = EPOLLIN;
+  ev.data.ptr = NULL;
+  if (epoll_ctl(sched->efd, EPOLL_CTL_ADD, sched->wfd, &ev) < 0) {
+    die_callback("Failed when calling 'epoll_ctl': %s\n", strerror(errno));
+  }
+  return sched;
+}
+
+/* Free `sched`.  Any fibers still blocked are dropped without ever being resumed.  Note that this must not be called while it runs. */
+void fiber_sched_free(FIBER_SCHED sched) {
+  Fiber *f;
+  if (!sched) {
+    return;
+  }
+  ALWAYS_ASSERT_MSG(!sched->running, "A running fiber scheduler cannot be freed");
+  while ((f = sched->all)) {
+    sched->all = f->all_next;
+    munmap(f->map, f->map_size);
+  }
+  while ((f = sched->pool)) {
+    sched->pool = f->next;
+    munmap(f->map, f->map_size);
+  }
+  pqueue_free(sched->timers);
+  mpmc_free(sched->posts);
+  close(sched->efd);
+  close(sched->wfd);
+  free(sched);
+}
+
+/* Run fibers on the calling thread until every fiber spawned on `sched` has finished.  Note that while fibers are blocked on channels
+ * only, this waits for work to be posted, as that is the only thing that could ever wake them. */
+void fiber_sched_run(FIBER_SCHED sched) {
+  ASSERT_FIBER_SCHED(sched);
+  ALWAYS_ASSERT_MSG(!current_sched, "Fiber schedulers cannot be nested");
+  FiberList batch;
+  Fiber *f;
+  current_sched  = sched;
+  sched->running = TRUE;
+  fiber_sched_drain_posts(sched);
+  while (sched->nfibers) {
+    /* Run everything that is runnable now.  Fibers that yield go to the next round, so the fds and timers are never starved. */
+    batch = sched->runq;
+    sched->runq.head = NULL;
+    sched->runq.tail = NULL;
+    while ((f = fiber_list_pop(&batch))) {
+      fiber_resume(sched, f);
+    }
+    if (sched->nfibers) {
+      fiber_sched_poll(sched);
+    }
+  }
+  sched->running = FALSE;
+  current_sched  = NULL;
+}
+
+/* Spawn a fiber running `func` with `arg` on `sched`.  Note that this must be called from the thread that runs `sched`, or before it
+ * runs, use `fiber_sched_post()` from any other thread. */
+void fiber_spawn(FIBER_SCHED sched, void (*func)(void *), void *arg) {
+  ASSERT_FIBER_SCHED(sched);
+  ASSERT(func);
+  Fiber *f = fiber_alloc(sched);
+  f->sched    = sched;
+  f->func     = func;
+  f->arg      = arg;
+  f->timer    = NULL;
+  f->wait_fd  = -1;
+  f->revents  = 0;
+  f->value    = NULL;
+  f->ok       = FALSE;
+  f->done     = FALSE;
+  f->all_prev = NULL;
+  f->all_next = sched->all;
+  if (sched->all) {
+    sched->all->all_prev = f;
+  }
+  sched->all = f;
+  ++sched->nfibers;
+  fiber_context_init(f);
+  fiber_make_runnable(sched, f);
+}
+
+/* Spawn a fiber running `func` with `arg` on `sched` from any thread.  The scheduler is woken if it's blocked. */
+void fiber_sched_post(FIBER_SCHED sched, void (*func)(void *), void *arg) {
+  ASSERT_FIBER_SCHED(sched);
+  ASSERT(func);
+  Ulong val = 1;
+  FiberPost *post = xmalloc(sizeof(*post));
+  post->func = func;
+  post->arg  = arg;
+  mpmc_push(sched->posts, post);
+  write(sched->wfd, &val, sizeof(val));
+}
+
+/* ----------------------------- Fiber ----------------------------- */
+
+/* Return's `TRUE` when the calling code runs inside a fiber. */
+bool fiber_in_fiber(void) {
+  return (current_sched && current_sched->current);
+}
+
+/* Let every other runnable fiber run before the calling fiber continues. */
+void fiber_yield(void) {
+  Fiber *f = fiber_self();
+  fiber_make_runnable(f->sched, f);
+  fiber_suspend(f);
+}
+
+/* Suspend the calling fiber until `deadline_ns`, on the `hiactime_now_ns()` clock. */
+void fiber_sleep_until(Llong deadline_ns) {
+  Fiber *f = fiber_self();
+  f->timer = pqueue_push(f->sched->timers, deadline_ns, f);
+  fiber_suspend(f);
+}
+
+/* Suspend the calling fiber for `ns` nanoseconds. */
+void fiber_sleep_ns(Llong ns) {
+  fiber_sleep_until(hiactime_now_ns() + ns);
+}
+
+/* Suspend the calling fiber until `fd` is ready for `events`, or for at most `timeout_ns` nanoseconds when not negative.  Return's the
+ * ready epoll events, or zero on timeout.  Note that only one fiber at a time may wait on a given fd.  Regular files can't be polled,
+ * and are always ready, so for those `events` is returned right away. */
+Uint fiber_wait_fd(int fd, Uint events, Llong timeout_ns) {
+  Fiber *f = fiber_self();
+  FIBER_SCHED sched = f->sched;
+  struct epoll_event ev;
+  ev.events   = (events | EPOLLONESHOT);
+  ev.data.ptr = f;
+  /* A fd that was waited on before is still registered, only disarmed. */
+  if (epoll_ctl(sched->efd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+    if (errno != ENOENT || epoll_ctl(sched->efd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      if (errno == EPERM) {
+        return events;
+      }
+      die_callback("Failed when calling 'epoll_ctl': %s\n", strerror(errno));
+    }
+  }
+  f->wait_fd = fd;
+  if (timeout_ns >= 0) {
+    f->timer = pqueue_push(sched->timers, (hiactime_now_ns() + timeout_ns), f);
+  }
+  fiber_suspend(f);
+  return f->revents;
+}
+
+/* ----------------------------- Channel ----------------------------- */
+
+/* Create a channel that buffers up to `cap` values.  When `cap` is zero, every send waits for a matching receive. */
+FIBER_CHAN fiber_chan_create(Ulong cap) {
+  FIBER_CHAN ch = xmalloc(sizeof(*ch));
+  ch->buf            = xmalloc(_PTRSIZE * (cap ? cap : 1));
+  ch->cap            = cap;
+  ch->head           = 0;
+  ch->len            = 0;
+  ch->senders.head   = NULL;
+  ch->senders.tail   = NULL;
+  ch->receivers.head = NULL;
+  ch->receivers.tail = NULL;
+  ch->closed         = FALSE;
+  return ch;
+}
+
+/* Free `ch`.  Note that no fiber may be waiting on it.  No-op on `NULL`. */
+void fiber_chan_free(FIBER_CHAN ch) {
+  if (!ch) {
+    return;
+  }
+  ALWAYS_ASSERT_MSG((!ch->senders.head && !ch->receivers.head), "Fibers are still waiting on the channel");
+  free(ch->buf);
+  free(ch);
+}
+
+/* Send `value` through `ch`, suspending the calling fiber while the channel is full.  Return's `FALSE` when `ch` is closed. */
+bool fiber_chan_send(FIBER_CHAN ch, void *value) {
+  ASSERT_FIBER_CHAN(ch);
+  Fiber *f = fiber_self();
+  Fiber *receiver;
+  if (ch->closed) {
+    return FALSE;
+  }
+  if ((receiver = fiber_list_pop(&ch->receivers))) {
+    receiver->value = value;
+    receiver->ok    = TRUE;
+    fiber_make_runnable(f->sched, receiver);
+    return TRUE;
+  }
+  if (ch->len < ch->cap) {
+    ch->buf[(ch->head + ch->len++) % ch->cap] = value;
+    return TRUE;
+  }
+  f->value = value;
+  fiber_list_push(&ch->senders, f);
+  fiber_suspend(f);
+  return f->ok;
+}
+
+/* Receive the next value from `ch` into `*out`, suspending the calling fiber while it's empty.  Return's `FALSE` once `ch` is closed
+ * and all buffered values have been received. */
+bool fiber_chan_recv(FIBER_CHAN ch, void **const out) {
+  ASSERT_FIBER_CHAN(ch);
+  ASSERT(out);
+  Fiber *f = fiber_self();
+  Fiber *sender;
+  if (ch->len) {
+    *out = ch->buf[ch->head];
+    ch->head = ((ch->head + 1) % ch->cap);
+    --ch->len;
+    /* Move the first waiting sender's value into the slot we just freed. */
+    if ((sender = fiber_list_pop(&ch->senders))) {
+      ch->buf[(ch->head + ch->len++) % ch->cap] = sender->value;
+      sender->ok = TRUE;
+      fiber_make_runnable(f->sched, sender);
+    }
+    return TRUE;
+  }
+  /* Unbuffered, so take the value straight from the sender. */
+  if ((sender = fiber_list_pop(&ch->senders))) {
+    *out = sender->value;
+    sender->ok = TRUE;
+    fiber_make_runnable(f->sched, sender);
+    return TRUE;
+  }
+  if (ch->closed) {
+    return FALSE;
+  }
+  fiber_list_push(&ch->receivers, f);
+  fiber_suspend(f);
+  if (f->ok) {
+    *out = f->value;
+  }
+  return f->ok;
+}
+
+/* Close `ch`.  All waiting receivers and senders are woken and fail, while values already buffered can still be received. */
+void fiber_chan_close(FIBER_CHAN ch) {
+  ASSERT_FIBER_CHAN(ch);
+  Fiber *f;
+  ch->closed = TRUE;
+  while ((f = fiber_list_pop(&ch->receivers))) {
+    f->ok = FALSE;
+    fiber_make_runnable(f->sched, f);
+  }
+  while ((f = fiber_list_pop(&ch->senders))) {
+    f->ok = FALSE;
+    fiber_make_runnable(f->sched, f);
+  }
+}
+
+#endif
@@ -14,6 +14,10 @@
 #define EVENT_SIZE    			(sizeof(struct inotify_event))
 #define EVENT_BUF_LEN 			(1024 * (EVENT_SIZE + 16))
 
+/* The max number of callback events that can be pending at once, and the number the cb-thread pops at a time. */
+#define EVENT_QUEUE_CAP  (4096)
+#define EVENT_BATCH      (64)
+
 #define SENTINAL_RM      (-1)
 #define SENTINAL_EV      (-2)
 #define SENTINAL_UPDATE  (-3)
@@ -47,9 +51,8 @@ struct FILE_LISTENER_NODE_T {
 struct FILE_LISTENER_T {
   HNMAP    wfds;
   HMAP_PH  nodes;
-  QUEUE    queue;
-  mutex_t  mutex;
-  cond_t   cond;
+  /* The epoll-thread is the only producer and the cb-thread the only consumer, so no lock is needed. */
+  SPSC     queue;
   bool     running_cb;
   bool     running_epoll;
   int      ifd;
@@ -78,19 +81,26 @@ static void epoll_add_fd(int efd, int fd, void *ptr) {
 
 /* ----------------------------- FILE_LISTENER ----------------------------- */
 
-/* The only way an callback event should be enqueued, as this is mutex protected. */
-static void file_listener_enqueue_callback(FILE_LISTENER fl, FILE_LISTENER_CB callback, void *data, Uint mask) {
-  ASSERT(fl);
+/* Create a callback event.  Note that the cb-thread frees the event after it has been processed. */
+static FILE_LISTENER_EVENT file_listener_event_create(FILE_LISTENER_CB callback, void *data, Uint mask) {
   ASSERT(callback);
   FILE_LISTENER_EVENT ev = xmalloc(sizeof(*ev));
   ev->callback = callback;
   ev->data     = data;
   ev->mask     = mask;
-  /* Push the event into the file-listener's queue. */
-  MUTEX_ACTION(&fl->mutex,
-    queue_push(fl->queue, ev);
-    cond_signal(&fl->cond);
-  );
+  return ev;
+}
+
+/* The only way callback events should be enqueued.  Note that this must only ever be called from one thread at a
+ * time, as the queue is single-producer.  All `n` events are published at once, unless the queue fills up, in which
+ * case the rest are pushed one at a time, parking until the cb-thread has caught up. */
+static void file_listener_enqueue_events(FILE_LISTENER fl, FILE_LISTENER_EVENT *const evs, Ulong n) {
+  ASSERT(fl);
+  ASSERT(evs);
+  Ulong pushed = spsc_push_many(fl->queue, (void *const *)evs, n);
+  while (pushed < n) {
+    spsc_push(fl->queue, evs[pushed++]);
+  }
 }
 
 /* The only way a node should be removed, as this ensures the epoll thread itself handles all cleanup. */
@@ -151,9 +161,11 @@ static void file_listener_shutdown_epoll(FILE_LISTENER fl) {
   pthread_join(fl->thread_epoll, NULL);
 }
 
+/* Note that this must be called after the epoll-thread has been joined, as we become the producer. */
 static void file_listener_shutdown_cb(FILE_LISTENER fl) {
   ASSERT(fl);
-  file_listener_enqueue_callback(fl, (FILE_LISTENER_CB)file_listener_cb_kill_sentinal, fl, 0);
+  FILE_LISTENER_EVENT ev = file_listener_event_create((FILE_LISTENER_CB)file_listener_cb_kill_sentinal, fl, 0);
+  file_listener_enqueue_events(fl, &ev, 1);
   pthread_join(fl->thread_cb, NULL);
 }
 
@@ -162,23 +174,16 @@ static void file_listener_shutdown_cb(FILE_LISTENER fl) {
 /* The main listener's loop, this simply processes enqueued callbacks made by all nodes. */
 static void *file_listener_thread_loop_cb(FILE_LISTENER fl) {
   ASSERT(fl);
-  FILE_LISTENER_EVENT ev;
+  FILE_LISTENER_EVENT evs[EVENT_BATCH];
+  Ulong n;
+  /* The only way `running_cb` is set to false is via the kill sentinal callback, which is always the last event. */
   while (fl->running_cb) {
-    mutex_lock(&fl->mutex);
-    /* TODO: We should not need these running checks, as the only way its set to false is via a callback... */
-    while (!queue_size(fl->queue) && fl->running_cb) {
-      cond_wait(&fl->cond, &fl->mutex);
-    }
-    if (!fl->running_cb) {
-      mutex_unlock(&fl->mutex);
-      break;
+    n = spsc_pop_many_wait(fl->queue, (void **)evs, ARRAY_SIZE(evs));
+    /* Process the events. */
+    for (Ulong i=0; i<n; ++i) {
+      evs[i]->callback(evs[i]->data, evs[i]->mask);
+      free(evs[i]);
     }
-    ev = queue_front(fl->queue);
-    queue_pop(fl->queue);
-    mutex_unlock(&fl->mutex);
-    /* Process the event. */
-    ev->callback(ev->data, ev->mask);
-    free(ev);
   }
   return NULL;
 }
@@ -193,6 +198,8 @@ static void *file_listener_thread_loop_epoll(FILE_LISTENER fl) {
   char buf[EVENT_BUF_LEN];
   long len;
   struct inotify_event *ev;
+  FILE_LISTENER_EVENT evs[EVENT_BUF_LEN / EVENT_SIZE];
+  Ulong nevs;
   while (fl->running_epoll) {
     n = epoll_wait(fl->efd, events, 64, -1);
     for (int i=0; i<n; ++i) {
@@ -232,13 +239,16 @@ static void *file_listener_thread_loop_epoll(FILE_LISTENER fl) {
         if (len < 0) {
           die_callback("Failed to read inotify fd.\n");
         }
+        nevs = 0;
         for (long ei=0; ei<len;) {
           ev = (struct inotify_event *)&buf[ei];
           if ((wnode = hnmap_get(fl->wfds, ev->wd))) {
-            file_listener_enqueue_callback(fl, wnode->callback, wnode->data, ev->mask);
+            evs[nevs++] = file_listener_event_create(wnode->callback, wnode->data, ev->mask);
           }
           ei += (EVENT_SIZE + ev->len);
         }
+        /* Publish all events from this read at once. */
+        file_listener_enqueue_events(fl, evs, nevs);
       }
       /* TODO: We should always terminate here, as this should never happen. */
     }
@@ -287,9 +297,7 @@ FILE_LISTENER file_listener_create(void) {
   fl->wfds  = hnmap_create();
   fl->nodes = hmap_ph_create();
   hmap_ph_set_free_func(fl->nodes, (void (*)(void *))file_listener_node_free);
-  fl->queue = queue_create();
-  mutex_init(&fl->mutex, NULL);
-  cond_init(&fl->cond, NULL);
+  fl->queue = spsc_create(EVENT_QUEUE_CAP);
   if ((fl->ifd = inotify_init1(IN_NONBLOCK)) < 0) {
     die_callback("Failed when calling 'inotify_init1': %s\n", strerror(errno));
   }
@@ -303,11 +311,9 @@ void file_listener_kill(FILE_LISTENER fl) {
   /* Kill both thread-loop's. */
   file_listener_shutdown_epoll(fl);
   file_listener_shutdown_cb(fl);
-  mutex_destroy(&fl->mutex);
-  cond_destroy(&fl->cond);
   hnmap_free(fl->wfds);
   hmap_ph_free(fl->nodes);
-  queue_free(fl->queue);
+  spsc_free(fl->queue);
   /* Close both epoll fd's. */
   close(fl->efd);
   close(fl->kfd);
@@ -317,6 +323,14 @@ void file_listener_kill(FILE_LISTENER fl) {
   free(fl);
 }
 
+/* Restrict both threads of `fl` to the cpu's of numa `node`, so they stay close to the data the callbacks touch.
+ * Return's `FALSE` when either thread could not be moved. */
+bool file_listener_pin_to_node(FILE_LISTENER fl, int node) {
+  ASSERT(fl);
+  bool ret = thread_pin_to_node(fl->thread_epoll, node);
+  return (thread_pin_to_node(fl->thread_cb, node) && ret);
+}
+
 void file_listener_add_file(FILE_LISTENER fl,
   const char *const restrict file, FILE_LISTENER_CB cb, void *data, Uint mask)
 {
@@ -0,0 +1,90 @@
+/** @file fmutex.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Adaptive mutex on a single futex word.  The word is 0 when unlocked, 1 when locked, and 2 when locked with threads
+  that may be parked.  An uncontended lock and unlock are a single atomic each, and never enter the kernel.  A contended
+  lock spins for a short while first, as most critical sections end before a park and wake could even complete, and
+  only then parks.  Unlock only makes a syscall when someone might be parked, and then wakes exactly one thread.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+#include "../include/statics.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+#define FMUTEX_UNLOCKED  (0)
+#define FMUTEX_LOCKED    (1)
+#define FMUTEX_PARKED    (2)
+
+/* The number of `pause` rounds a contended lock spins for before it parks. */
+#ifndef FMUTEX_SPIN_COUNT
+# define FMUTEX_SPIN_COUNT  (100)
+#endif
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+static void fmutex_lock_slow(fmutex_t *const m) {
+  Uint state;
+  for (int i=0; i<FMUTEX_SPIN_COUNT; ++i) {
+    state = __atomic_load_n(&m->state, __ATOMIC_RELAXED);
+    if (state == FMUTEX_UNLOCKED) {
+      if (__atomic_compare_exchange_n(&m->state, &state, FMUTEX_LOCKED, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+      }
+    }
+    /* Others are already parked, so the lock is held for long enough that spinning is just wasted cpu. */
+    else if (state == FMUTEX_PARKED) {
+      break;
+    }
+    CPU_RELAX();
+  }
+  /* From here on we take the lock as parked, as we can't know if we are the last waiter.  At worst, this makes one unlock
+   * do a needless wake. */
+  while (__atomic_exchange_n(&m->state, FMUTEX_PARKED, __ATOMIC_ACQUIRE) != FMUTEX_UNLOCKED) {
+    futex_wait(&m->state, FMUTEX_PARKED, NULL);
+  }
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+void fmutex_init(fmutex_t *const m) {
+  ASSERT(m);
+  m->state = FMUTEX_UNLOCKED;
+}
+
+/* Lock `m`, spinning briefly and then parking while it's held by another thread.  Note that `m` is not recursive. */
+void fmutex_lock(fmutex_t *const m) {
+  ASSERT(m);
+  Uint state = FMUTEX_UNLOCKED;
+  if (!__atomic_compare_exchange_n(&m->state, &state, FMUTEX_LOCKED, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    fmutex_lock_slow(m);
+  }
+}
+
+/* Lock `m` only when it's free.  Return's `TRUE` when the lock was taken. */
+bool fmutex_trylock(fmutex_t *const m) {
+  ASSERT(m);
+  Uint state = FMUTEX_UNLOCKED;
+  return __atomic_compare_exchange_n(&m->state, &state, FMUTEX_LOCKED, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Unlock `m`, waking one parked thread if there is any.  Note that this must only be called by the holder. */
+void fmutex_unlock(fmutex_t *const m) {
+  ASSERT(m);
+  if (__atomic_exchange_n(&m->state, FMUTEX_UNLOCKED, __ATOMIC_RELEASE) == FMUTEX_PARKED) {
+    futex_wake(&m->state, 1);
+  }
+}
+
+#endif
@@ -5,99 +5,498 @@
 
  */
 #include "../include/proto.h"
+#include "../include/statics.h"
 
 
 #if !__WIN__
 
 
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* The status of a future is kept in the low bits of its state word. */
+#define FUTURE_PENDING     (0U)  /* Not started, can still be canceled. */
+#define FUTURE_RUNNING     (1U)  /* Claimed by whoever will complete it. */
+#define FUTURE_READY       (2U)
+#define FUTURE_CANCELED    (3U)
+#define FUTURE_STATUS      (3U)
+/* Set when at least one thread is parked on the state word. */
+#define FUTURE_WAITERS     (1U << 2)
+/* Set by `future_cancel()` when the task was already running, for the task to poll. */
+#define FUTURE_CANCEL_REQ  (1U << 3)
+
+#define FUTURE_IS_DONE(state)  (((state) & FUTURE_STATUS) >= FUTURE_READY)
+
+/* The continuation list of a done future is set to this, so that a continuation added after that runs right away. */
+#define FUTURE_CONTS_CLOSED  ((FutureCont *)1)
+
+/* The max number of released futures each thread keeps for reuse. */
+#define FUTURE_CACHE_MAX  (64)
+
+
 /* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
 
 
-/* Opaque future structure for threaded operations. */
+/* A callback to run once a future is done. */
+typedef struct FutureCont {
+  struct FutureCont *next;
+  void (*func)(Future *future, void *arg);
+  void *arg;
+} FutureCont;
+
+/* Opaque future structure for threaded operations.  All synchronization goes through `state`, the result is written before `state`
+ * is set to done with a release store, so a single acquire load of `state` is all it takes to know if `result` can be read. */
 struct Future {
-  mutex_t mutex;   /* Mutex to protect setting `result` and `ready`. */
-  cond_t  cond;    /* Condition to signal when `result` is ready. */
-  bool    ready;   /* Flag to tell potention listeners (or checkers) that the data is ready to be read. */
+  Uint    state;
+  Uint    refs;    /* The caller holds one reference, and so does the task and every pending continuation. */
   void   *result;  /* Ptr to the data. */
+  void *(*task)(void *);
+  void   *arg;
+  FutureCont *conts;  /* Lock-free stack of callbacks to run once done. */
+  Future *next;       /* Link in the per-thread cache. */
 };
 
+/* The state of a `future_then()` continuation. */
 typedef struct {
-  Future *future;
-  void *(*task)(void *);
+  Future *out;
+  void *(*func)(void *result, void *arg);
   void *arg;
-} FutureTask;
+  void *result;
+} FutureThen;
+
+/* The shared state of a `future_when_all()` or `future_when_any()`. */
+typedef struct {
+  Future *out;
+  Future **futures;
+  Ulong n;
+  Ulong remaining;
+  bool done;
+} FutureJoin;
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+/* When `TRUE`, `future_submit()` creates a detached thread per task, instead of running it on the default pool. */
+static bool thread_per_task = FALSE;
+
+/* Released futures kept by this thread for reuse. */
+static _THREAD Future *future_cache = NULL;
+static _THREAD Uint future_cache_len = 0;
+
+/* Used to free the cache of a thread when it exits. */
+static pthread_key_t future_cache_key;
+static pthread_once_t future_cache_once = PTHREAD_ONCE_INIT;
+
+/* The future whose task the calling thread is running, if any. */
+static _THREAD Future *current_future = NULL;
 
 
 /* ---------------------------------------------------------- Function's ---------------------------------------------------------- */
 
 
-/* Create a allocated `Future` structure. */
-static Future *future_create(void) {
-  Future *future = xmalloc(sizeof(*future));
-  mutex_init(&future->mutex, NULL);
-  cond_init(&future->cond, NULL);
-  future->ready  = FALSE;
+/* ----------------------------- Cache ----------------------------- */
+
+static void future_cache_destroy(void *_UNUSED arg) {
+  Future *next;
+  while (future_cache) {
+    next = future_cache->next;
+    free(future_cache);
+    future_cache = next;
+  }
+  future_cache_len = 0;
+}
+
+static void future_cache_key_create(void) {
+  ALWAYS_ASSERT(pthread_key_create(&future_cache_key, future_cache_destroy) == 0);
+}
+
+/* Keep `future` for reuse by this thread, or free it when the cache is full. */
+static void future_cache_put(Future *future) {
+  if (future_cache_len == FUTURE_CACHE_MAX) {
+    free(future);
+    return;
+  }
+  /* Make sure the cache of this thread is freed when it exits, the value only needs to be non `NULL`. */
+  if (!future_cache_len) {
+    pthread_once(&future_cache_once, future_cache_key_create);
+    pthread_setspecific(future_cache_key, &future_cache);
+  }
+  future->next = future_cache;
+  future_cache = future;
+  ++future_cache_len;
+}
+
+/* ----------------------------- State ----------------------------- */
+
+/* Create a future for `task` with `arg`, holding `refs` references, reusing a cached one when possible. */
+static Future *future_create(void *(*task)(void *), void *arg, Uint refs) {
+  Future *future;
+  if (future_cache) {
+    future = future_cache;
+    future_cache = future->next;
+    --future_cache_len;
+  }
+  else {
+    future = xmalloc(sizeof(*future));
+  }
+  future->state  = FUTURE_PENDING;
+  future->refs   = refs;
   future->result = NULL;
+  future->task   = task;
+  future->arg    = arg;
+  future->conts  = NULL;
   return future;
 }
 
-/* Function that runs the future task and set the result and the ready flag, then signals the cond. */
-static void *future_task_callback(void *arg) {
+static void future_retain(Future *future) {
+  __atomic_add_fetch(&future->refs, 1, __ATOMIC_RELAXED);
+}
+
+/* Move `future` from pending to running.  Return's `FALSE` when it was canceled first. */
+static bool future_claim(Future *future) {
+  Uint state = __atomic_load_n(&future->state, __ATOMIC_RELAXED);
+  do {
+    if ((state & FUTURE_STATUS) != FUTURE_PENDING) {
+      return FALSE;
+    }
+  } while (!__atomic_compare_exchange_n(&future->state, &state, ((state & ~FUTURE_STATUS) | FUTURE_RUNNING), TRUE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+  return TRUE;
+}
+
+/* Publish `status` as the final status of a claimed `future`, waking all parked waiters, then run all continuations. */
+static void future_finish(Future *future, Uint status) {
+  FutureCont *conts;
+  FutureCont *next;
+  if (__atomic_exchange_n(&future->state, status, __ATOMIC_ACQ_REL) & FUTURE_WAITERS) {
+    futex_wake(&future->state, INT_MAX);
+  }
+  conts = __atomic_exchange_n(&future->conts, FUTURE_CONTS_CLOSED, __ATOMIC_ACQ_REL);
+  while (conts) {
+    next = conts->next;
+    conts->func(future, conts->arg);
+    free(conts);
+    conts = next;
+  }
+}
+
+/* Complete a claimed `future` with `result`. */
+static void future_complete(Future *future, void *result) {
+  future->result = result;
+  future_finish(future, FUTURE_READY);
+}
+
+/* Run `func` with `future` and `arg` on the thread that finishes `future`, or right away on the calling thread if it already is done.
+ * This is only meant for short non-blocking callbacks, real work should be submitted to the pool from the callback.  Note that this
+ * takes a reference to `future` on behalf of `func`, which `func` must release with `future_free()` when done with it. */
+static void future_on_ready(Future *future, void (*func)(Future *, void *), void *arg) {
+  FutureCont *cont = xmalloc(sizeof(*cont));
+  cont->func = func;
+  cont->arg  = arg;
+  future_retain(future);
+  cont->next = __atomic_load_n(&future->conts, __ATOMIC_ACQUIRE);
+  do {
+    if (cont->next == FUTURE_CONTS_CLOSED) {
+      func(future, arg);
+      free(cont);
+      return;
+    }
+  } while (!__atomic_compare_exchange_n(&future->conts, &cont->next, cont, TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+}
+
+/* Park until `future` is done, or until the monotonic time `deadline_ns` when it's not negative.  Return's `FALSE` on timeout. */
+static bool future_wait(Future *future, Llong deadline_ns) {
+  struct timespec timeout;
+  Uint state = __atomic_load_n(&future->state, __ATOMIC_ACQUIRE);
+  Llong remaining;
+  while (!FUTURE_IS_DONE(state)) {
+    /* Register as a waiter, so the completer knows to issue the wake. */
+    if (!(state & FUTURE_WAITERS) && !__atomic_compare_exchange_n(&future->state, &state, (state | FUTURE_WAITERS), FALSE, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+      continue;
+    }
+    if (deadline_ns < 0) {
+      futex_wait(&future->state, (state | FUTURE_WAITERS), NULL);
+    }
+    else {
+      if ((remaining = (deadline_ns - hiactime_now_ns())) <= 0) {
+        return FALSE;
+      }
+      timeout.tv_sec  = (remaining / 1000000000LL);
+      timeout.tv_nsec = (remaining % 1000000000LL);
+      futex_wait(&future->state, (state | FUTURE_WAITERS), &timeout);
+    }
+    state = __atomic_load_n(&future->state, __ATOMIC_ACQUIRE);
+  }
+  return TRUE;
+}
+
+/* Run the task of the future, unless it was canceled before it started, then release the tasks reference. */
+static void future_run(void *arg) {
   ASSERT(arg);
-  FutureTask *data = arg;
-  void *result = data->task(data->arg);
-  mutex_action(&data->future->mutex,
-    data->future->result = result;
-    data->future->ready = TRUE;
-    cond_signal(&data->future->cond);
-  );
-  free(data);
+  Future *future = arg;
+  Future *prev;
+  if (future_claim(future)) {
+    prev = current_future;
+    current_future = future;
+    future->result = future->task(future->arg);
+    current_future = prev;
+    future_finish(future, FUTURE_READY);
+  }
+  future_free(future);
+}
+
+/* Thread entry for when running a thread per task. */
+static void *future_task_callback(void *arg) {
+  future_run(arg);
   return NULL;
 }
 
-/* Free's a allocated `Future` structure. */
+/* ----------------------------- Then ----------------------------- */
+
+/* Runs on the pool, once the source future is done. */
+static void future_then_run(void *arg) {
+  FutureThen *then = arg;
+  void *result = then->func(then->result, then->arg);
+  /* The output can have been canceled while `func` was running, then the result is dropped. */
+  if (future_claim(then->out)) {
+    future_complete(then->out, result);
+  }
+  future_free(then->out);
+  free(then);
+}
+
+static void future_then_ready(Future *future, void *arg) {
+  FutureThen *then = arg;
+  /* Cancelation of the source carries over to the output, without calling `func`. */
+  if ((__atomic_load_n(&future->state, __ATOMIC_ACQUIRE) & FUTURE_STATUS) == FUTURE_CANCELED) {
+    future_cancel(then->out);
+    future_free(then->out);
+    free(then);
+  }
+  else {
+    then->result = future->result;
+    thread_pool_submit(thread_pool_default(), future_then_run, then);
+  }
+  future_free(future);
+}
+
+/* ----------------------------- When all/any ----------------------------- */
+
+/* Counted down by every input future once it's done.  Return's `TRUE` for the last one, which by then is the only thread using `join`. */
+static bool future_join_countdown(FutureJoin *join) {
+  return !__atomic_sub_fetch(&join->remaining, 1, __ATOMIC_ACQ_REL);
+}
+
+/* Release the shared state, along with the references it holds to the output and to all inputs. */
+static void future_join_free(FutureJoin *join) {
+  for (Ulong i=0; i<join->n; ++i) {
+    future_free(join->futures[i]);
+  }
+  future_free(join->out);
+  free(join->futures);
+  free(join);
+}
+
+static void future_when_all_ready(Future *_UNUSED future, void *arg) {
+  FutureJoin *join = arg;
+  void **results;
+  if (future_join_countdown(join)) {
+    if (future_claim(join->out)) {
+      results = xmalloc(_PTRSIZE * join->n);
+      for (Ulong i=0; i<join->n; ++i) {
+        results[i] = join->futures[i]->result;
+      }
+      future_complete(join->out, results);
+    }
+    future_join_free(join);
+  }
+}
+
+static void future_when_any_ready(Future *future, void *arg) {
+  FutureJoin *join = arg;
+  bool expected = FALSE;
+  if (__atomic_compare_exchange_n(&join->done, &expected, TRUE, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) && future_claim(join->out)) {
+    future_complete(join->out, future);
+  }
+  if (future_join_countdown(join)) {
+    future_join_free(join);
+  }
+}
+
+/* Create the shared state for a join over `n` futures, the output is created with one reference for the caller, and one for the join. */
+static FutureJoin *future_join_create(Future **futures, Ulong n) {
+  FutureJoin *join = xmalloc(sizeof(*join));
+  join->out       = future_create(NULL, NULL, 2);
+  join->futures   = xmalloc(_PTRSIZE * n);
+  join->n         = n;
+  join->remaining = n;
+  join->done      = FALSE;
+  memcpy(join->futures, futures, (_PTRSIZE * n));
+  return join;
+}
+
+/* ----------------------------- Future ----------------------------- */
+
+/* Release the callers reference to `future`.  The future itself is only released once its task, and all continuations
+ * waiting on it, are done with it, so this can be called at any time, including before the future is ready. */
 void future_free(Future *future) {
   ASSERT(future);
-  mutex_destroy(&future->mutex);
-  cond_destroy(&future->cond);
-  free(future);
+  if (!__atomic_sub_fetch(&future->refs, 1, __ATOMIC_ACQ_REL)) {
+    future_cache_put(future);
+  }
 }
 
-/* Get the result of the task related to `future`.  Note that this function is `blocking`. */
+/* Get the result of the task related to `future`, or `NULL` if it was canceled.  Note that this function is `blocking`, but when
+ * called from a pool worker, it runs other queued tasks of that pool while the result is not ready, and only parks when there are
+ * none left.  This way a task can wait on other tasks without taking a worker away from the pool. */
 void *future_get(Future *future) {
   ASSERT(future);
-  void *result;
-  mutex_action(&future->mutex,
-    while (!future->ready) {
-      cond_wait(&future->cond, &future->mutex);
-    }
-    result = future->result;
-  );
-  return result;
+  while (!FUTURE_IS_DONE(__atomic_load_n(&future->state, __ATOMIC_ACQUIRE)) && thread_pool_help());
+  future_wait(future, -1);
+  return future->result;
 }
 
-/* Try to get the result of the task related to `future`.  Note that this function is
- * `non-blocking` and return's `TRUE` when the result is ready and could be retrieved. */
+/* Same as `future_get()`, but give up once the monotonic time reaches `deadline_ns`, see `hiactime_now_ns()`.  This never runs other
+ * tasks while waiting, as that could take any amount of time.  Return's `TRUE` and assigns the result to `*result` when `future` was
+ * done in time, otherwise, return's `FALSE`. */
+bool future_get_timed(Future *future, Llong deadline_ns, void **const result) {
+  ASSERT(future);
+  ASSERT(result);
+  if (!future_wait(future, ((deadline_ns < 0) ? 0 : deadline_ns))) {
+    return FALSE;
+  }
+  *result = future->result;
+  return TRUE;
+}
+
+/* Try to get the result of the task related to `future`.  Note that this function is `non-blocking`, it's a single load, and
+ * return's `TRUE` when `future` is done and the result could be retrieved, where a canceled future has the result `NULL`. */
 bool future_try_get(Future *future, void **result) {
   ASSERT(future);
   ASSERT(result);
-  mutex_action(&future->mutex,
-    *result = (future->ready ? future->result : NULL);
-  );
-  return (*result);
+  if (!FUTURE_IS_DONE(__atomic_load_n(&future->state, __ATOMIC_ACQUIRE))) {
+    return FALSE;
+  }
+  *result = future->result;
+  return TRUE;
+}
+
+/* Cancel `future`.  If its task has not started yet, it never will, and `future` is done right away with the result `NULL`, as is
+ * any `future_then()` chained on it.  When the task is already running, it's only asked to stop, which it can check with
+ * `future_cancel_requested()`, and `future` still gets whatever the task returns.  Return's `TRUE` when the task was prevented from running. */
+bool future_cancel(Future *future) {
+  ASSERT(future);
+  Uint state = __atomic_load_n(&future->state, __ATOMIC_RELAXED);
+  while (!FUTURE_IS_DONE(state)) {
+    if ((state & FUTURE_STATUS) == FUTURE_PENDING) {
+      if (future_claim(future)) {
+        future_finish(future, FUTURE_CANCELED);
+        return TRUE;
+      }
+      state = __atomic_load_n(&future->state, __ATOMIC_RELAXED);
+    }
+    else if ((state & FUTURE_CANCEL_REQ) || __atomic_compare_exchange_n(&future->state, &state, (state | FUTURE_CANCEL_REQ), TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+  return FALSE;
+}
+
+/* Return's `TRUE` when called from a task submitted with `future_submit()`, whose future has been canceled.  A long running
+ * task can poll this to stop early.  Note that the task still returns a result, which becomes the result of the future. */
+bool future_cancel_requested(void) {
+  return (current_future && (__atomic_load_n(&current_future->state, __ATOMIC_RELAXED) & FUTURE_CANCEL_REQ));
+}
+
+/* Create a future for `task` with `arg` passed to the `task`, that runs on `pool`.  Return's
+ * the `future`, use `future_get()` or `future_try_get()` to get the result of `task`. */
+Future *future_submit_to(THREAD_POOL pool, void *(*task)(void *), void *arg) {
+  ASSERT(pool);
+  Future *future = future_create(task, arg, 2);
+  thread_pool_submit(pool, future_run, future);
+  return future;
+}
+
+/* Create a future for `task` with `arg` passed to the `task`, that runs on `pool`, preferably on a worker on numa `node`.
+ * See `thread_pool_submit_node()`. */
+Future *future_submit_to_node(THREAD_POOL pool, int node, void *(*task)(void *), void *arg) {
+  ASSERT(pool);
+  Future *future = future_create(task, arg, 2);
+  thread_pool_submit_node(pool, node, future_run, future);
+  return future;
 }
 
 /* Create a future for `task` with `arg` passed to the `task`.  Return's the
- * `future`, use `future_get()` or `future_try_get()` to get the result of `task`. */
+ * `future`, use `future_get()` or `future_try_get()` to get the result of `task`.
+ * By default the task runs on the default thread pool, see `future_set_thread_per_task()`. */
 Future *future_submit(void *(*task)(void *), void *arg) {
   thread_t thread;
-  FutureTask *data = xmalloc(sizeof(*data));
-  data->future = future_create();
-  data->task   = task;
-  data->arg    = arg;
-  thread_create(&thread, NULL, future_task_callback, data);
+  Future *future;
+  if (!__atomic_load_n(&thread_per_task, __ATOMIC_RELAXED)) {
+    return future_submit_to(thread_pool_default(), task, arg);
+  }
+  future = future_create(task, arg, 2);
+  thread_create(&thread, NULL, future_task_callback, future);
   thread_detach(thread);
-  return data->future;
+  return future;
+}
+
+/* When `use` is `TRUE`, make `future_submit()` create a detached thread for every task, like it used to.  This
+ * can be needed when tasks block for a long time, where they would otherwise hold up a pool worker each. */
+void future_set_thread_per_task(bool use) {
+  __atomic_store_n(&thread_per_task, use, __ATOMIC_RELAXED);
+}
+
+/* ----------------------------- Combinator's ----------------------------- */
+
+/* Return's a future that is already ready with `result`. */
+Future *future_ready(void *result) {
+  Future *future = future_create(NULL, NULL, 1);
+  future->state  = FUTURE_READY;
+  future->result = result;
+  future->conts  = FUTURE_CONTS_CLOSED;
+  return future;
+}
+
+/* Return's a future for the result of `func`, that is called with the result of `future` and `arg` on the default pool as soon as
+ * `future` is ready, without any thread waiting for it in the meantime.  Note that `future` can be freed right after this call. */
+Future *future_then(Future *future, void *(*func)(void *result, void *arg), void *arg) {
+  ASSERT(future);
+  ASSERT(func);
+  FutureThen *then = xmalloc(sizeof(*then));
+  Future *out = future_create(NULL, NULL, 2);
+  then->out  = out;
+  then->func = func;
+  then->arg  = arg;
+  /* Note that `then` can already be freed once this returns. */
+  future_on_ready(future, future_then_ready, then);
+  return out;
+}
+
+/* Return's a future that becomes ready once all `n` futures in `futures` are done.  Its result is a allocated array of the `n` results, in
+ * the same order as `futures`, that the caller must free.  Note that the futures in `futures` can be freed right after this call. */
+Future *future_when_all(Future **futures, Ulong n) {
+  ASSERT(futures);
+  ALWAYS_ASSERT(n);
+  FutureJoin *join = future_join_create(futures, n);
+  Future *out = join->out;
+  for (Ulong i=0; i<n; ++i) {
+    future_on_ready(futures[i], future_when_all_ready, join);
+  }
+  return out;
+}
+
+/* Return's a future that becomes ready once any of the `n` futures in `futures` is done.  Its result is the future in `futures` that was
+ * done first, which is only guaranteed to still be valid if the caller still holds its own reference to it. */
+Future *future_when_any(Future **futures, Ulong n) {
+  ASSERT(futures);
+  ALWAYS_ASSERT(n);
+  FutureJoin *join = future_join_create(futures, n);
+  Future *out = join->out;
+  for (Ulong i=0; i<n; ++i) {
+    future_on_ready(futures[i], future_when_any_ready, join);
+  }
+  return out;
 }
 
 #endif
@@ -14,32 +14,41 @@
 /* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
 
 
-/* Interval time. */
-#define INTERVAL_0  (1000000LL)
-#define INTERVAL_1  (300000LL)
-#define INTERVAL_2  (100000LL)
-
-/* Jitter forgiveness time. */
-#define JITTER_0  (300000LL)
-#define JITTER_1  (150000LL)
-#define JITTER_2  (60000LL)
-
-/* Segment sleep. */
-#define DO_SLEEP_SEGMENT(elapsed, total, start, now, stage)            \
-  while (((elapsed) + INTERVAL_##stage + JITTER_##stage) < (total)) {  \
-    nanosleep(&timespec_##stage, NULL);                                \
-    clock_gettime(CLOCK_MONOTONIC, (now));                             \
-    (elapsed) = TIMESPEC_ELAPSED_NS((start), (now));                   \
-  }
+/* The wakeup lateness assumed before the first sleep has been measured. */
+#define LATENESS_INITIAL_NS  (100000LL)
+
+/* Extra time to spin on top of the expected lateness, for the cost of the wakeup itself. */
+#define SPIN_GUARD_NS  (2000LL)
+
+/* The timerslack every sleeping thread asks for, the default of 50us is far to coarse for a precise sleep. */
+#define TIMERSLACK_NS  (1UL)
 
 
 /* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
 
 
-/* Timespec segments. */
-static const struct timespec timespec_0 = {0, INTERVAL_0};
-static const struct timespec timespec_1 = {0, INTERVAL_1};
-static const struct timespec timespec_2 = {0, INTERVAL_2};
+/* How late `clock_nanosleep()` wakes up on this host.  It rises quickly and decays slowly, so it tracks the high end
+ * of the observed lateness, rather then the average. */
+static Llong lateness_ns = LATENESS_INITIAL_NS;
+
+/* `TRUE` once the calling thread has set its timerslack. */
+static _THREAD bool timerslack_set = FALSE;
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* Fold one measured wakeup lateness into the host estimate. */
+static void lateness_update(Llong late) {
+  Llong est = __atomic_load_n(&lateness_ns, __ATOMIC_RELAXED);
+  if (late > est) {
+    est += ((late - est) / 4);
+  }
+  else {
+    est -= ((est - late) / 32);
+  }
+  __atomic_store_n(&lateness_ns, est, __ATOMIC_RELAXED);
+}
 
 
 /* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
@@ -54,34 +63,51 @@ static const struct timespec timespec_2 = {0, INTERVAL_2};
 //   }
 // }
 
+/* ----------------------------- Hiactime sleep until ns ----------------------------- */
+
+/* Sleep until the monotonic clock reaches `deadline`, as returned by `hiactime_now_ns()`.  This sleeps in one absolute
+ * `clock_nanosleep()` to just before the deadline, by how late wakeups have been on this host, and spins with `pause`
+ * for the rest.  So the cpu used is only the spin at the end, which is usually a few micro-seconds. */
+void hiactime_sleep_until_ns(Llong deadline) {
+  struct timespec ts;
+  Llong wake;
+  if (!timerslack_set) {
+    prctl(PR_SET_TIMERSLACK, TIMERSLACK_NS, 0, 0, 0);
+    timerslack_set = TRUE;
+  }
+  wake = (deadline - __atomic_load_n(&lateness_ns, __ATOMIC_RELAXED) - SPIN_GUARD_NS);
+  if (wake > hiactime_now_ns()) {
+    ts.tv_sec  = (wake / 1000000000LL);
+    ts.tv_nsec = (wake % 1000000000LL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+    lateness_update(hiactime_now_ns() - wake);
+  }
+  /* Spin on the same clock the deadline and the sleep are in, so any drift of the tsc clock can never turn this into a
+   * long spin, or an early return. */
+  while (hiactime_now_ns() < deadline) {
+    CPU_RELAX();
+  }
+}
+
+/* Return's the time before a deadline, at which a precise sleep stops sleeping and starts to spin. */
+Llong hiactime_spin_threshold_ns(void) {
+  return (__atomic_load_n(&lateness_ns, __ATOMIC_RELAXED) + SPIN_GUARD_NS);
+}
+
 /* ----------------------------- Hiactime sleep total duration ----------------------------- */
 
-/* Based on how mush time has elapsed from `s`, sleep until we achive the exact time in nanoseconds.
- * `e` does not need to gathered by the caller, rather can be used to measure
- * the full sleep time after the call.  Note that for milli-second accuracy this is basicly perfect. */
+/* Sleep until `nanoseconds` have passed since `s`.  `e` does not need to gathered by the caller, rather can be used to
+ * measure the full sleep time after the call.  See `hiactime_sleep_until_ns()`. */
 void hiactime_sleep_total_duration(const struct timespec *const s, struct timespec *const e, Llong nanoseconds) {
-  long elapsed;
-  /* Get the current time. */
+  hiactime_sleep_until_ns((s->tv_sec * 1000000000LL) + s->tv_nsec + nanoseconds);
   clock_gettime(CLOCK_MONOTONIC, e);
-  elapsed = TIMESPEC_ELAPSED_NS(s, e);
-  /* Perform all sleep stages. */
-  DO_SLEEP_SEGMENT(elapsed, nanoseconds, s, e, 0);
-  DO_SLEEP_SEGMENT(elapsed, nanoseconds, s, e, 1);
-  DO_SLEEP_SEGMENT(elapsed, nanoseconds, s, e, 2);
-  /* For the remaining time, spin the time away. */
-  while (TIMESPEC_ELAPSED_NS(s, e) < nanoseconds) {
-    clock_gettime(CLOCK_MONOTONIC, e);
-  }
 }
 
 /* ----------------------------- Hiactime nsleep ----------------------------- */
 
 /* High-accuracy `nano-second` sleep. */
 void hiactime_nsleep(Llong nanoseconds) {
-  struct timespec s;
-  struct timespec e;
-  clock_gettime(CLOCK_MONOTONIC, &s);
-  hiactime_sleep_total_duration(&s, &e, nanoseconds);
+  hiactime_sleep_until_ns(hiactime_now_ns() + nanoseconds);
 }
 
 /* ----------------------------- Hiactime nsleep ----------------------------- */
@@ -91,4 +117,13 @@ void hiactime_msleep(double milliseconds) {
   hiactime_nsleep(MILLI_TO_NANO(milliseconds));
 }
 
+/* ----------------------------- Hiactime now ns ----------------------------- */
+
+/* Return's the current time of the monotonic clock in nano-seconds.  This is the clock all deadlines are based on. */
+Llong hiactime_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((now.tv_sec * 1000000000LL) + now.tv_nsec);
+}
+
 #endif
@@ -0,0 +1,159 @@
+/** @file lockprof.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Opt-in lock contention profiling.  When fcio and the code using it are built with `FCIO_LOCK_PROFILE` defined, every
+  `mutex_action()`/`MUTEX_ACTION()` call-site, and every `SMUTEX`, records how often it was taken, how often it had to
+  wait, how long it waited, and a histogram of how long it was held, all timed with the tsc.  `lockprof_dump()` then
+  prints the sites sorted by total wait time.  Without `FCIO_LOCK_PROFILE` the macros are untouched, and nothing here
+  is ever called.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+/* All sites that have been taken at least once. */
+static lockprof_site_t *lockprof_sites = NULL;
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+static void lockprof_register(lockprof_site_t *const site) {
+  Uint expected = FALSE;
+  if (!__atomic_compare_exchange_n(&site->registered, &expected, TRUE, FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    return;
+  }
+  site->next = __atomic_load_n(&lockprof_sites, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&lockprof_sites, &site->next, site, TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static void lockprof_update_max(Ulong *const max, Ulong value) {
+  Ulong cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+  while (value > cur && !__atomic_compare_exchange_n(max, &cur, value, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/* Return's the upper bound, in cycles, of the histogram bucket that holds the `pct` percentile of `site`. */
+static Ulong lockprof_hold_percentile(const lockprof_site_t *const site, Ulong total, double pct) {
+  Ulong target = (Ulong)((double)total * pct);
+  Ulong seen = 0;
+  for (int i=0; i<LOCKPROF_HIST_BUCKETS; ++i) {
+    seen += __atomic_load_n(&site->hold_hist[i], __ATOMIC_RELAXED);
+    if (seen > target) {
+      return (1UL << (i + 1));
+    }
+  }
+  return (1UL << LOCKPROF_HIST_BUCKETS);
+}
+
+static int lockprof_compare(const void *a, const void *b) {
+  Ulong x = (*(lockprof_site_t *const *)a)->wait_cycles;
+  Ulong y = (*(lockprof_site_t *const *)b)->wait_cycles;
+  return ((x > y) ? -1 : (x < y));
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* Return's the current tsc. */
+Ulong lockprof_cycles(void) {
+  return fcio_cycles();
+}
+
+/* Record that the lock of `site` was taken, where the attempt started at `start`, and `contended` tells if it had to wait.  Return's
+ * the time the lock was acquired at, to be passed to `lockprof_released()`. */
+Ulong lockprof_acquired(lockprof_site_t *const site, Ulong start, bool contended) {
+  ASSERT(site);
+  Ulong now = lockprof_cycles();
+  if (!__atomic_load_n(&site->registered, __ATOMIC_RELAXED)) {
+    lockprof_register(site);
+  }
+  __atomic_add_fetch(&site->acquisitions, 1, __ATOMIC_RELAXED);
+  if (contended) {
+    __atomic_add_fetch(&site->contended, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&site->wait_cycles, (now - start), __ATOMIC_RELAXED);
+    lockprof_update_max(&site->wait_max, (now - start));
+  }
+  return now;
+}
+
+/* Record that the lock of `site` is about to be released, where it was acquired at `acquired`. */
+void lockprof_released(lockprof_site_t *const site, Ulong acquired) {
+  ASSERT(site);
+  Ulong hold = (lockprof_cycles() - acquired);
+  int bucket = ((hold > 1) ? (63 - __builtin_clzl(hold)) : 0);
+  if (bucket >= LOCKPROF_HIST_BUCKETS) {
+    bucket = (LOCKPROF_HIST_BUCKETS - 1);
+  }
+  __atomic_add_fetch(&site->hold_hist[bucket], 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&site->hold_cycles, hold, __ATOMIC_RELAXED);
+  lockprof_update_max(&site->hold_max, hold);
+}
+
+/* Print a report of every profiled lock site to stderr, sorted by total wait time. */
+void lockprof_dump(void) {
+  lockprof_site_t *head = __atomic_load_n(&lockprof_sites, __ATOMIC_ACQUIRE);
+  lockprof_site_t **sites;
+  lockprof_site_t *site;
+  const char *file;
+  double cpn = (1e6 / fcio_cycles_to_ns(1000000));
+  Ulong n = 0;
+  Ulong acq;
+  Ulong cont;
+  /* Sites are only ever pushed in front, so everything from the snapshot of the head stays put.  Note that printing
+   * takes `stderr_mutex`, which can register itself as a new site while we are at it. */
+  for (site=head; site; site=site->next) {
+    ++n;
+  }
+  sites = xmalloc(_PTRSIZE * (n ? n : 1));
+  n = 0;
+  for (site=head; site; site=site->next) {
+    sites[n++] = site;
+  }
+  writeferr("lockprof: %lu lock sites, %.3f cycles/ns\n", n, cpn);
+  if (!n) {
+    free(sites);
+    return;
+  }
+  qsort(sites, n, _PTRSIZE, lockprof_compare);
+  writeferr("%-28s  %-28s  %10s  %10s  %12s  %12s  %10s  %10s  %12s\n",
+    "lock", "site", "acquired", "contended", "wait ms", "wait max us", "hold p50", "hold p99", "hold max us");
+  for (Ulong i=0; i<n; ++i) {
+    site = sites[i];
+    acq  = __atomic_load_n(&site->acquisitions, __ATOMIC_RELAXED);
+    cont = __atomic_load_n(&site->contended, __ATOMIC_RELAXED);
+    file = strrchr(site->file, '/');
+    file = (file ? (file + 1) : site->file);
+    writeferr("%-28.28s  %20.20s:%-7d  %10lu  %9.2f%%  %12.3f  %12.3f  %8.0fns  %8.0fns  %12.3f\n",
+      site->name, file, site->line, acq, (acq ? ((100.0 * (double)cont) / (double)acq) : 0.0),
+      ((double)site->wait_cycles / cpn / 1e6), ((double)site->wait_max / cpn / 1e3),
+      ((double)lockprof_hold_percentile(site, acq, 0.50) / cpn), ((double)lockprof_hold_percentile(site, acq, 0.99) / cpn),
+      ((double)site->hold_max / cpn / 1e3));
+  }
+  free(sites);
+}
+
+/* Clear the counters of every profiled lock site. */
+void lockprof_reset(void) {
+  for (lockprof_site_t *site=__atomic_load_n(&lockprof_sites, __ATOMIC_ACQUIRE); site; site=site->next) {
+    __atomic_store_n(&site->acquisitions, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->contended, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->wait_cycles, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->wait_max, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->hold_cycles, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->hold_max, 0, __ATOMIC_RELAXED);
+    for (int i=0; i<LOCKPROF_HIST_BUCKETS; ++i) {
+      __atomic_store_n(&site->hold_hist[i], 0, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+#endif
@@ -3,12 +3,24 @@
   @author  Melwin Svensson.
   @date    19-7-2025.
 
+  Lines are formatted once, into a per-thread buffer, and then either written right away, or, after
+  `fcio_log_async_start()`, pushed into a lock-free ring that a background thread drains with batched `writev()`.
+
+  A log file is opened with `O_APPEND`, so every write lands whole at the end of the file, and writes below `PIPE_BUF`
+  take no lock at all, not even across processes sharing the file.  Rotation swaps the file behind the same fd with
+  `dup3()`, so a writer can never hit a closed, or reused, fd.
+
  */
+#define _GNU_SOURCE
 #define _USE_ALL_BUILTINS
 #include "../include/proto.h"
+#include "../include/statics.h"
 
 #if !__WIN__
 
+#include <spawn.h>
+#include <sys/wait.h>
+
 /* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
 
 
@@ -16,36 +28,88 @@
 #define LOG_COLOR_START(x)  fcio_log_type_color_start[(x)]
 #define LOG_COLOR_END(x)    fcio_log_type_color_end[(x)]
 
-
-/* ---------------------------------------------------------- Enum's ---------------------------------------------------------- */
-
-
-/* Logging type.  Note that these are not in any perticular order. */
-typedef enum {
-  FCIO_LOG_INFO_0,
-  FCIO_LOG_INFO_1,
-  FCIO_LOG_WARN_0,
-  FCIO_LOG_ERR_NF,
-  FCIO_LOG_ERR_FA
-# define FCIO_LOG_INFO_0    \
-  /* Low prio info log. */  \
-  FCIO_LOG_INFO_0
-# define FCIO_LOG_INFO_1    \
-  /* Medium prio info log. */  \
-  FCIO_LOG_INFO_1
-# define FCIO_LOG_WARN_0  \
-  /* Low prio warning log */ \
-  FCIO_LOG_WARN_0
-# define FCIO_LOG_ERR_NF  \
-  /* Non fatal error. */  \
-  FCIO_LOG_ERR_NF
-# define FCIO_LOG_ERR_FA      \
-  /* Fatal error logging. */  \
-  FCIO_LOG_ERR_FA
-
-# define FCIO_LOG_TYPE_FIRST  FCIO_LOG_INFO_0
-# define FCIO_LOG_TYPE_LAST   FCIO_LOG_ERR_FA
-} FcioLogType;
+/* The size of the per-thread buffer lines are formatted into, longer lines are allocated. */
+#define LOG_LINE_MAX  (1024)
+
+/* The part of a line stored in the async slot itself, longer lines are allocated.  Makes a slot 256 bytes. */
+#define LOG_ASYNC_INLINE  (232)
+
+/* The most lines the writer hands to a single `writev()`, this is also the backlog at which producers wake it early. */
+#define LOG_ASYNC_BATCH  (64)
+
+/* How long the writer lets lines sit, when no flush interval was given. */
+#define LOG_ASYNC_FLUSH_NS  (10000000LL)
+
+/* Where a line goes. */
+#define LOG_DEST_STDOUT  (0)
+#define LOG_DEST_STDERR  (1)
+#define LOG_DEST_FILE    (2)
+
+/* The most bytes written between two checks of the size of the log file, when rotating by size. */
+#define LOG_FILE_CHECK_BYTES  (64 * 1024)
+
+/* The longest segment name, `path.N.gz`, past the path itself. */
+#define LOG_FILE_SUFFIX_MAX  (32)
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+/* One queued line.  `seq` works like the cells of `MPMC`, it is `pos + 1` once the line for `pos` is published, and
+ * `pos + capacity` once the writer is done with it. */
+typedef struct {
+  Ulong seq;
+  Uint len;
+  Uint dest;
+  char *heap;
+  char data[LOG_ASYNC_INLINE];
+} LogSlot;
+
+typedef struct {
+  /* Read-only while running. */
+  LogSlot *slots;
+  Ulong mask;
+  int policy;
+  struct timespec flush_interval;
+  thread_t thread;
+  bool running;
+  /* The next position to push to, shared by all producers. */
+  Ulong enqueue_pos _ALIGNED(_CACHELINE_SIZE);
+  /* The number of lines dropped because the ring was full. */
+  Ulong dropped;
+  /* The next position to write, only ever advanced by the writer. */
+  Ulong dequeue_pos _ALIGNED(_CACHELINE_SIZE);
+  /* The writer parks on `not_empty`, producers of a full ring on `not_full`, and `fcio_log_flush()` on `flushed`. */
+  parking_t not_empty _ALIGNED(_CACHELINE_SIZE);
+  parking_t not_full;
+  parking_t flushed;
+} LogAsync;
+
+
+/* The log file, see `fcio_log_set_rotation()` and `fcio_log_set_fsync()`.  Note that the settings are only read by the
+ * writers, so they should be set before logging to the file starts. */
+typedef struct {
+  char *path;
+  /* Rotation. */
+  Ulong max_size;
+  Llong max_age;
+  Uint keep;
+  bool compress;
+  Ulong check_bytes;
+  /* Fsync batching. */
+  Ulong sync_bytes;
+  Llong sync_interval;
+  /* Bytes written since the size was last checked, and since the last sync. */
+  Ulong unchecked;
+  Ulong unsynced;
+  /* When the current file was opened, and when it was last synced. */
+  Llong opened;
+  Llong synced;
+  /* Set while a thread checks, rotates or syncs the file. */
+  Uint busy;
+  /* The compression of the last rotated segment, or `0`. */
+  pid_t compressor;
+} LogFile;
 
 
 /* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
@@ -75,60 +139,513 @@ static const char *const fcio_log_type_color_end[FCIO_LOG_TYPE_LAST + 1] = {
   "\033[0m",  /* ERR_FA */
 };
 
+/* The levels disabled at runtime of every module, see `FCIO_LOG_ENABLED()`.  These are kept inverted, so that every
+ * level is enabled without having to initialize anything.  All of them fit in one cache line, that is only ever written
+ * when the masks change. */
+Uchar fcio_log_disabled[FCIO_LOG_MODULES] _ALIGNED(_CACHELINE_SIZE) = {0};
+
 static mutex_t fcio_log_mutex = mutex_init_static;
 static int fcio_log_fd = -1;
+static LogFile fcio_log_file;
+
+/* The running async backend, or `NULL` when lines are written right away. */
+static LogAsync *fcio_log_async = NULL;
+
+static pthread_once_t fcio_log_atexit_once = PTHREAD_ONCE_INIT;
+
+/* The buffer every line is formatted into, so logging never allocates unless the line is very long. */
+static _THREAD char fcio_log_buffer[LOG_LINE_MAX];
+
+/* Set on the async writer thread, whose own lines are written right away, as it can never wait on its own ring. */
+static _THREAD bool log_async_writing = FALSE;
 
 
 /* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
 
 
-/* ----------------------------- Fcio log va ----------------------------- */
+/* ----------------------------- Log format ----------------------------- */
 
-_PRINTFLIKE(4, 0)
-static void fcio_log_va(int type, Ulong lineno,
-  const char *const restrict function, const char *const restrict format, va_list ap)
+/* Format a full log line into `buf`, with room for `cap` bytes.  Return's the length of the whole line, which when it's
+ * `cap` or more means it did not fit, and must be formatted again into a larger buffer. */
+_PRINTFLIKE(7, 0)
+static int log_format(char *const buf, int cap, int type, Ulong lineno, const char *const restrict function,
+  bool color, const char *const restrict format, va_list ap)
 {
-  ASSERT(format);
-  ASSERT(type >= FCIO_LOG_TYPE_FIRST && type <= FCIO_LOG_TYPE_LAST);
-  bool log_to_std = TRUE;
-  va_list copy;
-  char *log;
-  char *data;
-  int datalen;
-  long len;
-  long written = 0;
-  va_copy(copy, ap);
-  log = valstr(format, copy, NULL);
-  va_end(copy);
-  MUTEX_ACTION(&fcio_log_mutex,
-    if (fcio_log_fd != -1) {
-      log_to_std = FALSE;
-    }
-  );
-  data = fmtstr_len(
-    &datalen,
-    "[%s]:[LINE]:[%lu]%*s:[FUNC]:[%s]: %s\n",
+  int len;
+  len = snprintf(buf, cap, "%s[%s]:[LINE]:[%lu]%*s:[FUNC]:[%s]: ",
+    (color ? LOG_COLOR_START(type) : ""),
     LOG_TAG(type),
     lineno,
     ((digits(lineno) < 5) ? (5 - digits(lineno)) : 0),
     " ",
-    PASS_IF_VALID(function, "GLOBAL"),
-    log
+    PASS_IF_VALID(function, "GLOBAL")
   );
-  free(log);
-  /* Only when logging to std out/err do we color the text using ascii esc codes. */
-  if (log_to_std) {
-    if (type >= FCIO_LOG_ERR_NF) {
-      writeferr("%s%s%s", LOG_COLOR_START(type), data, LOG_COLOR_END(type));
+  len += vsnprintf((buf + ((len < cap) ? len : cap)), ((len < cap) ? (cap - len) : 0), format, ap);
+  len += snprintf((buf + ((len < cap) ? len : cap)), ((len < cap) ? (cap - len) : 0), "\n%s", (color ? LOG_COLOR_END(type) : ""));
+  return len;
+}
+
+_PRINTFLIKE(7, 8)
+static int log_format_line(char *const buf, int cap, int type, Ulong lineno, const char *const restrict function,
+  bool color, const char *const restrict format, ...)
+{
+  int len;
+  va_list ap;
+  va_start(ap, format);
+  len = log_format(buf, cap, type, lineno, function, color, format, ap);
+  va_end(ap);
+  return len;
+}
+
+/* ----------------------------- Log file ----------------------------- */
+
+static inline int log_file_open(const char *const restrict path) {
+  return open(path, (O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC), 0644);
+}
+
+/* Put the file at the path of the log behind `fcio_log_fd`.  Return's `FALSE` when it can't be opened, in which case
+ * we keep writing to the current file. */
+static bool log_file_reopen(void) {
+  int fd = log_file_open(fcio_log_file.path);
+  if (fd == -1) {
+    return FALSE;
+  }
+  dup3(fd, fcio_log_fd, O_CLOEXEC);
+  close(fd);
+  fcio_log_file.opened = fcio_now_ns();
+  return TRUE;
+}
+
+/* Write the name of rotated segment `n` of the log to `buf`. */
+static void log_file_segment(char *const buf, Ulong cap, Ulong n, bool gz) {
+  snprintf(buf, cap, "%s.%lu%s", fcio_log_file.path, n, (gz ? ".gz" : ""));
+}
+
+/* Return's the number of the newest rotated segment of the log, or `0` when there is none. */
+static Ulong log_file_last_segment(void) {
+  const char *base = strrchr(fcio_log_file.path, '/');
+  char dirpath[PATH_MAX];
+  struct dirent *entry;
+  const char *p;
+  Ulong ret = 0;
+  Ulong n;
+  Ulong baselen;
+  DIR *dir;
+  if (base) {
+    snprintf(dirpath, sizeof(dirpath), "%.*s", (int)((base == fcio_log_file.path) ? 1 : (base - fcio_log_file.path)), fcio_log_file.path);
+    ++base;
+  }
+  else {
+    memcpy(dirpath, ".", 2);
+    base = fcio_log_file.path;
+  }
+  if (!(dir = opendir(dirpath))) {
+    return 0;
+  }
+  baselen = strlen(base);
+  while ((entry = readdir(dir))) {
+    if (strncmp(entry->d_name, base, baselen) != 0 || entry->d_name[baselen] != '.') {
+      continue;
+    }
+    p = (entry->d_name + baselen + 1);
+    n = 0;
+    while (*p >= '0' && *p <= '9') {
+      n = ((n * 10) + (*p++ - '0'));
+    }
+    if ((!*p || strcmp(p, ".gz") == 0) && n > ret) {
+      ret = n;
+    }
+  }
+  closedir(dir);
+  return ret;
+}
+
+/* Compress segment `n` with gzip in the background.  When gzip can't be started the segment is left as it is. */
+static void log_file_compress(Ulong n) {
+  char name[PATH_MAX + LOG_FILE_SUFFIX_MAX];
+  char *argv[] = { "gzip", "-f", "-q", name, NULL };
+  pid_t pid;
+  log_file_segment(name, sizeof(name), n, FALSE);
+  if (posix_spawnp(&pid, "gzip", NULL, NULL, argv, environ) == 0) {
+    fcio_log_file.compressor = pid;
+  }
+}
+
+/* Move the log to the next numbered segment, and drop the segments past the `keep` newest.  Segments are never
+ * renamed once made, so neither compression, nor other processes rotating the same log, can race on a name.  Note
+ * that this must be called with `fcio_log_mutex` and the fd lock held. */
+static void log_file_rotate(void) {
+  char name[PATH_MAX + LOG_FILE_SUFFIX_MAX];
+  Ulong last = log_file_last_segment();
+  bool found;
+  if (fcio_log_file.compressor) {
+    waitpid(fcio_log_file.compressor, NULL, 0);
+    fcio_log_file.compressor = 0;
+  }
+  if (fcio_log_file.sync_bytes || fcio_log_file.sync_interval) {
+    fdatasync(fcio_log_fd);
+  }
+  log_file_segment(name, sizeof(name), (last + 1), FALSE);
+  if (rename(fcio_log_file.path, name) == -1 || !log_file_reopen()) {
+    return;
+  }
+  for (Ulong n=((last + 1) > fcio_log_file.keep ? (last + 1 - fcio_log_file.keep) : 0); n; --n) {
+    log_file_segment(name, sizeof(name), n, FALSE);
+    found = (unlink(name) == 0);
+    log_file_segment(name, sizeof(name), n, TRUE);
+    found |= (unlink(name) == 0);
+    /* Everything older was dropped by earlier rotations. */
+    if (!found) {
+      break;
+    }
+  }
+  /* Compress the previous segment rather then the one just made, as other processes sharing the log can still be
+   * appending to that one, until they notice the rotation. */
+  if (fcio_log_file.compress && last && fcio_log_file.keep > 1) {
+    log_file_compress(last);
+  }
+}
+
+/* Rotate the log when it's due, or when `force` is `TRUE`.  This is safe across processes sharing the log, as it's
+ * done under the fd lock, and a process that finds the file at the path is not the one it writes to, knows an other
+ * process rotated it, and just reopens it. */
+static void log_file_check(bool force) {
+  struct stat fd_info;
+  struct stat path_info;
+  mutex_fdlock_action(&fcio_log_mutex, fcio_log_fd, F_WRLCK,
+    __atomic_store_n(&fcio_log_file.unchecked, 0, __ATOMIC_RELAXED);
+    if (fstat(fcio_log_fd, &fd_info) == -1) {
+      /* Nothing we can do, just keep writing. */
+    }
+    else if (stat(fcio_log_file.path, &path_info) == -1 || path_info.st_ino != fd_info.st_ino || path_info.st_dev != fd_info.st_dev) {
+      log_file_reopen();
+    }
+    else if (force || (fcio_log_file.max_size && (Ulong)fd_info.st_size >= fcio_log_file.max_size)
+     || (fcio_log_file.max_age && (fcio_now_ns() - fcio_log_file.opened) >= fcio_log_file.max_age)) {
+      log_file_rotate();
+    }
+  );
+}
+
+/* Account for `len` bytes written to the log file, rotating and syncing it when that is due.  Only one thread at a
+ * time does either, every other writer just moves on. */
+static void log_file_written(Ulong len) {
+  LogFile *const f = &fcio_log_file;
+  Ulong unsynced = 0;
+  Llong now = 0;
+  bool check = FALSE;
+  bool sync = FALSE;
+  if (f->max_age || f->sync_interval) {
+    now = fcio_now_ns();
+  }
+  if (f->max_size || f->max_age) {
+    check = ((f->max_size && __atomic_add_fetch(&f->unchecked, len, __ATOMIC_RELAXED) >= f->check_bytes)
+     || (f->max_age && (now - f->opened) >= f->max_age));
+  }
+  if (f->sync_bytes || f->sync_interval) {
+    unsynced = __atomic_add_fetch(&f->unsynced, len, __ATOMIC_RELAXED);
+    sync = (unsynced && ((f->sync_bytes && unsynced >= f->sync_bytes) || (f->sync_interval && (now - f->synced) >= f->sync_interval)));
+  }
+  if ((!check && !sync) || __atomic_exchange_n(&f->busy, TRUE, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  if (sync) {
+    __atomic_sub_fetch(&f->unsynced, unsynced, __ATOMIC_RELAXED);
+    fdatasync(fcio_log_fd);
+    f->synced = (now ? now : fcio_now_ns());
+  }
+  if (check) {
+    log_file_check(FALSE);
+  }
+  __atomic_store_n(&f->busy, FALSE, __ATOMIC_RELEASE);
+}
+
+/* Write all of `iov` to the log file.  As the file is opened with `O_APPEND`, a write below `PIPE_BUF` lands whole,
+ * so only longer ones take the lock, to not be interleaved with other writers. */
+static void log_file_writev(struct iovec *iov, int iovcnt) {
+  Ulong total = 0;
+  long written;
+  for (int i=0; i<iovcnt; ++i) {
+    total += iov[i].iov_len;
+  }
+  if (total < PIPE_BUF) {
+    while (iovcnt && (written = writev(fcio_log_fd, iov, iovcnt)) > 0) {
+      for (; iovcnt && (Ulong)written >= iov->iov_len; --iovcnt, ++iov) {
+        written -= iov->iov_len;
+      }
+      if (iovcnt) {
+        iov->iov_base = ((char *)iov->iov_base + written);
+        iov->iov_len -= written;
+      }
+    }
+  }
+  else {
+    mutex_fdlock_action(&fcio_log_mutex, fcio_log_fd, F_WRLCK,
+      while (iovcnt && (written = writev(fcio_log_fd, iov, iovcnt)) > 0) {
+        for (; iovcnt && (Ulong)written >= iov->iov_len; --iovcnt, ++iov) {
+          written -= iov->iov_len;
+        }
+        if (iovcnt) {
+          iov->iov_base = ((char *)iov->iov_base + written);
+          iov->iov_len -= written;
+        }
+      }
+    );
+  }
+  log_file_written(total);
+}
+
+/* ----------------------------- Log write ----------------------------- */
+
+/* Write all of `iov` to `dest`, from the calling thread. */
+static void log_writev(Uint dest, struct iovec *iov, int iovcnt) {
+  long written;
+  int fd;
+  if (dest == LOG_DEST_STDOUT || dest == LOG_DEST_STDERR) {
+    fd = ((dest == LOG_DEST_STDOUT) ? STDOUT_FILENO : STDERR_FILENO);
+    while (iovcnt && (written = writev(fd, iov, iovcnt)) > 0) {
+      for (; iovcnt && (Ulong)written >= iov->iov_len; --iovcnt, ++iov) {
+        written -= iov->iov_len;
+      }
+      if (iovcnt) {
+        iov->iov_base = ((char *)iov->iov_base + written);
+        iov->iov_len -= written;
+      }
+    }
+    return;
+  }
+  log_file_writev(iov, iovcnt);
+}
+
+/* Write `len` of `data` to `dest` right away. */
+static void log_write(Uint dest, const char *const restrict data, long len) {
+  struct iovec iov;
+  if (dest == LOG_DEST_STDOUT) {
+    stdoutwrite(data, len);
+  }
+  else if (dest == LOG_DEST_STDERR) {
+    stderrwrite(data, len);
+  }
+  else {
+    iov.iov_base = (char *)data;
+    iov.iov_len  = len;
+    log_file_writev(&iov, 1);
+  }
+}
+
+/* ----------------------------- Log async ----------------------------- */
+
+/* Push a line onto the ring of `a`.  When `heap` is not `NULL` it holds the line, and is handed over to the writer.
+ * Return's `FALSE` when the line was dropped. */
+static bool log_async_push(LogAsync *const a, Uint dest, const char *const data, Ulong len, char *heap) {
+  LogSlot *slot;
+  Ulong pos = __atomic_load_n(&a->enqueue_pos, __ATOMIC_RELAXED);
+  Uint expected;
+  long diff;
+  while (TRUE) {
+    slot = &a->slots[pos & a->mask];
+    diff = ((long)__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (long)pos);
+    if (!diff) {
+      if (__atomic_compare_exchange_n(&a->enqueue_pos, &pos, (pos + 1), TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    }
+    /* The ring is full. */
+    else if (diff < 0) {
+      if (a->policy == FCIO_LOG_ASYNC_DROP) {
+        __atomic_add_fetch(&a->dropped, 1, __ATOMIC_RELAXED);
+        free(heap);
+        return FALSE;
+      }
+      expected = parking_prepare(&a->not_full);
+      parking_notify(&a->not_empty);
+      if (((long)__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (long)pos) < 0) {
+        parking_wait(&a->not_full, expected, NULL);
+      }
+      pos = __atomic_load_n(&a->enqueue_pos, __ATOMIC_RELAXED);
     }
     else {
-      writef("%s%s%s", LOG_COLOR_START(type), data, LOG_COLOR_END(type));
+      pos = __atomic_load_n(&a->enqueue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  if (!heap && len > LOG_ASYNC_INLINE) {
+    heap = xmalloc(len);
+    memcpy(heap, data, len);
+  }
+  else if (!heap) {
+    memcpy(slot->data, data, len);
+  }
+  slot->heap = heap;
+  slot->len  = len;
+  slot->dest = dest;
+  __atomic_store_n(&slot->seq, (pos + 1), __ATOMIC_RELEASE);
+  /* Only wake the writer early once a whole batch is waiting, otherwise it comes by on its own. */
+  if ((pos + 1 - __atomic_load_n(&a->dequeue_pos, __ATOMIC_RELAXED)) >= LOG_ASYNC_BATCH) {
+    parking_notify(&a->not_empty);
+  }
+  return TRUE;
+}
+
+/* Write one batch of published lines, that all go to the same place.  Return's the number of lines written. */
+static Ulong log_async_drain(LogAsync *const a) {
+  struct iovec iov[LOG_ASYNC_BATCH];
+  LogSlot *slot;
+  Ulong pos = a->dequeue_pos;
+  Ulong bytes = 0;
+  Ulong n = 0;
+  Uint dest = 0;
+  for (; n < LOG_ASYNC_BATCH; ++n) {
+    slot = &a->slots[(pos + n) & a->mask];
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != (pos + n + 1) || (n && slot->dest != dest)) {
+      break;
+    }
+    /* Keep batches to the log file below `PIPE_BUF`, so they are written without a lock. */
+    if (n && slot->dest == LOG_DEST_FILE && (bytes + slot->len) >= PIPE_BUF) {
+      break;
+    }
+    bytes += slot->len;
+    dest = slot->dest;
+    iov[n].iov_base = (slot->heap ? slot->heap : slot->data);
+    iov[n].iov_len  = slot->len;
+  }
+  if (!n) {
+    return 0;
+  }
+  log_writev(dest, iov, n);
+  for (Ulong i=0; i<n; ++i) {
+    slot = &a->slots[(pos + i) & a->mask];
+    free(slot->heap);
+    slot->heap = NULL;
+    __atomic_store_n(&slot->seq, (pos + i + a->mask + 1), __ATOMIC_RELEASE);
+  }
+  __atomic_store_n(&a->dequeue_pos, (pos + n), __ATOMIC_RELEASE);
+  parking_notify(&a->not_full);
+  parking_notify(&a->flushed);
+  return n;
+}
+
+static bool log_async_ready(LogAsync *const a) {
+  Ulong pos = a->dequeue_pos;
+  return (__atomic_load_n(&a->slots[pos & a->mask].seq, __ATOMIC_ACQUIRE) == (pos + 1));
+}
+
+/* The writer thread.  Drains the ring for as long as there are lines, then sleeps for the flush interval, or until a
+ * producer finds a whole batch waiting. */
+static void *log_async_writer(void *arg) {
+  LogAsync *a = arg;
+  char buf[256];
+  Ulong reported = 0;
+  Ulong dropped;
+  Uint expected;
+  bool to_std;
+  int len;
+  log_async_writing = TRUE;
+  while (TRUE) {
+    if (log_async_drain(a)) {
+      continue;
+    }
+    if ((dropped = __atomic_load_n(&a->dropped, __ATOMIC_RELAXED)) != reported) {
+      to_std = (__atomic_load_n(&fcio_log_fd, __ATOMIC_RELAXED) == -1);
+      len = log_format_line(buf, sizeof(buf), FCIO_LOG_WARN_0, __LINE__, __func__, to_std,
+        "Dropped %lu log lines, the async log ring was full.", (dropped - reported));
+      log_write((to_std ? LOG_DEST_STDERR : LOG_DEST_FILE), buf, ((len < (int)sizeof(buf)) ? len : (int)(sizeof(buf) - 1)));
+      reported = dropped;
+    }
+    if (!__atomic_load_n(&a->running, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+    /* Let a time based sync, or rotation, happen even when nothing is being logged. */
+    if (__atomic_load_n(&fcio_log_fd, __ATOMIC_RELAXED) != -1) {
+      log_file_written(0);
     }
+    /* Same for the report of calls suppressed by a rate limited site. */
+    fcio_log_limit_poll();
+    expected = parking_prepare(&a->not_empty);
+    if (!log_async_ready(a) && __atomic_load_n(&a->running, __ATOMIC_ACQUIRE)) {
+      parking_wait(&a->not_empty, expected, &a->flush_interval);
+    }
+  }
+  return NULL;
+}
+
+/* Stop the writer of `a`, once it has written everything queued. */
+static void log_async_shutdown(LogAsync *const a) {
+  __atomic_store_n(&a->running, FALSE, __ATOMIC_RELEASE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  futex_wake(&a->not_empty.state, INT_MAX);
+  thread_join(a->thread, NULL);
+}
+
+/* Make sure whatever is still queued at exit gets written.  Other threads can still be logging at exit, and one that
+ * loaded `fcio_log_async` before it was cleared can still push to the ring, so unlike `fcio_log_async_stop()` nothing
+ * is freed.  What was pushed after the writer's last pass is written from here. */
+static void log_async_exit(void) {
+  LogAsync *a = __atomic_exchange_n(&fcio_log_async, NULL, __ATOMIC_ACQ_REL);
+  if (!a) {
+    return;
+  }
+  log_async_shutdown(a);
+  while (log_async_drain(a));
+}
+
+static void log_async_register_atexit(void) {
+  atexit(log_async_exit);
+}
+
+/* ----------------------------- Log emit ----------------------------- */
+
+/* Return's where a line of `type` goes. */
+static inline Uint log_dest(int type) {
+  if (__atomic_load_n(&fcio_log_fd, __ATOMIC_RELAXED) != -1) {
+    return LOG_DEST_FILE;
+  }
+  return ((type >= FCIO_LOG_ERR_NF) ? LOG_DEST_STDERR : LOG_DEST_STDOUT);
+}
+
+/* Hand the formatted line `data` to the async writer, or write it right away.  When `heap` is not `NULL` it holds the
+ * line, and is freed once written. */
+static void log_emit(Uint dest, const char *const data, Ulong len, char *heap) {
+  LogAsync *a = __atomic_load_n(&fcio_log_async, __ATOMIC_ACQUIRE);
+  if (a && !log_async_writing) {
+    log_async_push(a, dest, data, len, heap);
+  }
+  else {
+    log_write(dest, data, len);
+    free(heap);
+  }
+}
+
+/* ----------------------------- Fcio log va ----------------------------- */
+
+/* Format and log one line.  When `sync` is `TRUE` the line is written right away, even when the async backend is
+ * running, so it can never be dropped. */
+_PRINTFLIKE(4, 0)
+static void fcio_log_va(int type, Ulong lineno,
+  const char *const restrict function, const char *const restrict format, va_list ap, bool sync)
+{
+  ASSERT(format);
+  ASSERT(type >= FCIO_LOG_TYPE_FIRST && type <= FCIO_LOG_TYPE_LAST);
+  Uint dest = log_dest(type);
+  /* Only when logging to std out/err do we color the text using ascii esc codes. */
+  bool log_to_std = (dest != LOG_DEST_FILE);
+  char *data = fcio_log_buffer;
+  char *heap = NULL;
+  va_list copy;
+  int len;
+  va_copy(copy, ap);
+  len = log_format(data, LOG_LINE_MAX, type, lineno, function, log_to_std, format, copy);
+  va_end(copy);
+  if (len >= LOG_LINE_MAX) {
+    data = heap = xmalloc(len + 1);
+    len  = log_format(data, (len + 1), type, lineno, function, log_to_std, format, ap);
+  }
+  if (sync) {
+    log_write(dest, data, len);
+    free(heap);
   }
   else {
-    mutex_fdlock_full_wr(&fcio_log_mutex, fcio_log_fd, written, len, data, datalen, TRUE);
+    log_emit(dest, data, len, heap);
   }
-  free(data);
 }
 
 
@@ -140,6 +657,7 @@ static void fcio_log_va(int type, Ulong lineno,
 void fcio_log_set_file(const char *const restrict path) {
   ASSERT(path);
   struct stat info;
+  int fd;
   if (access(path, F_OK) != 0) {
     die_callback("Cannot access '%s'.  Check permissions.\n", path);
   }
@@ -161,12 +679,24 @@ void fcio_log_set_file(const char *const restrict path) {
     else if (S_ISCHR(info.st_mode)) {
       die_callback("Cannot write to '%s'.\n", path);
     }
-    /* If this is a good path, then open the file-descriptor. */
+    /* If this is a good path, then open the file-descriptor.  When a file is already open, the new one takes over its
+     * fd, so no writer ever sees a closed fd. */
     else {
       mutex_action(&fcio_log_mutex,
-        if ((fcio_log_fd = open(path, O_WRONLY)) == -1) {
+        if ((fd = log_file_open(path)) == -1) {
           die_callback("Failed to open '%s': %s\n", path, strerror(errno));
         }
+        if (fcio_log_fd != -1) {
+          dup3(fd, fcio_log_fd, O_CLOEXEC);
+          close(fd);
+        }
+        free(fcio_log_file.path);
+        fcio_log_file.path   = copy_of(path);
+        fcio_log_file.opened = fcio_now_ns();
+        fcio_log_file.synced = fcio_log_file.opened;
+        if (fcio_log_fd == -1) {
+          __atomic_store_n(&fcio_log_fd, fd, __ATOMIC_RELEASE);
+        }
       );
     }
   } 
@@ -178,19 +708,198 @@ void fcio_log(int type, Ulong lineno, const char *const restrict function, const
   ASSERT(format);
   va_list ap;
   va_start(ap, format);
-  fcio_log_va(type, lineno, function, format, ap);
+  fcio_log_va(type, lineno, function, format, ap, FALSE);
   va_end(ap);
 }
 
+/* ----------------------------- Fcio log write ----------------------------- */
+
+/* Write the already formatted line `data` of `type`, through the same path as `fcio_log()`, so it goes to the log file
+ * or std out/err, right away or through the async writer.  `data` should end with a newline. */
+void fcio_log_write(int type, const char *const restrict data, Ulong len) {
+  ASSERT(data);
+  ASSERT(type >= FCIO_LOG_TYPE_FIRST && type <= FCIO_LOG_TYPE_LAST);
+  log_emit(log_dest(type), data, len, NULL);
+}
+
+/* ----------------------------- Fcio log tag ----------------------------- */
+
+/* Return's the name of the log level `type`, like `"WARN_0"`. */
+const char *fcio_log_tag(int type) {
+  return ((type >= FCIO_LOG_TYPE_FIRST && type <= FCIO_LOG_TYPE_LAST) ? LOG_TAG(type) : "??????");
+}
+
 /* ----------------------------- Fcio log error fatal ----------------------------- */
 
 void fcio_log_error_fatal(Ulong lineno, const char *const restrict function, const char *const restrict format, ...) {
   ASSERT(format);
   va_list ap;
+  /* Write out everything logged before, then the fatal line itself, bypassing the async ring, as it would be dropped
+   * when the ring is full and the policy is `FCIO_LOG_ASYNC_DROP`. */
+  fcio_log_flush();
+  fcio_blog_flush();
   va_start(ap, format);
-  fcio_log_va(FCIO_LOG_ERR_FA, lineno, function, format, ap);
+  fcio_log_va(FCIO_LOG_ERR_FA, lineno, function, format, ap, TRUE);
   va_end(ap);
   die_callback("\nTERMINATING: The last log was a fatal error.\n");
 }
 
+/* ----------------------------- Fcio log set rotation ----------------------------- */
+
+/* Rotate the log file once it reaches `max_size` bytes, or once it has been open for `max_age_ns` nanoseconds, where
+ * `0` disables either.  The log is renamed to `path.N`, where `N` is one past the newest segment, and only the `keep`
+ * newest segments are kept.  When `compress` is `TRUE`, the segment before the one just rotated out is compressed by
+ * `gzip` in the background, to `path.N.gz`.  Processes sharing the log can all rotate it, as it's done under the fd
+ * lock, and the others just reopen the new file. */
+void fcio_log_set_rotation(Ulong max_size, Llong max_age_ns, Uint keep, bool compress) {
+  ALWAYS_ASSERT(keep >= 1);
+  mutex_action(&fcio_log_mutex,
+    fcio_log_file.max_size    = max_size;
+    fcio_log_file.max_age     = ((max_age_ns > 0) ? max_age_ns : 0);
+    fcio_log_file.keep        = keep;
+    fcio_log_file.compress    = compress;
+    fcio_log_file.check_bytes = (((max_size / 16) && (max_size / 16) < LOG_FILE_CHECK_BYTES) ? (max_size / 16) : LOG_FILE_CHECK_BYTES);
+  );
+}
+
+/* ----------------------------- Fcio log set fsync ----------------------------- */
+
+/* Sync the log file to disk after every `bytes` bytes, and at least every `interval_ns` nanoseconds while there is
+ * anything unsynced, where `0` disables either.  Syncs are done by whichever writer crosses the limit, or by the writer
+ * thread of the async backend, and never by more then one thread at a time. */
+void fcio_log_set_fsync(Ulong bytes, Llong interval_ns) {
+  mutex_action(&fcio_log_mutex,
+    fcio_log_file.sync_bytes    = bytes;
+    fcio_log_file.sync_interval = ((interval_ns > 0) ? interval_ns : 0);
+    fcio_log_file.synced        = fcio_now_ns();
+  );
+}
+
+/* ----------------------------- Fcio log rotate ----------------------------- */
+
+/* Rotate the log file right away, for instance on `SIGHUP`.  No-op when not logging to a file. */
+void fcio_log_rotate(void) {
+  if (__atomic_load_n(&fcio_log_fd, __ATOMIC_ACQUIRE) == -1) {
+    return;
+  }
+  while (__atomic_exchange_n(&fcio_log_file.busy, TRUE, __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+  log_file_check(TRUE);
+  __atomic_store_n(&fcio_log_file.busy, FALSE, __ATOMIC_RELEASE);
+}
+
+/* ----------------------------- Fcio log set mask ----------------------------- */
+
+/* Enable exactly the levels in `mask` for `module`, or for every module when it's `FCIO_LOG_MODULE_ALL`.  A level is
+ * enabled by `FCIO_LOG_MASK(type)`.  Note that fatal errors are always logged. */
+void fcio_log_set_mask(int module, Uint mask) {
+  ALWAYS_ASSERT(module == FCIO_LOG_MODULE_ALL || (module >= 0 && module < FCIO_LOG_MODULES));
+  Uchar disabled = (~(mask | FCIO_LOG_MASK(FCIO_LOG_ERR_FA)) & FCIO_LOG_MASK_ALL);
+  if (module != FCIO_LOG_MODULE_ALL) {
+    __atomic_store_n(&fcio_log_disabled[module], disabled, __ATOMIC_RELAXED);
+    return;
+  }
+  for (int i=0; i<FCIO_LOG_MODULES; ++i) {
+    __atomic_store_n(&fcio_log_disabled[i], disabled, __ATOMIC_RELAXED);
+  }
+}
+
+/* ----------------------------- Fcio log set level ----------------------------- */
+
+/* Enable `type` and every level above it for `module`, or for every module when it's `FCIO_LOG_MODULE_ALL`. */
+void fcio_log_set_level(int module, int type) {
+  ALWAYS_ASSERT(type >= FCIO_LOG_TYPE_FIRST && type <= FCIO_LOG_TYPE_LAST);
+  fcio_log_set_mask(module, (FCIO_LOG_MASK_ALL & ~(FCIO_LOG_MASK(type) - 1)));
+}
+
+/* ----------------------------- Fcio log get mask ----------------------------- */
+
+/* Return's the levels enabled for `module`. */
+Uint fcio_log_get_mask(int module) {
+  ALWAYS_ASSERT(module >= 0 && module < FCIO_LOG_MODULES);
+  return (~__atomic_load_n(&fcio_log_disabled[module], __ATOMIC_RELAXED) & FCIO_LOG_MASK_ALL);
+}
+
+/* ----------------------------- Fcio log async start ----------------------------- */
+
+/* Start writing log lines from a background thread.  From here on a log call only formats the line and pushes it onto
+ * a ring of `capacity` lines (rounded up to a power of two), and the writer thread writes them out in batches, as soon
+ * as a batch is full, and at the latest every `flush_ns` nanoseconds (`0` for the default of 10ms).  `policy` decides
+ * what a log call does when the ring is full, `FCIO_LOG_ASYNC_BLOCK` waits for room, and `FCIO_LOG_ASYNC_DROP` drops
+ * the line, where the writer then reports how many were dropped.  Everything still queued is written at exit. */
+void fcio_log_async_start(Ulong capacity, int policy, Llong flush_ns) {
+  ALWAYS_ASSERT(policy == FCIO_LOG_ASYNC_BLOCK || policy == FCIO_LOG_ASYNC_DROP);
+  LogAsync *a;
+  Ulong cap = LOG_ASYNC_BATCH;
+  if (__atomic_load_n(&fcio_log_async, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  while (cap < capacity) {
+    cap <<= 1;
+  }
+  if (flush_ns <= 0) {
+    flush_ns = LOG_ASYNC_FLUSH_NS;
+  }
+  a = xmalloc_aligned(_CACHELINE_SIZE, sizeof(*a));
+  memset(a, 0, sizeof(*a));
+  a->slots = xmalloc(sizeof(*a->slots) * cap);
+  for (Ulong i=0; i<cap; ++i) {
+    a->slots[i].seq  = i;
+    a->slots[i].heap = NULL;
+  }
+  a->mask    = (cap - 1);
+  a->policy  = policy;
+  a->running = TRUE;
+  a->flush_interval.tv_sec  = (flush_ns / 1000000000LL);
+  a->flush_interval.tv_nsec = (flush_ns % 1000000000LL);
+  if (thread_create(&a->thread, NULL, log_async_writer, a) != 0) {
+    die_callback("Failed to start the log writer thread: %s\n", strerror(errno));
+  }
+  pthread_once(&fcio_log_atexit_once, log_async_register_atexit);
+  __atomic_store_n(&fcio_log_async, a, __ATOMIC_RELEASE);
+}
+
+/* ----------------------------- Fcio log async stop ----------------------------- */
+
+/* Write everything still queued, stop the writer thread, and go back to writing lines right away.  Note that no other
+ * thread may log while this runs, as the ring is freed.  At exit this is not called, the ring is only drained there. */
+void fcio_log_async_stop(void) {
+  LogAsync *a = __atomic_exchange_n(&fcio_log_async, NULL, __ATOMIC_ACQ_REL);
+  if (!a) {
+    return;
+  }
+  log_async_shutdown(a);
+  free(a->slots);
+  free(a);
+}
+
+/* ----------------------------- Fcio log flush ----------------------------- */
+
+/* Block until every line logged before this call has been written.  No-op when the async backend is not running. */
+void fcio_log_flush(void) {
+  LogAsync *a = __atomic_load_n(&fcio_log_async, __ATOMIC_ACQUIRE);
+  Ulong target;
+  Uint expected;
+  if (!a) {
+    return;
+  }
+  target = __atomic_load_n(&a->enqueue_pos, __ATOMIC_ACQUIRE);
+  while (__atomic_load_n(&a->dequeue_pos, __ATOMIC_ACQUIRE) < target) {
+    expected = parking_prepare(&a->flushed);
+    parking_notify(&a->not_empty);
+    if (__atomic_load_n(&a->dequeue_pos, __ATOMIC_ACQUIRE) < target) {
+      parking_wait(&a->flushed, expected, NULL);
+    }
+  }
+}
+
+/* ----------------------------- Fcio log async dropped ----------------------------- */
+
+/* Return's the number of lines dropped since the async backend was started. */
+Ulong fcio_log_async_dropped(void) {
+  LogAsync *a = __atomic_load_n(&fcio_log_async, __ATOMIC_ACQUIRE);
+  return (a ? __atomic_load_n(&a->dropped, __ATOMIC_RELAXED) : 0);
+}
+
 #endif
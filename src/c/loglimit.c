@@ -0,0 +1,178 @@
+/** @file loglimit.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Per call-site sampling and rate limiting of log calls.
+
+  Every `FCIO_LOG_LIMITED()` expansion, like `log_WARN_0_RATE()` and `log_WARN_0_SAMPLE()`, has a static
+  `fcio_log_limit_t`, that `fcio_log_limit()` checks before the line is formatted.  Sampling is a single atomic add
+  on the call count, and the rate limit is a GCRA, a token bucket kept as the one timestamp at which the bucket would be
+  full again, that is taken with a single compare and swap.  So a log storm never waits on a lock just to find out that
+  its line is dropped.  Sites that dropped anything are put on a list, and once every interval, the next limited call,
+  or the async writer when it wakes up, reports how many calls every site dropped since the last report.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* The default time between two reports of the suppressed calls. */
+#define LOGLIMIT_INTERVAL_NS  (10000000000L)
+
+/* The most a rate limited site can get ahead, so it can log a full second worth of calls at once. */
+#define LOGLIMIT_BURST_NS  (1000000000L)
+
+/* Sites without a rate limit do not read the clock on their own, so they only check if a report is due at their
+ * first suppressed call, and then once every this many. */
+#define LOGLIMIT_CHECK_EVERY  (256)
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+/* Every site that has suppressed at least one call. */
+static fcio_log_limit_t *loglimit_sites = NULL;
+
+static pthread_once_t loglimit_once = PTHREAD_ONCE_INIT;
+
+static Llong loglimit_interval = LOGLIMIT_INTERVAL_NS;
+
+/* When the next report is due, or zero before anything was suppressed. */
+static Llong loglimit_next = 0;
+
+/* Set while a thread is reporting, so only one of the callers that notice it's due does it. */
+static Uint loglimit_reporting = FALSE;
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+static void loglimit_init(void) {
+  atexit(fcio_log_limit_report);
+}
+
+static void loglimit_register(fcio_log_limit_t *const site) {
+  Uint expected = FALSE;
+  if (!__atomic_compare_exchange_n(&site->registered, &expected, TRUE, FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    return;
+  }
+  pthread_once(&loglimit_once, loglimit_init);
+  site->next = __atomic_load_n(&loglimit_sites, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&loglimit_sites, &site->next, site, TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/* Take one call out of the rate limit of `site`.  Return's `FALSE` when the site is over its rate. */
+static bool loglimit_take(fcio_log_limit_t *const site, Llong now) {
+  Llong tat = __atomic_load_n(&site->tat, __ATOMIC_RELAXED);
+  Llong next;
+  do {
+    next = (((tat > now) ? tat : now) + site->interval);
+    if ((next - now) > LOGLIMIT_BURST_NS) {
+      return FALSE;
+    }
+  } while (!__atomic_compare_exchange_n(&site->tat, &tat, next, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  return TRUE;
+}
+
+/* Report the suppressed calls when the interval has passed. */
+static void loglimit_check_report(Llong now) {
+  Llong next = __atomic_load_n(&loglimit_next, __ATOMIC_RELAXED);
+  if (!next) {
+    __atomic_compare_exchange_n(&loglimit_next, &next, (now + __atomic_load_n(&loglimit_interval, __ATOMIC_RELAXED)),
+      FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  }
+  else if (now >= next) {
+    fcio_log_limit_report();
+  }
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Fcio log limit ----------------------------- */
+
+/* Return's `TRUE` when a call of `site` should be logged, and counts it as suppressed otherwise.  Use the
+ * `FCIO_LOG_LIMITED()` macros rather then calling this directly. */
+bool fcio_log_limit(fcio_log_limit_t *const site) {
+  ASSERT(site);
+  Ulong n = __atomic_fetch_add(&site->calls, 1, __ATOMIC_RELAXED);
+  Ulong suppressed;
+  Llong now = 0;
+  bool pass = (n < site->first || (site->every && !(((n - site->first) + 1) % site->every)));
+  if (pass && site->interval) {
+    now  = fcio_now_ns();
+    pass = loglimit_take(site, now);
+  }
+  if (!pass) {
+    if (!__atomic_load_n(&site->registered, __ATOMIC_RELAXED)) {
+      loglimit_register(site);
+    }
+    suppressed = __atomic_add_fetch(&site->suppressed, 1, __ATOMIC_RELAXED);
+    if (now) {
+      loglimit_check_report(now);
+    }
+    else if ((suppressed % LOGLIMIT_CHECK_EVERY) == 1) {
+      loglimit_check_report(fcio_now_ns());
+    }
+  }
+  /* Passing calls check as well, so the report of a storm comes once it's over, and not only with the next one.  The
+   * line is about to be formatted anyway, so the clock is cheap here. */
+  else if (__atomic_load_n(&loglimit_next, __ATOMIC_RELAXED)) {
+    loglimit_check_report(now ? now : fcio_now_ns());
+  }
+  return pass;
+}
+
+/* ----------------------------- Fcio log limit poll ----------------------------- */
+
+/* Report the suppressed calls when the interval has passed.  The async writer calls this every time it wakes up, so a
+ * report is not held back until the next limited call.  This is only a load when nothing was ever suppressed. */
+void fcio_log_limit_poll(void) {
+  if (__atomic_load_n(&loglimit_next, __ATOMIC_RELAXED)) {
+    loglimit_check_report(fcio_now_ns());
+  }
+}
+
+/* ----------------------------- Fcio log limit report ----------------------------- */
+
+/* Log one line for every rate limited site that suppressed calls since the last report, at the level of the site.
+ * This runs on its own every interval, and at exit, but can be called to report right away. */
+void fcio_log_limit_report(void) {
+  Ulong suppressed;
+  Ulong delta;
+  const char *file;
+  if (__atomic_exchange_n(&loglimit_reporting, TRUE, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  __atomic_store_n(&loglimit_next, (fcio_now_ns() + __atomic_load_n(&loglimit_interval, __ATOMIC_RELAXED)), __ATOMIC_RELAXED);
+  for (fcio_log_limit_t *site=__atomic_load_n(&loglimit_sites, __ATOMIC_ACQUIRE); site; site=site->next) {
+    suppressed = __atomic_load_n(&site->suppressed, __ATOMIC_RELAXED);
+    if (!(delta = (suppressed - site->reported))) {
+      continue;
+    }
+    site->reported = suppressed;
+    file = strrchr(site->file, '/');
+    file = (file ? (file + 1) : site->file);
+    fcio_log(site->level, site->line, site->func, "%s:%d: suppressed %lu messages since the last report (%lu of %lu in total)",
+      file, site->line, delta, suppressed, __atomic_load_n(&site->calls, __ATOMIC_RELAXED));
+  }
+  __atomic_store_n(&loglimit_reporting, FALSE, __ATOMIC_RELEASE);
+}
+
+/* ----------------------------- Fcio log set limit interval ----------------------------- */
+
+/* Set how often the suppressed calls of rate limited sites are reported, ten seconds by default. */
+void fcio_log_set_limit_interval(Llong interval_ns) {
+  ALWAYS_ASSERT(interval_ns > 0);
+  __atomic_store_n(&loglimit_interval, interval_ns, __ATOMIC_RELAXED);
+  __atomic_store_n(&loglimit_next, 0, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -28,3 +28,16 @@ void *xcalloc(Ulong n, Ulong size) {
   ALWAYS_ASSERT(ptr);
   return ptr;
 }
+
+#if !__WIN__
+/* Return's a allocated ptr of size `howmush` aligned to `align`, which must be a power of 2 and a multiple
+ * of `sizeof(void *)`.  The ptr can be released using `free()`.  Note that this can never return an invalid ptr. */
+void *xmalloc_aligned(Ulong align, Ulong howmush) {
+  void *ptr;
+  int error = posix_memalign(&ptr, align, howmush);
+  if (error) {
+    die_callback("Failed to allocate %lu bytes aligned to %lu: %s\n", howmush, align, strerror(error));
+  }
+  return ptr;
+}
+#endif
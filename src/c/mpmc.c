@@ -0,0 +1,291 @@
+/** @file mpmc.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Bounded lock-free multi-producer/multi-consumer queue.  Every cell carries a sequence number that tells
+  both sides whether the cell is ready to be written to or read from for a given position, so a push or
+  pop is one CAS on the position index, and producers and consumers never touch the same index.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+#include "../include/statics.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* The number of times a blocking call re-checks the queue before parking on the futex. */
+#define MPMC_SPIN_COUNT  (128)
+
+#define ASSERT_MPMC(x)   \
+  DO_WHILE(              \
+    ASSERT((x));         \
+    ASSERT((x)->cells);  \
+  )
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+typedef struct {
+  Ulong seq;
+  void *data;
+} MpmcCell;
+
+struct MPMC_T {
+  /* Read-only after creation. */
+  Ulong mask;
+  MpmcCell *cells;
+  void (*free_func)(void *);
+  /* The next position to push to, shared by all producers. */
+  Ulong enqueue_pos _ALIGNED(_CACHELINE_SIZE);
+  /* The next position to pop from, shared by all consumers. */
+  Ulong dequeue_pos _ALIGNED(_CACHELINE_SIZE);
+  /* Parking for consumers when empty, and for producers when full. */
+  parking_t not_empty _ALIGNED(_CACHELINE_SIZE);
+  parking_t not_full  _ALIGNED(_CACHELINE_SIZE);
+};
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* Try to push `data` without notifying any parked consumer. */
+static bool mpmc_try_push_internal(MPMC q, void *data) {
+  MpmcCell *cell;
+  Ulong pos = __atomic_load_n(&q->enqueue_pos, __ATOMIC_RELAXED);
+  long diff;
+  while (TRUE) {
+    cell = &q->cells[pos & q->mask];
+    diff = ((long)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (long)pos);
+    /* The cell is free for this position, try to claim it. */
+    if (!diff) {
+      if (__atomic_compare_exchange_n(&q->enqueue_pos, &pos, (pos + 1), TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    }
+    /* The cell still holds the entry from one lap ago, so the queue is full. */
+    else if (diff < 0) {
+      return FALSE;
+    }
+    /* Another producer claimed this position, reload. */
+    else {
+      pos = __atomic_load_n(&q->enqueue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  cell->data = data;
+  __atomic_store_n(&cell->seq, (pos + 1), __ATOMIC_RELEASE);
+  return TRUE;
+}
+
+/* Try to pop into `*out` without notifying any parked producer. */
+static bool mpmc_try_pop_internal(MPMC q, void **const out) {
+  MpmcCell *cell;
+  Ulong pos = __atomic_load_n(&q->dequeue_pos, __ATOMIC_RELAXED);
+  long diff;
+  while (TRUE) {
+    cell = &q->cells[pos & q->mask];
+    diff = ((long)__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (long)(pos + 1));
+    /* The cell holds the entry for this position, try to claim it. */
+    if (!diff) {
+      if (__atomic_compare_exchange_n(&q->dequeue_pos, &pos, (pos + 1), TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    }
+    /* Nothing has been pushed to this position yet, so the queue is empty. */
+    else if (diff < 0) {
+      return FALSE;
+    }
+    /* Another consumer claimed this position, reload. */
+    else {
+      pos = __atomic_load_n(&q->dequeue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  *out = cell->data;
+  /* Mark the cell as free for the position one lap ahead. */
+  __atomic_store_n(&cell->seq, (pos + q->mask + 1), __ATOMIC_RELEASE);
+  return TRUE;
+}
+
+/* Return's `TRUE` when the cell at the current dequeue position holds a entry. */
+static bool mpmc_has_data(MPMC q) {
+  Ulong pos = __atomic_load_n(&q->dequeue_pos, __ATOMIC_RELAXED);
+  return (__atomic_load_n(&q->cells[pos & q->mask].seq, __ATOMIC_ACQUIRE) == (pos + 1));
+}
+
+/* Return's `TRUE` when the cell at the current enqueue position is free. */
+static bool mpmc_has_room(MPMC q) {
+  Ulong pos = __atomic_load_n(&q->enqueue_pos, __ATOMIC_RELAXED);
+  return (__atomic_load_n(&q->cells[pos & q->mask].seq, __ATOMIC_ACQUIRE) == pos);
+}
+
+/* Spin for a while, then park on `p` until notified, unless `ready(q)` becomes true while we register as a waiter. */
+static void mpmc_park(MPMC q, parking_t *const p, bool (*ready)(MPMC)) {
+  Uint expected;
+  for (int i=0; i<MPMC_SPIN_COUNT; ++i) {
+    if (ready(q)) {
+      return;
+    }
+    CPU_RELAX();
+  }
+  expected = parking_prepare(p);
+  if (!ready(q)) {
+    parking_wait(p, expected, NULL);
+  }
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* Create a multi-producer/multi-consumer queue that can hold at least `cap` entries.  Note that
+ * `cap` is rounded up to the nearest power of 2 (at least 2), and that the queue never reallocates. */
+MPMC mpmc_create(Ulong cap) {
+  ALWAYS_ASSERT(cap);
+  Ulong realcap = 2;
+  MPMC q = xmalloc_aligned(_CACHELINE_SIZE, sizeof(*q));
+  memset(q, 0, sizeof(*q));
+  while (realcap < cap) {
+    realcap <<= 1;
+  }
+  q->mask  = (realcap - 1);
+  q->cells = xmalloc_aligned(_CACHELINE_SIZE, (sizeof(*q->cells) * realcap));
+  for (Ulong i=0; i<realcap; ++i) {
+    q->cells[i].seq = i;
+  }
+  return q;
+}
+
+/* Free `q`, calling `free_func` on all entries that are still in the queue.  Note
+ * that no thread may be using the queue when this is called.  No-op on `NULL`. */
+void mpmc_free(MPMC q) {
+  void *data;
+  if (!q) {
+    return;
+  }
+  while (mpmc_try_pop_internal(q, &data)) {
+    CALL_IF_VALID(q->free_func, data);
+  }
+  free(q->cells);
+  free(q);
+}
+
+/* Must be set before the queue is shared between threads. */
+void mpmc_set_free_func(MPMC q, void (*free_func)(void *)) {
+  ASSERT(q);
+  q->free_func = free_func;
+}
+
+Ulong mpmc_cap(MPMC q) {
+  ASSERT_MPMC(q);
+  return (q->mask + 1);
+}
+
+/* Return's a snapshot of the number of entries in the queue.  Note that under
+ * concurrent use this can be stale by the time it's returned. */
+Ulong mpmc_size(MPMC q) {
+  ASSERT_MPMC(q);
+  Ulong tail = __atomic_load_n(&q->enqueue_pos, __ATOMIC_ACQUIRE);
+  Ulong head = __atomic_load_n(&q->dequeue_pos, __ATOMIC_ACQUIRE);
+  return ((tail > head) ? (tail - head) : 0);
+}
+
+/* ----------------------------- Push ----------------------------- */
+
+/* Return's `FALSE` when the queue is full. */
+bool mpmc_try_push(MPMC q, void *data) {
+  ASSERT_MPMC(q);
+  if (mpmc_try_push_internal(q, data)) {
+    parking_notify(&q->not_empty);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* Push `data`, parking the caller while the queue is full. */
+void mpmc_push(MPMC q, void *data) {
+  ASSERT_MPMC(q);
+  while (!mpmc_try_push(q, data)) {
+    mpmc_park(q, &q->not_full, mpmc_has_room);
+  }
+}
+
+/* Push as many as possible, up to `n` entries from `data`, in order.  Parked consumers are only notified once
+ * for the whole batch.  Return's the number of entries pushed.  Note that entries from other producers can
+ * be interleaved with the batch. */
+Ulong mpmc_try_push_many(MPMC q, void *const *const data, Ulong n) {
+  ASSERT_MPMC(q);
+  ASSERT(data || !n);
+  Ulong pushed = 0;
+  while (pushed < n && mpmc_try_push_internal(q, data[pushed])) {
+    ++pushed;
+  }
+  if (pushed) {
+    parking_notify(&q->not_empty);
+  }
+  return pushed;
+}
+
+/* Push all `n` entries from `data`, parking the caller whenever the queue is full. */
+void mpmc_push_many(MPMC q, void *const *const data, Ulong n) {
+  ASSERT_MPMC(q);
+  Ulong pushed = 0;
+  while ((pushed += mpmc_try_push_many(q, (data + pushed), (n - pushed))) < n) {
+    mpmc_park(q, &q->not_full, mpmc_has_room);
+  }
+}
+
+/* ----------------------------- Pop ----------------------------- */
+
+/* Return's `FALSE` when the queue is empty. */
+bool mpmc_try_pop(MPMC q, void **const out) {
+  ASSERT_MPMC(q);
+  ASSERT(out);
+  if (mpmc_try_pop_internal(q, out)) {
+    parking_notify(&q->not_full);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* Pop a entry, parking the caller while the queue is empty. */
+void *mpmc_pop(MPMC q) {
+  ASSERT_MPMC(q);
+  void *ret;
+  while (!mpmc_try_pop(q, &ret)) {
+    mpmc_park(q, &q->not_empty, mpmc_has_data);
+  }
+  return ret;
+}
+
+/* Pop at most `n` entries into `out`.  Parked producers are only notified once for
+ * the whole batch.  Return's the number of entries popped, which can be zero. */
+Ulong mpmc_try_pop_many(MPMC q, void **const out, Ulong n) {
+  ASSERT_MPMC(q);
+  ASSERT(out || !n);
+  Ulong popped = 0;
+  while (popped < n && mpmc_try_pop_internal(q, (out + popped))) {
+    ++popped;
+  }
+  if (popped) {
+    parking_notify(&q->not_full);
+  }
+  return popped;
+}
+
+/* Same as `mpmc_try_pop_many()`, but parks the caller until at least one entry can be popped. */
+Ulong mpmc_pop_many(MPMC q, void **const out, Ulong n) {
+  ASSERT_MPMC(q);
+  ALWAYS_ASSERT(n);
+  Ulong ret;
+  while (!(ret = mpmc_try_pop_many(q, out, n))) {
+    mpmc_park(q, &q->not_empty, mpmc_has_data);
+  }
+  return ret;
+}
+
+#endif
@@ -0,0 +1,196 @@
+/** @file parallel.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Data-parallel loops on top of the default thread pool.  A range is split in halves, where one half is spawned as a task and
+  the other is split further, down to chunks of `grain` indices.  So idle workers steal the largest pieces that are left, and
+  the load balances itself, even when some chunks take far longer then others.
+
+ */
+#include "../include/proto.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* When no grain is given, aim for this many chunks per worker, so stealing has enough pieces to balance with. */
+#define PARALLEL_CHUNKS_PER_WORKER  (8)
+
+/* One split per level, so this is enough for any range of `Ulong` indices. */
+#define PARALLEL_MAX_SPLITS  (64)
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+typedef struct {
+  THREAD_POOL pool;
+  Ulong grain;
+  void  (*func)(Ulong begin, Ulong end, void *ctx);
+  void *(*map)(Ulong begin, Ulong end, void *ctx);
+  void *(*combine)(void *a, void *b, void *ctx);
+  void *ctx;
+} ParallelJob;
+
+typedef struct {
+  ParallelJob *job;
+  Ulong begin;
+  Ulong end;
+  void *result;
+} ParallelRange;
+
+/* The context for the per-item loops over containers. */
+typedef struct {
+  void *container;
+  void (*func)(void *item, void *ctx);
+  void (*entry_func)(directory_entry_t *entry, void *ctx);
+  void *ctx;
+} ParallelItems;
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+static void parallel_range_task(void *arg);
+
+/* Run `job` over `[begin, end)`.  The upper halves are spawned, while the calling thread keeps the lowest chunk, and then
+ * helps with the spawned halves until they are done.  For a reduce, the result is combined in index order. */
+static void *parallel_split(ParallelJob *job, Ulong begin, Ulong end) {
+  ParallelRange right[PARALLEL_MAX_SPLITS];
+  task_group_t group;
+  Ulong n = 0;
+  Ulong mid;
+  void *result = NULL;
+  task_group_init(&group, job->pool);
+  while ((end - begin) > job->grain) {
+    mid = (begin + ((end - begin) / 2));
+    right[n].job   = job;
+    right[n].begin = mid;
+    right[n].end   = end;
+    task_group_spawn(&group, parallel_range_task, &right[n]);
+    ++n;
+    end = mid;
+  }
+  if (job->map) {
+    result = job->map(begin, end, job->ctx);
+  }
+  else {
+    job->func(begin, end, job->ctx);
+  }
+  if (n) {
+    task_group_sync(&group);
+  }
+  /* The last spawned range is the one directly after ours. */
+  if (job->map) {
+    while (n--) {
+      result = job->combine(result, right[n].result, job->ctx);
+    }
+  }
+  return result;
+}
+
+static void parallel_range_task(void *arg) {
+  ParallelRange *range = arg;
+  range->result = parallel_split(range->job, range->begin, range->end);
+}
+
+/* Return's `grain` when set, otherwise a grain that gives every worker a few chunks. */
+static Ulong parallel_grain(THREAD_POOL pool, Ulong n, Ulong grain) {
+  if (grain) {
+    return grain;
+  }
+  grain = (n / (thread_pool_nthreads(pool) * PARALLEL_CHUNKS_PER_WORKER));
+  return (grain ? grain : 1);
+}
+
+static void parallel_new_cvec_range(Ulong begin, Ulong end, void *arg) {
+  ParallelItems *items = arg;
+  for (Ulong i=begin; i<end; ++i) {
+    items->func(new_cvec_get(items->container, i), items->ctx);
+  }
+}
+
+static void parallel_cvec_range(Ulong begin, Ulong end, void *arg) {
+  ParallelItems *items = arg;
+  for (Ulong i=begin; i<end; ++i) {
+    items->func(cvec_get(items->container, (int)i), items->ctx);
+  }
+}
+
+static void parallel_directory_range(Ulong begin, Ulong end, void *arg) {
+  ParallelItems *items = arg;
+  directory_t *dir = items->container;
+  for (Ulong i=begin; i<end; ++i) {
+    items->entry_func(dir->entries[i], items->ctx);
+  }
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* Call `func` over `[begin, end)` in parallel on the default pool, where every call gets a sub-range of about `grain` indices, and `ctx`.
+ * When `grain` is zero, a grain is picked that gives every worker a few chunks.  Return's once all indices have been processed. */
+void fcio_parallel_for(Ulong begin, Ulong end, Ulong grain, void (*func)(Ulong begin, Ulong end, void *ctx), void *ctx) {
+  ASSERT(func);
+  ParallelJob job;
+  if (begin >= end) {
+    return;
+  }
+  job.pool    = thread_pool_default();
+  job.grain   = parallel_grain(job.pool, (end - begin), grain);
+  job.func    = func;
+  job.map     = NULL;
+  job.combine = NULL;
+  job.ctx     = ctx;
+  parallel_split(&job, begin, end);
+}
+
+/* Parallel map-reduce over `[begin, end)`.  `map` produces a result for every sub-range of about `grain` indices, and `combine` merges
+ * the results of two neighbouring ranges into one, where `a` is always the lower range.  So `combine` only needs to be associative, not
+ * commutative.  `combine` must also free or reuse `a` and `b` when they are allocated.  Return's the result for the whole range, or `NULL`
+ * when it's empty. */
+void *fcio_parallel_reduce(Ulong begin, Ulong end, Ulong grain, void *(*map)(Ulong begin, Ulong end, void *ctx), void *(*combine)(void *a, void *b, void *ctx), void *ctx) {
+  ASSERT(map);
+  ASSERT(combine);
+  ParallelJob job;
+  if (begin >= end) {
+    return NULL;
+  }
+  job.pool    = thread_pool_default();
+  job.grain   = parallel_grain(job.pool, (end - begin), grain);
+  job.func    = NULL;
+  job.map     = map;
+  job.combine = combine;
+  job.ctx     = ctx;
+  return parallel_split(&job, begin, end);
+}
+
+/* Call `func` with every item of `cv` and `ctx` in parallel.  Note that `cv` must not be modified until this returns. */
+void fcio_parallel_for_new_cvec(CVEC cv, Ulong grain, void (*func)(void *item, void *ctx), void *ctx) {
+  ASSERT(cv);
+  ASSERT(func);
+  ParallelItems items = { cv, func, NULL, ctx };
+  fcio_parallel_for(0, new_cvec_size(cv), grain, parallel_new_cvec_range, &items);
+}
+
+/* Call `func` with every item of `v` and `ctx` in parallel.  Note that `v` must not be modified until this returns. */
+void fcio_parallel_for_cvec(CVec *const v, Ulong grain, void (*func)(void *item, void *ctx), void *ctx) {
+  ASSERT(v);
+  ASSERT(func);
+  ParallelItems items = { v, func, NULL, ctx };
+  fcio_parallel_for(0, cvec_len(v), grain, parallel_cvec_range, &items);
+}
+
+/* Call `func` with every entry of `dir` and `ctx` in parallel.  Note that `dir` must not be modified until this returns. */
+void fcio_parallel_for_directory(directory_t *const dir, Ulong grain, void (*func)(directory_entry_t *entry, void *ctx), void *ctx) {
+  ASSERT(dir);
+  ASSERT(func);
+  ParallelItems items = { dir, NULL, func, ctx };
+  fcio_parallel_for(0, dir->len, grain, parallel_directory_range, &items);
+}
+
+#endif
@@ -0,0 +1,263 @@
+/** @file pqueue.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  D-ary min-heap priority queue.  Every entry is a handle that tracks its own index in the heap,
+  so a entry can have its key changed, or be removed, in `O(log n)` without searching for it.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* The number of children per node.  A wider heap is shallower, so a push or decrease-key touches
+ * fewer levels, and all children of a node are next to each other in memory when popping. */
+#ifndef PQUEUE_ARITY
+# define PQUEUE_ARITY  (4)
+#endif
+
+#define PQUEUE_INITIAL_CAP  (16)
+
+#define PQUEUE_PARENT(idx)  (((idx) - 1) / PQUEUE_ARITY)
+#define PQUEUE_CHILD(idx)   (((idx) * PQUEUE_ARITY) + 1)
+
+#define ASSERT_PQUEUE(x)  \
+  DO_WHILE(               \
+    ASSERT((x));          \
+    ASSERT((x)->heap);    \
+  )
+
+#define ASSERT_PQUEUE_HANDLE(pq, h)                                       \
+  DO_WHILE(                                                               \
+    ASSERT((h));                                                          \
+    ALWAYS_ASSERT((h)->idx < (pq)->size && (pq)->heap[(h)->idx] == (h));  \
+  )
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+struct PQUEUE_HANDLE_T {
+  Llong key;
+  Ulong idx;
+  void *data;
+};
+
+struct PQUEUE_T {
+  PQUEUE_HANDLE *heap;
+  Ulong size;
+  Ulong cap;
+  /* Released handles are kept here for reuse, linked through their `data` field. */
+  PQUEUE_HANDLE freelist;
+  void (*free_func)(void *);
+};
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* Place `h` at `idx`, keeping its index in sync. */
+static inline void pqueue_place(PQUEUE pq, PQUEUE_HANDLE h, Ulong idx) {
+  pq->heap[idx] = h;
+  h->idx = idx;
+}
+
+/* Move `h` towards the root until its parent has a smaller or equal key.  This moves the hole
+ * instead of swapping, so every level costs one write instead of three. */
+static void pqueue_sift_up(PQUEUE pq, PQUEUE_HANDLE h) {
+  Ulong idx = h->idx;
+  Ulong parent;
+  while (idx) {
+    parent = PQUEUE_PARENT(idx);
+    if (pq->heap[parent]->key <= h->key) {
+      break;
+    }
+    pqueue_place(pq, pq->heap[parent], idx);
+    idx = parent;
+  }
+  pqueue_place(pq, h, idx);
+}
+
+/* Move `h` towards the leafs until no child has a smaller key. */
+static void pqueue_sift_down(PQUEUE pq, PQUEUE_HANDLE h) {
+  Ulong idx = h->idx;
+  Ulong child;
+  Ulong end;
+  Ulong min;
+  while ((child = PQUEUE_CHILD(idx)) < pq->size) {
+    end = (((child + PQUEUE_ARITY) < pq->size) ? (child + PQUEUE_ARITY) : pq->size);
+    min = child;
+    for (Ulong i=(child + 1); i<end; ++i) {
+      if (pq->heap[i]->key < pq->heap[min]->key) {
+        min = i;
+      }
+    }
+    if (pq->heap[min]->key >= h->key) {
+      break;
+    }
+    pqueue_place(pq, pq->heap[min], idx);
+    idx = min;
+  }
+  pqueue_place(pq, h, idx);
+}
+
+static PQUEUE_HANDLE pqueue_handle_get(PQUEUE pq) {
+  PQUEUE_HANDLE h;
+  if (pq->freelist) {
+    h = pq->freelist;
+    pq->freelist = h->data;
+  }
+  else {
+    h = xmalloc(sizeof(*h));
+  }
+  return h;
+}
+
+static void pqueue_handle_release(PQUEUE pq, PQUEUE_HANDLE h) {
+  h->data = pq->freelist;
+  h->idx  = UlongMAX;
+  pq->freelist = h;
+}
+
+/* Unlink `h` from the heap, filling its place with the last entry.  Return's the data of `h`. */
+static void *pqueue_extract(PQUEUE pq, PQUEUE_HANDLE h) {
+  void *data = h->data;
+  PQUEUE_HANDLE last = pq->heap[--pq->size];
+  if (last != h) {
+    pqueue_place(pq, last, h->idx);
+    /* The last entry can need to move either way, as it came from another subtree. */
+    if (last->idx && pq->heap[PQUEUE_PARENT(last->idx)]->key > last->key) {
+      pqueue_sift_up(pq, last);
+    }
+    else {
+      pqueue_sift_down(pq, last);
+    }
+  }
+  pqueue_handle_release(pq, h);
+  return data;
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+PQUEUE pqueue_create(void) {
+  PQUEUE pq = xmalloc(sizeof(*pq));
+  pq->size      = 0;
+  pq->cap       = PQUEUE_INITIAL_CAP;
+  pq->heap      = xmalloc(_PTRSIZE * pq->cap);
+  pq->freelist  = NULL;
+  pq->free_func = NULL;
+  return pq;
+}
+
+/* Free `pq`, calling `free_func` on the data of all entries still in it.  No-op on `NULL`. */
+void pqueue_free(PQUEUE pq) {
+  PQUEUE_HANDLE next;
+  if (!pq) {
+    return;
+  }
+  for (Ulong i=0; i<pq->size; ++i) {
+    CALL_IF_VALID(pq->free_func, pq->heap[i]->data);
+    free(pq->heap[i]);
+  }
+  while (pq->freelist) {
+    next = pq->freelist->data;
+    free(pq->freelist);
+    pq->freelist = next;
+  }
+  free(pq->heap);
+  free(pq);
+}
+
+void pqueue_set_free_func(PQUEUE pq, void (*free_func)(void *)) {
+  ASSERT(pq);
+  pq->free_func = free_func;
+}
+
+Ulong pqueue_size(PQUEUE pq) {
+  ASSERT_PQUEUE(pq);
+  return pq->size;
+}
+
+/* Insert `data` with the priority `key`, where the smallest key is at the front.  The returned handle
+ * can be used to change the key of, or remove the entry, and is valid until the entry leaves the queue. */
+PQUEUE_HANDLE pqueue_push(PQUEUE pq, Llong key, void *data) {
+  ASSERT_PQUEUE(pq);
+  PQUEUE_HANDLE h;
+  ENSURE_PTR_ARRAY_SIZE(pq->heap, pq->cap, pq->size);
+  h = pqueue_handle_get(pq);
+  h->key  = key;
+  h->data = data;
+  h->idx  = pq->size++;
+  pqueue_sift_up(pq, h);
+  return h;
+}
+
+/* Return's the data of the entry with the smallest key, and assigns its key to `*key` when not `NULL`.  Must be called on a non empty queue. */
+void *pqueue_peek(PQUEUE pq, Llong *const key) {
+  ASSERT_PQUEUE(pq);
+  ALWAYS_ASSERT(pq->size > 0);
+  ASSIGN_IF_VALID(key, pq->heap[0]->key);
+  return pq->heap[0]->data;
+}
+
+/* Remove the entry with the smallest key and return its data, assigning its key to `*key` when not `NULL`.  Note
+ * that the ownership of the data moves to the caller, so `free_func` is not called.  Must be called on a non empty queue. */
+void *pqueue_pop(PQUEUE pq, Llong *const key) {
+  ASSERT_PQUEUE(pq);
+  ALWAYS_ASSERT(pq->size > 0);
+  ASSIGN_IF_VALID(key, pq->heap[0]->key);
+  return pqueue_extract(pq, pq->heap[0]);
+}
+
+/* Pop the entry with the smallest key into `*data` if, and only if, that key is at most `limit`.  This is the
+ * deadline case, where `limit` is the current time, and `key` is when the entry is due.  Return's `TRUE` on pop. */
+bool pqueue_pop_if_le(PQUEUE pq, Llong limit, void **const data) {
+  ASSERT_PQUEUE(pq);
+  ASSERT(data);
+  if (!pq->size || pq->heap[0]->key > limit) {
+    return FALSE;
+  }
+  *data = pqueue_extract(pq, pq->heap[0]);
+  return TRUE;
+}
+
+/* Lower the key of the entry `h` to `key`, which must not be more then the current key. */
+void pqueue_decrease_key(PQUEUE pq, PQUEUE_HANDLE h, Llong key) {
+  ASSERT_PQUEUE(pq);
+  ASSERT_PQUEUE_HANDLE(pq, h);
+  ALWAYS_ASSERT(key <= h->key);
+  h->key = key;
+  pqueue_sift_up(pq, h);
+}
+
+/* Change the key of the entry `h` to `key`, in either direction. */
+void pqueue_update_key(PQUEUE pq, PQUEUE_HANDLE h, Llong key) {
+  ASSERT_PQUEUE(pq);
+  ASSERT_PQUEUE_HANDLE(pq, h);
+  Llong old = h->key;
+  h->key = key;
+  if (key < old) {
+    pqueue_sift_up(pq, h);
+  }
+  else {
+    pqueue_sift_down(pq, h);
+  }
+}
+
+/* Remove the entry `h` and return its data.  Note that the ownership of the data moves to the caller. */
+void *pqueue_remove(PQUEUE pq, PQUEUE_HANDLE h) {
+  ASSERT_PQUEUE(pq);
+  ASSERT_PQUEUE_HANDLE(pq, h);
+  return pqueue_extract(pq, h);
+}
+
+Llong pqueue_handle_key(PQUEUE_HANDLE h) {
+  ASSERT(h);
+  return h->key;
+}
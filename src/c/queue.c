@@ -11,6 +11,7 @@
 /* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
 
 
+/* This MUST be a power of 2. */
 #define QUEUE_DEFAULT_CAP  (8)
 #define ASSERT_QUEUE(x)  \
   DO_WHILE(              \
@@ -18,14 +19,20 @@
     ASSERT((x)->data);   \
   )
 
+/* Get the ptr to the slot at logical index `idx`, counted from the front of the queue. */
+#define QUEUE_SLOT(q, idx)  ((q)->data[((q)->head + (idx)) & ((q)->cap - 1)])
+
 
 /* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
 
 
+/* A ring-buffer queue.  `cap` is always a power of 2, so all index
+ * wrapping is done with a mask, and elements never have to be moved. */
 struct QUEUE_T {
-  Ulong start;
+  Ulong head;
   Ulong size;
   Ulong cap;
+  bool  fixed;  /* When `TRUE`, the queue was created with a fixed capacity and will never reallocate. */
   void **data;
   void (*free_func)(void *);
 };
@@ -34,25 +41,65 @@ struct QUEUE_T {
 /* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
 
 
+/* Return the smallest power of 2 that is at least `x`. */
+static Ulong queue_pow2_roundup(Ulong x) {
+  Ulong ret = 1;
+  while (ret < x) {
+    ret <<= 1;
+  }
+  return ret;
+}
+
 /* Becomes a `nop` if there is no `free_func` set for the queue. */
 static void queue_free_data(QUEUE q) {
   ASSERT_QUEUE(q);
   if (q->free_func) {
-    for (Ulong i=q->start, end=(q->start + q->size) ; i<end; ++i) {
-      q->free_func(q->data[i]);
+    for (Ulong i=0; i<q->size; ++i) {
+      q->free_func(QUEUE_SLOT(q, i));
     }
   }
 }
 
+/* Double the capacity of `q`.  When the live elements wrap around the end of the old
+ * buffer, the wrapped prefix is moved directly after the old end, so that the layout
+ * stays continuous from `head` in the new buffer.  This is the only place elements move. */
+static void queue_grow(QUEUE q) {
+  ASSERT_QUEUE(q);
+  ALWAYS_ASSERT_MSG(!q->fixed, "Cannot grow a fixed capacity queue");
+  Ulong oldcap = q->cap;
+  Ulong wrapped;
+  q->cap *= 2;
+  q->data = xrealloc(q->data, (_PTRSIZE * q->cap));
+  if ((q->head + q->size) > oldcap) {
+    wrapped = ((q->head + q->size) - oldcap);
+    memcpy((q->data + oldcap), q->data, (_PTRSIZE * wrapped));
+  }
+}
+
 
 /* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
 
 
 QUEUE queue_create(void) {
   QUEUE q = xmalloc(sizeof *q);
-  q->start     = 0;
+  q->head      = 0;
   q->size      = 0;
   q->cap       = QUEUE_DEFAULT_CAP;
+  q->fixed     = FALSE;
+  q->data      = xmalloc(_PTRSIZE * q->cap);
+  q->free_func = NULL;
+  return q;
+}
+
+/* Create a queue that can hold at least `cap` entries, and that will never reallocate.  Note
+ * that `cap` is rounded up to the nearest power of 2.  Use `queue_try_push()` to push into it. */
+QUEUE queue_create_fixed(Ulong cap) {
+  ALWAYS_ASSERT(cap);
+  QUEUE q = xmalloc(sizeof *q);
+  q->head      = 0;
+  q->size      = 0;
+  q->cap       = queue_pow2_roundup(cap);
+  q->fixed     = TRUE;
   q->data      = xmalloc(_PTRSIZE * q->cap);
   q->free_func = NULL;
   return q;
@@ -78,41 +125,101 @@ Ulong queue_size(QUEUE q) {
   return q->size;
 }
 
+Ulong queue_cap(QUEUE q) {
+  ASSERT_QUEUE(q);
+  return q->cap;
+}
+
+/* Return's `TRUE` when the next push would either need to grow the queue, or fail for a fixed queue. */
+bool queue_is_full(QUEUE q) {
+  ASSERT_QUEUE(q);
+  return (q->size == q->cap);
+}
+
 /* Consumes the first entry, and if the queue has `free_func` set also call it on the entry. */
 void queue_pop(QUEUE q) {
   ASSERT(q);
   ALWAYS_ASSERT(q->size > 0);
-  CALL_IF_VALID(q->free_func, q->data[q->start]);
-  if (q->size == 1) {
-    q->size  = 0;
-    q->start = 0;
-  }
-  else {
-    --q->size;
-    ++q->start;
-  }
+  CALL_IF_VALID(q->free_func, q->data[q->head]);
+  q->head = ((q->head + 1) & (q->cap - 1));
+  --q->size;
 }
 
+/* Note that pushing into a full fixed capacity queue is a fatal error, see `queue_try_push()`. */
 void queue_push(QUEUE q, void *data) {
   ASSERT_QUEUE(q);
   ASSERT(data);
-  if ((q->start + q->size) == q->cap) {
-    /* If the queue is full. */
-    if (!q->start) {
-      q->cap *= 2;
-      q->data = xrealloc(q->data, (_PTRSIZE * q->cap));
+  if (q->size == q->cap) {
+    queue_grow(q);
+  }
+  QUEUE_SLOT(q, q->size) = data;
+  ++q->size;
+}
+
+/* Same as `queue_push()`, but return's `FALSE` instead of growing or
+ * terminating when a fixed capacity queue is full.  Otherwise, `TRUE`. */
+bool queue_try_push(QUEUE q, void *data) {
+  ASSERT_QUEUE(q);
+  ASSERT(data);
+  if (q->fixed && q->size == q->cap) {
+    return FALSE;
+  }
+  queue_push(q, data);
+  return TRUE;
+}
+
+/* Push `n` entries from `data` onto the back of the queue.  A growable queue is grown at most once.
+ * Return's the number of entries pushed, which for a fixed queue can be less then `n` when it fills up. */
+Ulong queue_push_many(QUEUE q, void *const *const data, Ulong n) {
+  ASSERT_QUEUE(q);
+  ASSERT(data || !n);
+  Ulong tail;
+  Ulong first;
+  if ((q->size + n) > q->cap) {
+    if (q->fixed) {
+      n = (q->cap - q->size);
     }
     else {
-      memmove(q->data, (q->data + q->start), (_PTRSIZE * (q->cap - q->start)));
-      q->start = 0;
+      while ((q->size + n) > q->cap) {
+        queue_grow(q);
+      }
+    }
+  }
+  /* Copy in at most two segments, the one up to the end of the buffer, then the wrapped one. */
+  tail  = ((q->head + q->size) & (q->cap - 1));
+  first = (((q->cap - tail) < n) ? (q->cap - tail) : n);
+  memcpy((q->data + tail), data, (_PTRSIZE * first));
+  memcpy(q->data, (data + first), (_PTRSIZE * (n - first)));
+  q->size += n;
+  return n;
+}
+
+/* Pop at most `n` entries from the front of the queue into `out`, and return the number popped.  Note that the ownership
+ * of all popped entries moves to the caller, so `free_func` is not called on them.  When `out` is `NULL`, all popped
+ * entries are instead consumed in the same way as `queue_pop()` does. */
+Ulong queue_pop_many(QUEUE q, void **const out, Ulong n) {
+  ASSERT_QUEUE(q);
+  Ulong first;
+  if (n > q->size) {
+    n = q->size;
+  }
+  if (!out) {
+    for (Ulong i=0; i<n; ++i) {
+      queue_pop(q);
     }
+    return n;
   }
-  q->data[q->start + q->size++] = data;
+  first = (((q->cap - q->head) < n) ? (q->cap - q->head) : n);
+  memcpy(out, (q->data + q->head), (_PTRSIZE * first));
+  memcpy((out + first), q->data, (_PTRSIZE * (n - first)));
+  q->head  = ((q->head + n) & (q->cap - 1));
+  q->size -= n;
+  return n;
 }
 
 /* Must be called on a non empty queue. */
 void *queue_front(QUEUE q) {
   ASSERT(q);
   ALWAYS_ASSERT(q->size > 0);
-  return q->data[q->start];
+  return q->data[q->head];
 }
@@ -0,0 +1,226 @@
+/** @file rwlock.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Reader-biased read-write lock and seqlock.
+
+  `PRWLOCK` keeps one reader counter per online cpu, each on its own cache line, and every thread sticks to one of them.
+  So readers that hold the lock at the same time never write to the same line, and a read lock is one atomic add on a
+  line that is usually already owned by the reader's cpu.  Writers pay for this instead, as they have to check every
+  counter.  Use it for data that is read all the time and rarely written.
+
+  `seqlock_t` is for small state that is read far more often then written, where readers never write shared memory at
+  all.  A reader copies the state out and retries when a writer was active in the meantime.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+#include "../include/statics.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* The number of rounds a blocked reader or writer spins before it parks. */
+#define RWLOCK_SPIN_COUNT  (64)
+
+#define ASSERT_PRWLOCK(x)  \
+  DO_WHILE(                \
+    ASSERT((x));           \
+    ASSERT((x)->slots);    \
+  )
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+typedef struct {
+  Ulong readers;
+} _ALIGNED(_CACHELINE_SIZE) PrwlockSlot;
+
+struct PRWLOCK_T {
+  PrwlockSlot *slots;
+  Ulong mask;
+  /* Serializes writers. */
+  fmutex_t wlock;
+  /* Nonzero while a writer holds, or is waiting for, the lock.  Blocked readers park on this word. */
+  Uint writer _ALIGNED(_CACHELINE_SIZE);
+  /* The writer parks here while readers drain. */
+  parking_t drain _ALIGNED(_CACHELINE_SIZE);
+};
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+static Uint next_slot = 0;
+
+/* The reader slot of the calling thread, or `-1` before its first read lock. */
+static _THREAD long current_slot = -1;
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* Return's the reader slot of the calling thread in `l`.  Threads are handed slots round-robin, so with no more
+ * threads then cpu's, every reader has a counter of its own. */
+static inline PrwlockSlot *prwlock_slot(PRWLOCK l) {
+  if (current_slot < 0) {
+    current_slot = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED);
+  }
+  return &l->slots[current_slot & l->mask];
+}
+
+/* Wait until no writer is active, spinning briefly before parking. */
+static void prwlock_wait_writer(PRWLOCK l) {
+  for (int i=0; i<RWLOCK_SPIN_COUNT; ++i) {
+    if (!__atomic_load_n(&l->writer, __ATOMIC_ACQUIRE)) {
+      return;
+    }
+    CPU_RELAX();
+  }
+  while (__atomic_load_n(&l->writer, __ATOMIC_ACQUIRE)) {
+    futex_wait(&l->writer, 1, NULL);
+  }
+}
+
+/* Return's `TRUE` when any reader holds `l`. */
+static bool prwlock_has_readers(PRWLOCK l) {
+  for (Ulong i=0; i<=l->mask; ++i) {
+    if (__atomic_load_n(&l->slots[i].readers, __ATOMIC_SEQ_CST)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- PRWLOCK ----------------------------- */
+
+/* Create a reader-biased rw-lock, with one reader counter per online cpu. */
+PRWLOCK prwlock_create(void) {
+  PRWLOCK l = xmalloc_aligned(_CACHELINE_SIZE, sizeof(*l));
+  Ulong nslots = 1;
+  while (nslots < thread_pool_online_cpus()) {
+    nslots <<= 1;
+  }
+  l->slots = xmalloc_aligned(_CACHELINE_SIZE, (sizeof(*l->slots) * nslots));
+  memset(l->slots, 0, (sizeof(*l->slots) * nslots));
+  l->mask        = (nslots - 1);
+  l->writer      = 0;
+  l->drain.state = 0;
+  fmutex_init(&l->wlock);
+  return l;
+}
+
+/* Free `l`.  Note that it must not be held.  No-op on `NULL`. */
+void prwlock_free(PRWLOCK l) {
+  if (!l) {
+    return;
+  }
+  free(l->slots);
+  free(l);
+}
+
+/* Lock `l` for reading.  Note that read locks must not be nested, as a writer that arrives in between would wait on the
+ * outer one, while the inner one waits on the writer. */
+void prwlock_rdlock(PRWLOCK l) {
+  ASSERT_PRWLOCK(l);
+  PrwlockSlot *slot = prwlock_slot(l);
+  while (TRUE) {
+    /* Announce ourself, then check for a writer.  The writer does the same in reverse, and as both are sequentially
+     * consistent, at least one of us sees the other. */
+    __atomic_add_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&l->writer, __ATOMIC_SEQ_CST)) {
+      return;
+    }
+    /* Back off, so the writer can get in. */
+    __atomic_sub_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST);
+    parking_notify(&l->drain);
+    prwlock_wait_writer(l);
+  }
+}
+
+void prwlock_rdunlock(PRWLOCK l) {
+  ASSERT_PRWLOCK(l);
+  __atomic_sub_fetch(&prwlock_slot(l)->readers, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&l->writer, __ATOMIC_SEQ_CST)) {
+    parking_notify(&l->drain);
+  }
+}
+
+/* Lock `l` for writing.  New readers are held off from this point, and this waits for the current ones to leave. */
+void prwlock_wrlock(PRWLOCK l) {
+  ASSERT_PRWLOCK(l);
+  Uint expected;
+  int spin = 0;
+  fmutex_lock(&l->wlock);
+  __atomic_store_n(&l->writer, 1, __ATOMIC_SEQ_CST);
+  while (prwlock_has_readers(l)) {
+    if (spin++ < RWLOCK_SPIN_COUNT) {
+      CPU_RELAX();
+      continue;
+    }
+    expected = parking_prepare(&l->drain);
+    if (prwlock_has_readers(l)) {
+      parking_wait(&l->drain, expected, NULL);
+    }
+  }
+}
+
+void prwlock_wrunlock(PRWLOCK l) {
+  ASSERT_PRWLOCK(l);
+  __atomic_store_n(&l->writer, 0, __ATOMIC_RELEASE);
+  futex_wake(&l->writer, INT_MAX);
+  fmutex_unlock(&l->wlock);
+}
+
+/* ----------------------------- Seqlock ----------------------------- */
+
+void seqlock_init(seqlock_t *const sl) {
+  ASSERT(sl);
+  sl->seq = 0;
+  fmutex_init(&sl->lock);
+}
+
+/* Start a optimistic read of the state `sl` protects.  Return's the value to pass to `seqlock_read_retry()`. */
+Uint seqlock_read_begin(const seqlock_t *const sl) {
+  ASSERT(sl);
+  Uint seq;
+  /* An odd sequence means a writer is active, so there is no point in reading yet. */
+  while ((seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE)) & 1) {
+    CPU_RELAX();
+  }
+  return seq;
+}
+
+/* Return's `TRUE` when a writer was active since `seqlock_read_begin()` returned `start`, in which case everything read
+ * must be thrown away and the read started over.  Note that whatever is read in between can be torn, so it must only be
+ * copied out, and never be followed as a pointer or used to index until this returned `FALSE`. */
+bool seqlock_read_retry(const seqlock_t *const sl, Uint start) {
+  ASSERT(sl);
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return (__atomic_load_n(&sl->seq, __ATOMIC_RELAXED) != start);
+}
+
+void seqlock_write_lock(seqlock_t *const sl) {
+  ASSERT(sl);
+  fmutex_lock(&sl->lock);
+  __atomic_store_n(&sl->seq, (sl->seq + 1), __ATOMIC_RELAXED);
+  /* The odd sequence must be visible before any of the writes it guards. */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void seqlock_write_unlock(seqlock_t *const sl) {
+  ASSERT(sl);
+  __atomic_store_n(&sl->seq, (sl->seq + 1), __ATOMIC_RELEASE);
+  fmutex_unlock(&sl->lock);
+}
+
+#endif
@@ -0,0 +1,669 @@
+/** @file slog.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Structured key/value logging.
+
+  A `slog_*()` call takes a message and any number of typed fields, made with the `SLOG_*()` macros, and encodes them
+  straight into a single JSON object, or a logfmt line, without going through `vsnprintf()`.  Integers are written two
+  digits at a time from a table, doubles are written with 15 significant digits, like `%.15g`, and strings are scanned
+  16 bytes at a time for anything that has to be escaped, so clean runs are copied as a whole.  Every line also gets
+  the time in RFC 3339 (UTC, with nanoseconds), the level, the line and the function.  The finished line then goes the
+  same way as a `fcio_log()` line, to the log file or std out/err, right away or through the async writer.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* The size of the per-thread buffer lines are encoded into, longer lines are allocated. */
+#define SLOG_LINE_MAX  (1024)
+
+/* The most a number, or `true`/`false`, can take, including the separators around it. */
+#define SLOG_NUMBER_MAX  (32)
+
+/* The most the time, level and line can take, including their keys. */
+#define SLOG_HEAD_MAX  (128)
+
+/* Every byte of a string can become a `\u00XX` escape. */
+#define SLOG_ESCAPED_MAX(len)  ((len) * 6)
+
+/* Enough 32-bit limbs for the 53 bits of a double times `10^338`, what the smallest subnormal needs to get 15 digits. */
+#define SLOG_BIG_LIMBS  (40)
+
+/* How close to halfway the long double scaling of a double can land, and still be trusted to round the right way.  It
+ * takes about ten roundings, each off by at most half an ulp of a 15 digit number.  When long double is no wider then
+ * double, this is more then a half, and every double takes the exact path. */
+#define SLOG_ROUND_MARGIN  (__LDBL_EPSILON__ * 1e17L)
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+typedef Uchar SlogVec __attribute__((__vector_size__(16)));
+
+/* An unsigned integer of up to `SLOG_BIG_LIMBS` 32-bit limbs, least significant first. */
+typedef struct {
+  Uint limb[SLOG_BIG_LIMBS];
+  int  len;
+} SlogBig;
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+static int slog_format = FCIO_SLOG_JSON;
+
+static _THREAD char slog_buffer[SLOG_LINE_MAX];
+
+/* The date and time of the last second a line was logged at by this thread, as `YYYY-MM-DDTHH:MM:SS`. */
+static _THREAD Llong slog_ts_second = -1;
+static _THREAD char slog_ts_date[19];
+
+static const char slog_digits[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+static const char slog_hex[] = "0123456789abcdef";
+
+/* Every power of ten that is exact as a long double. */
+static const long double slog_pow10[] = {
+  1e0L,  1e1L,  1e2L,  1e3L,  1e4L,  1e5L,  1e6L,  1e7L,  1e8L,  1e9L,  1e10L, 1e11L, 1e12L, 1e13L,
+  1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L, 1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L
+};
+
+/* `10^(2^i)` and `10^-(2^i)`, to scale any double to its 15 leading digits in a few steps.  These are long doubles, so
+ * the rounding of the steps stays well below the last digit. */
+static const long double slog_pow10_big[]   = { 1e1L,  1e2L,  1e4L,  1e8L,  1e16L,  1e32L,  1e64L,  1e128L,  1e256L  };
+static const long double slog_pow10_small[] = { 1e-1L, 1e-2L, 1e-4L, 1e-8L, 1e-16L, 1e-32L, 1e-64L, 1e-128L, 1e-256L };
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Numbers ----------------------------- */
+
+static inline char *slog_put(char *const p, const char *const data, Ulong len) {
+  memcpy(p, data, len);
+  return (p + len);
+}
+
+static char *slog_put_u64(char *p, Ulong value) {
+  char buf[20];
+  char *q = (buf + sizeof(buf));
+  while (value >= 100) {
+    q -= 2;
+    memcpy(q, &slog_digits[(value % 100) * 2], 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    q -= 2;
+    memcpy(q, &slog_digits[value * 2], 2);
+  }
+  else {
+    *--q = (char)('0' + value);
+  }
+  return slog_put(p, q, ((buf + sizeof(buf)) - q));
+}
+
+static char *slog_put_i64(char *p, Llong value) {
+  if (value < 0) {
+    *p++ = '-';
+    return slog_put_u64(p, ((Ulong)-(value + 1) + 1));
+  }
+  return slog_put_u64(p, value);
+}
+
+/* ----------------------------- Exact rounding ----------------------------- */
+
+static void slog_big_mul(SlogBig *const b, Uint factor) {
+  Ulong carry = 0;
+  for (int i=0; i<b->len; ++i) {
+    carry       += ((Ulong)b->limb[i] * factor);
+    b->limb[i]   = (Uint)carry;
+    carry      >>= 32;
+  }
+  if (carry) {
+    ALWAYS_ASSERT(b->len < SLOG_BIG_LIMBS);
+    b->limb[b->len++] = (Uint)carry;
+  }
+}
+
+/* Divide `b` by `divisor`, and return the remainder. */
+static Uint slog_big_div(SlogBig *const b, Uint divisor) {
+  Ulong rem = 0;
+  for (int i=(b->len - 1); i>=0; --i) {
+    rem        = ((rem << 32) | b->limb[i]);
+    b->limb[i] = (Uint)(rem / divisor);
+    rem       %= divisor;
+  }
+  while (b->len && !b->limb[b->len - 1]) {
+    --b->len;
+  }
+  return (Uint)rem;
+}
+
+static void slog_big_shl(SlogBig *const b, int shift) {
+  int words = (shift / 32);
+  int bits  = (shift % 32);
+  ALWAYS_ASSERT((b->len + words + 1) <= SLOG_BIG_LIMBS);
+  b->limb[b->len + words] = 0;
+  for (int i=(b->len - 1); i>=0; --i) {
+    if (bits) {
+      b->limb[i + words + 1] |= (b->limb[i] >> (32 - bits));
+    }
+    b->limb[i + words] = (b->limb[i] << bits);
+  }
+  memset(b->limb, 0, (words * sizeof(Uint)));
+  b->len += (words + 1);
+  while (b->len && !b->limb[b->len - 1]) {
+    --b->len;
+  }
+}
+
+/* Shift `b` right by `shift`, and set `*half` to the highest bit shifted out, and `*sticky` when any other was set. */
+static void slog_big_shr(SlogBig *const b, int shift, bool *const half, bool *const sticky) {
+  int words = (shift / 32);
+  int bits  = (shift % 32);
+  for (int i=0; i<(shift - 1) && i<(b->len * 32); ++i) {
+    if (b->limb[i / 32] & (1U << (i % 32))) {
+      *sticky = TRUE;
+      break;
+    }
+  }
+  if ((shift - 1) < (b->len * 32) && (b->limb[(shift - 1) / 32] & (1U << ((shift - 1) % 32)))) {
+    *half = TRUE;
+  }
+  if (words >= b->len) {
+    b->len = 0;
+    return;
+  }
+  for (int i=0; i<(b->len - words); ++i) {
+    b->limb[i] = (b->limb[i + words] >> bits);
+    if (bits && (i + words + 1) < b->len) {
+      b->limb[i] |= (b->limb[i + words + 1] << (32 - bits));
+    }
+  }
+  b->len -= words;
+  while (b->len && !b->limb[b->len - 1]) {
+    --b->len;
+  }
+}
+
+/* Return's `value * 10^scale` rounded to an integer, ties to even, from the exact value of `value`.  The result must
+ * fit in 64 bits. */
+static Ulong slog_scale_exact(double value, int scale) {
+  SlogBig b;
+  Ulong   bits;
+  Ulong   mant;
+  Ulong   m;
+  Uint    digit;
+  int     e2;
+  bool    half   = FALSE;
+  bool    sticky = FALSE;
+  memcpy(&bits, &value, sizeof(bits));
+  mant = (bits & ((1UL << 52) - 1));
+  if ((bits >> 52) & 0x7ff) {
+    mant |= (1UL << 52);
+    e2    = ((int)((bits >> 52) & 0x7ff) - 1075);
+  }
+  else {
+    e2 = -1074;
+  }
+  b.limb[0] = (Uint)mant;
+  b.limb[1] = (Uint)(mant >> 32);
+  b.len     = (b.limb[1] ? 2 : 1);
+  /* `mant * 2^e2 * 10^scale`, as one shift after the multiply.  Only the shift can have a remainder. */
+  if (scale >= 0) {
+    for (; scale>=9; scale-=9) {
+      slog_big_mul(&b, 1000000000U);
+    }
+    if (scale) {
+      slog_big_mul(&b, (Uint)slog_pow10[scale]);
+    }
+    if (e2 >= 0) {
+      slog_big_shl(&b, e2);
+    }
+    else {
+      slog_big_shr(&b, -e2, &half, &sticky);
+    }
+    m = (b.limb[0] | ((b.len > 1) ? ((Ulong)b.limb[1] << 32) : 0));
+    if (half && (sticky || (m & 1))) {
+      ++m;
+    }
+    return m;
+  }
+  /* `mant * 2^e2 / 10^-scale`, one floor at a time, keeping the last digit and if anything below it was dropped. */
+  if (e2 >= 0) {
+    slog_big_shl(&b, e2);
+  }
+  else {
+    slog_big_shr(&b, -e2, &sticky, &sticky);
+  }
+  for (scale=(-scale - 1); scale>=9; scale-=9) {
+    sticky |= !!slog_big_div(&b, 1000000000U);
+  }
+  if (scale) {
+    sticky |= !!slog_big_div(&b, (Uint)slog_pow10[scale]);
+  }
+  m     = (b.limb[0] | ((b.len > 1) ? ((Ulong)b.limb[1] << 32) : 0));
+  digit = (Uint)(m % 10);
+  m    /= 10;
+  if (digit > 5 || (digit == 5 && (sticky || (m & 1)))) {
+    ++m;
+  }
+  return m;
+}
+
+/* Put `value` at `p` with 15 significant digits, like `%.15g`.  When `json` is `TRUE`, `NaN` and the infinities,
+ * that JSON has no way to spell, become `null`. */
+static char *slog_put_double(char *p, double value, bool json) {
+  char buf[20];
+  long double x;
+  Ulong m;
+  int exp = 0;
+  int ndigits;
+  if (value != value) {
+    return (json ? slog_put(p, S__LEN("null")) : slog_put(p, S__LEN("NaN")));
+  }
+  else if (__builtin_isinf(value)) {
+    return (json ? slog_put(p, S__LEN("null")) : (value < 0) ? slog_put(p, S__LEN("-Inf")) : slog_put(p, S__LEN("+Inf")));
+  }
+  /* Like `printf()`, negative zero keeps its sign. */
+  if (__builtin_signbit(value)) {
+    *p++  = '-';
+    value = -value;
+  }
+  if (value == 0) {
+    *p++ = '0';
+    return p;
+  }
+  /* Integral values print as is. */
+  else if (value < 1e15 && value == (double)(Ulong)value) {
+    return slog_put_u64(p, (Ulong)value);
+  }
+  /* Find the exponent, so that `1 <= x < 10`. */
+  x = value;
+  if (x >= 10) {
+    for (int i=8; i>=0; --i) {
+      if (x >= slog_pow10_big[i]) {
+        x   /= slog_pow10_big[i];
+        exp += (1 << i);
+      }
+    }
+  }
+  else if (x < 1) {
+    for (int i=8; i>=0; --i) {
+      if (x < slog_pow10_small[i]) {
+        x   *= slog_pow10_big[i];
+        exp -= (1 << i);
+      }
+    }
+    if (x < 1) {
+      x *= 10;
+      --exp;
+    }
+  }
+  /* Scale to 15 digits. */
+  if ((14 - exp) >= 0 && (14 - exp) < (int)ARRAY_SIZE(slog_pow10)) {
+    x = (value * slog_pow10[14 - exp]);
+  }
+  else if ((exp - 14) > 0 && (exp - 14) < (int)ARRAY_SIZE(slog_pow10)) {
+    x = (value / slog_pow10[exp - 14]);
+  }
+  else {
+    x *= 1e14L;
+  }
+  m  = (Ulong)x;
+  x -= m;
+  /* Round to 15 digits.  The scaling is only close, so when it lands near halfway, or the exponent turns out to be off
+   * by one, the digits are taken from the exact value instead, ties to even like `printf()`. */
+  if (x > (0.5L - SLOG_ROUND_MARGIN) && x < (0.5L + SLOG_ROUND_MARGIN)) {
+    m = slog_scale_exact(value, (14 - exp));
+  }
+  else if (x > 0.5L) {
+    ++m;
+  }
+  while (m >= 1000000000000000UL || m < 100000000000000UL) {
+    exp += ((m >= 1000000000000000UL) ? 1 : -1);
+    m    = slog_scale_exact(value, (14 - exp));
+  }
+  /* Drop the trailing zeros. */
+  ndigits = 15;
+  while (!(m % 10)) {
+    m /= 10;
+    --ndigits;
+  }
+  slog_put_u64(buf, m);
+  /* Same as `%g`, plain notation for exponents from `-4` up to the precision. */
+  if (exp >= -4 && exp < 15) {
+    if (exp < 0) {
+      p = slog_put(p, "0.0000", (1 - exp));
+      return slog_put(p, buf, ndigits);
+    }
+    if (ndigits <= (exp + 1)) {
+      p = slog_put(p, buf, ndigits);
+      memset(p, '0', ((exp + 1) - ndigits));
+      return (p + ((exp + 1) - ndigits));
+    }
+    p    = slog_put(p, buf, (exp + 1));
+    *p++ = '.';
+    return slog_put(p, (buf + exp + 1), (ndigits - (exp + 1)));
+  }
+  *p++ = buf[0];
+  if (ndigits > 1) {
+    *p++ = '.';
+    p    = slog_put(p, (buf + 1), (ndigits - 1));
+  }
+  *p++ = 'e';
+  *p++ = ((exp < 0) ? '-' : '+');
+  if (exp < 0) {
+    exp = -exp;
+  }
+  if (exp < 10) {
+    *p++ = '0';
+  }
+  return slog_put_u64(p, exp);
+}
+
+/* ----------------------------- Strings ----------------------------- */
+
+static inline bool slog_is_special(Uchar c, bool logfmt) {
+  return (c < 0x20 || c == '"' || c == '\\' || (logfmt && (c == ' ' || c == '=')));
+}
+
+/* Return's the index of the first byte of `s` that has to be escaped, or when `logfmt` is `TRUE`, that means the value
+ * has to be quoted, or `len` when there is none.  This looks at 16 bytes at a time. */
+static Ulong slog_scan(const char *const s, Ulong len, bool logfmt) {
+  SlogVec v;
+  SlogVec mask;
+  Ulong low;
+  Ulong high;
+  Ulong i = 0;
+  for (; (i + 16) <= len; i += 16) {
+    memcpy(&v, (s + i), 16);
+    mask = (SlogVec)((v < 0x20) | (v == '"') | (v == '\\'));
+    if (logfmt) {
+      mask |= (SlogVec)((v == ' ') | (v == '='));
+    }
+    memcpy(&low, &mask, 8);
+    memcpy(&high, ((char *)&mask + 8), 8);
+    if (low) {
+      return (i + (__builtin_ctzl(low) >> 3));
+    }
+    else if (high) {
+      return (i + 8 + (__builtin_ctzl(high) >> 3));
+    }
+  }
+  for (; i<len; ++i) {
+    if (slog_is_special(s[i], logfmt)) {
+      break;
+    }
+  }
+  return i;
+}
+
+/* Put `len` bytes of `s` at `p`, escaped as a JSON string, without the quotes. */
+static char *slog_put_escaped(char *p, const char *s, Ulong len) {
+  Ulong i;
+  Uchar c;
+  while ((i = slog_scan(s, len, FALSE)) < len) {
+    p = slog_put(p, s, i);
+    c = s[i];
+    *p++ = '\\';
+    switch (c) {
+      case '"':
+      case '\\': {
+        *p++ = c;
+        break;
+      }
+      case '\n': {
+        *p++ = 'n';
+        break;
+      }
+      case '\r': {
+        *p++ = 'r';
+        break;
+      }
+      case '\t': {
+        *p++ = 't';
+        break;
+      }
+      default: {
+        p    = slog_put(p, "u00", 3);
+        *p++ = slog_hex[c >> 4];
+        *p++ = slog_hex[c & 0xF];
+      }
+    }
+    s   += (i + 1);
+    len -= (i + 1);
+  }
+  return slog_put(p, s, len);
+}
+
+static inline char *slog_put_quoted(char *p, const char *const s, Ulong len) {
+  *p++ = '"';
+  p    = slog_put_escaped(p, s, len);
+  *p++ = '"';
+  return p;
+}
+
+/* Put a logfmt value at `p`, which is only quoted when it's empty, or holds a space, `=`, `"` or anything escaped. */
+static inline char *slog_put_logfmt_value(char *p, const char *const s, Ulong len) {
+  if (len && slog_scan(s, len, TRUE) == len) {
+    return slog_put(p, s, len);
+  }
+  return slog_put_quoted(p, s, len);
+}
+
+static inline Ulong slog_str_len(const fcio_slog_field_t *const field) {
+  if (!field->v.s.data) {
+    return 0;
+  }
+  return ((field->v.s.len == FCIO_SLOG_STRLEN) ? strlen(field->v.s.data) : field->v.s.len);
+}
+
+/* ----------------------------- Timestamp ----------------------------- */
+
+/* Put the current time at `p`, in RFC 3339, like `2026-10-18T12:34:56.123456789Z`. */
+static char *slog_put_time(char *p) {
+  struct timespec ts;
+  Llong days;
+  Llong secs;
+  Llong era;
+  Llong doe;
+  Llong yoe;
+  Llong doy;
+  Llong mp;
+  Llong year;
+  int month;
+  int day;
+  char nsec[9];
+  long ns;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  if (ts.tv_sec != slog_ts_second) {
+    /* The civil date of the days since the epoch, in the proleptic Gregorian calendar. */
+    days  = (ts.tv_sec / 86400);
+    secs  = (ts.tv_sec % 86400);
+    days += 719468;
+    era   = (days / 146097);
+    doe   = (days - (era * 146097));
+    yoe   = ((doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365);
+    doy   = (doe - ((365 * yoe) + (yoe / 4) - (yoe / 100)));
+    mp    = (((5 * doy) + 2) / 153);
+    day   = (int)(doy - (((153 * mp) + 2) / 5) + 1);
+    month = (int)((mp < 10) ? (mp + 3) : (mp - 9));
+    year  = ((yoe + (era * 400)) + (month <= 2));
+    memcpy(&slog_ts_date[0], &slog_digits[((year / 100) % 100) * 2], 2);
+    memcpy(&slog_ts_date[2], &slog_digits[(year % 100) * 2], 2);
+    slog_ts_date[4] = '-';
+    memcpy(&slog_ts_date[5], &slog_digits[month * 2], 2);
+    slog_ts_date[7] = '-';
+    memcpy(&slog_ts_date[8], &slog_digits[day * 2], 2);
+    slog_ts_date[10] = 'T';
+    memcpy(&slog_ts_date[11], &slog_digits[(secs / 3600) * 2], 2);
+    slog_ts_date[13] = ':';
+    memcpy(&slog_ts_date[14], &slog_digits[((secs / 60) % 60) * 2], 2);
+    slog_ts_date[16] = ':';
+    memcpy(&slog_ts_date[17], &slog_digits[(secs % 60) * 2], 2);
+    slog_ts_second = ts.tv_sec;
+  }
+  p    = slog_put(p, slog_ts_date, sizeof(slog_ts_date));
+  *p++ = '.';
+  ns   = ts.tv_nsec;
+  for (int i=8; i>=0; --i) {
+    nsec[i] = (char)('0' + (ns % 10));
+    ns /= 10;
+  }
+  p    = slog_put(p, nsec, 9);
+  *p++ = 'Z';
+  return p;
+}
+
+/* ----------------------------- Encode ----------------------------- */
+
+/* Return's the most bytes the line of `fields` can take, in either format. */
+static Ulong slog_line_max(const char *const function, const fcio_slog_field_t *const fields, Ulong nfields) {
+  Ulong ret = (SLOG_HEAD_MAX + SLOG_ESCAPED_MAX(strlen(function)));
+  for (Ulong i=0; i<nfields; ++i) {
+    ret += (SLOG_NUMBER_MAX + SLOG_ESCAPED_MAX(strlen(fields[i].key)));
+    if (fields[i].type == FCIO_SLOG_STR) {
+      ret += SLOG_ESCAPED_MAX(slog_str_len(&fields[i]));
+    }
+  }
+  return ret;
+}
+
+static char *slog_encode_json(char *p, int type, Ulong lineno, const char *const function, const fcio_slog_field_t *const fields, Ulong nfields) {
+  const char *tag = fcio_log_tag(type);
+  p = slog_put(p, S__LEN("{\"ts\":\""));
+  p = slog_put_time(p);
+  p = slog_put(p, S__LEN("\",\"level\":\""));
+  p = slog_put(p, tag, strlen(tag));
+  p = slog_put(p, S__LEN("\",\"line\":"));
+  p = slog_put_u64(p, lineno);
+  p = slog_put(p, S__LEN(",\"func\":"));
+  p = slog_put_quoted(p, function, strlen(function));
+  for (Ulong i=0; i<nfields; ++i) {
+    *p++ = ',';
+    p    = slog_put_quoted(p, fields[i].key, strlen(fields[i].key));
+    *p++ = ':';
+    switch (fields[i].type) {
+      case FCIO_SLOG_INT: {
+        p = slog_put_i64(p, fields[i].v.i);
+        break;
+      }
+      case FCIO_SLOG_UINT: {
+        p = slog_put_u64(p, fields[i].v.u);
+        break;
+      }
+      case FCIO_SLOG_DOUBLE: {
+        p = slog_put_double(p, fields[i].v.f, TRUE);
+        break;
+      }
+      case FCIO_SLOG_BOOL: {
+        p = (fields[i].v.b ? slog_put(p, S__LEN("true")) : slog_put(p, S__LEN("false")));
+        break;
+      }
+      case FCIO_SLOG_STR: {
+        if (!fields[i].v.s.data) {
+          p = slog_put(p, S__LEN("null"));
+        }
+        else {
+          p = slog_put_quoted(p, fields[i].v.s.data, slog_str_len(&fields[i]));
+        }
+        break;
+      }
+      default: {
+        p = slog_put(p, S__LEN("null"));
+      }
+    }
+  }
+  *p++ = '}';
+  *p++ = '\n';
+  return p;
+}
+
+static char *slog_encode_logfmt(char *p, int type, Ulong lineno, const char *const function, const fcio_slog_field_t *const fields, Ulong nfields) {
+  const char *tag = fcio_log_tag(type);
+  p = slog_put(p, S__LEN("ts="));
+  p = slog_put_time(p);
+  p = slog_put(p, S__LEN(" level="));
+  p = slog_put(p, tag, strlen(tag));
+  p = slog_put(p, S__LEN(" line="));
+  p = slog_put_u64(p, lineno);
+  p = slog_put(p, S__LEN(" func="));
+  p = slog_put_logfmt_value(p, function, strlen(function));
+  for (Ulong i=0; i<nfields; ++i) {
+    *p++ = ' ';
+    p    = slog_put(p, fields[i].key, strlen(fields[i].key));
+    *p++ = '=';
+    switch (fields[i].type) {
+      case FCIO_SLOG_INT: {
+        p = slog_put_i64(p, fields[i].v.i);
+        break;
+      }
+      case FCIO_SLOG_UINT: {
+        p = slog_put_u64(p, fields[i].v.u);
+        break;
+      }
+      case FCIO_SLOG_DOUBLE: {
+        p = slog_put_double(p, fields[i].v.f, FALSE);
+        break;
+      }
+      case FCIO_SLOG_BOOL: {
+        p = (fields[i].v.b ? slog_put(p, S__LEN("true")) : slog_put(p, S__LEN("false")));
+        break;
+      }
+      case FCIO_SLOG_STR: {
+        p = slog_put_logfmt_value(p, (fields[i].v.s.data ? fields[i].v.s.data : ""), slog_str_len(&fields[i]));
+        break;
+      }
+    }
+  }
+  *p++ = '\n';
+  return p;
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Fcio slog ----------------------------- */
+
+/* Log one structured line of `type` holding `fields`, where the first field is the message.  Use the `slog_*()` macros
+ * rather then calling this directly. */
+void fcio_slog(int type, Ulong lineno, const char *const restrict function, const fcio_slog_field_t *const fields, Ulong nfields) {
+  ASSERT(function);
+  ASSERT(fields);
+  Ulong len = slog_line_max(function, fields, nfields);
+  char *heap = NULL;
+  char *data = slog_buffer;
+  char *end;
+  if (len > SLOG_LINE_MAX) {
+    data = heap = xmalloc(len);
+  }
+  if (__atomic_load_n(&slog_format, __ATOMIC_RELAXED) == FCIO_SLOG_LOGFMT) {
+    end = slog_encode_logfmt(data, type, lineno, function, fields, nfields);
+  }
+  else {
+    end = slog_encode_json(data, type, lineno, function, fields, nfields);
+  }
+  fcio_log_write(type, data, (end - data));
+  free(heap);
+}
+
+/* ----------------------------- Fcio slog set format ----------------------------- */
+
+/* Set the format structured lines are written in, `FCIO_SLOG_JSON`, the default, or `FCIO_SLOG_LOGFMT`. */
+void fcio_slog_set_format(int format) {
+  ALWAYS_ASSERT(format == FCIO_SLOG_JSON || format == FCIO_SLOG_LOGFMT);
+  __atomic_store_n(&slog_format, format, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,226 @@
+/** @file spsc.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Wait-free single-producer/single-consumer ring queue.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+#include "../include/statics.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* The number of times a blocking call re-checks the queue before parking on the futex. */
+#define SPSC_SPIN_COUNT  (128)
+
+#define ASSERT_SPSC(x)  \
+  DO_WHILE(             \
+    ASSERT((x));        \
+    ASSERT((x)->data);  \
+  )
+
+#define LOAD_ACQ(x)      __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE_REL(x, y)  __atomic_store_n(&(x), (y), __ATOMIC_RELEASE)
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+/* Each side only ever writes to its own cache-line, the only shared writes are the futex words,
+ * and those are only touched when a side actually parks.  Both sides also keep a cached copy
+ * of the others index, so that the shared line is only read when the cached one runs out. */
+struct SPSC_T {
+  /* Consumer owned. */
+  Ulong head _ALIGNED(_CACHELINE_SIZE);
+  Ulong tail_cache;
+  /* Producer owned. */
+  Ulong tail _ALIGNED(_CACHELINE_SIZE);
+  Ulong head_cache;
+  /* Read-only after creation. */
+  Ulong cap _ALIGNED(_CACHELINE_SIZE);
+  void **data;
+  void (*free_func)(void *);
+  /* Parking for the consumer when empty, and for the producer when full. */
+  parking_t not_empty _ALIGNED(_CACHELINE_SIZE);
+  parking_t not_full  _ALIGNED(_CACHELINE_SIZE);
+};
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* Park on `p` until notified, unless `ready(q)` becomes true while we register as a waiter. */
+static void spsc_park(SPSC q, parking_t *const p, bool (*ready)(SPSC)) {
+  Uint expected;
+  for (int i=0; i<SPSC_SPIN_COUNT; ++i) {
+    if (ready(q)) {
+      return;
+    }
+    CPU_RELAX();
+  }
+  expected = parking_prepare(p);
+  if (!ready(q)) {
+    parking_wait(p, expected, NULL);
+  }
+}
+
+/* Consumer side check, return's `TRUE` when there is at least one entry to pop. */
+static bool spsc_has_data(SPSC q) {
+  return (LOAD_ACQ(q->tail) != q->head);
+}
+
+/* Producer side check, return's `TRUE` when there is room for at least one entry. */
+static bool spsc_has_room(SPSC q) {
+  return ((q->tail - LOAD_ACQ(q->head)) < q->cap);
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* Create a single-producer/single-consumer queue that can hold at least `cap` entries.  Note that
+ * `cap` is rounded up to the nearest power of 2, and that the queue will never reallocate. */
+SPSC spsc_create(Ulong cap) {
+  ALWAYS_ASSERT(cap);
+  SPSC q = xmalloc_aligned(_CACHELINE_SIZE, sizeof(*q));
+  memset(q, 0, sizeof(*q));
+  q->cap = 1;
+  while (q->cap < cap) {
+    q->cap <<= 1;
+  }
+  q->data = xmalloc(_PTRSIZE * q->cap);
+  return q;
+}
+
+/* Free `q`, calling `free_func` on all entries that are still in the queue.  Note
+ * that neither side may be using the queue when this is called.  No-op on `NULL`. */
+void spsc_free(SPSC q) {
+  if (!q) {
+    return;
+  }
+  if (q->free_func) {
+    for (Ulong i=q->head; i!=q->tail; ++i) {
+      q->free_func(q->data[i & (q->cap - 1)]);
+    }
+  }
+  free(q->data);
+  free(q);
+}
+
+/* Must be set before the queue is shared between threads. */
+void spsc_set_free_func(SPSC q, void (*free_func)(void *)) {
+  ASSERT(q);
+  q->free_func = free_func;
+}
+
+/* Return's the number of entries in the queue.  Note that when called while
+ * the other side is active, this is only a snapshot of the size. */
+Ulong spsc_size(SPSC q) {
+  ASSERT_SPSC(q);
+  return (LOAD_ACQ(q->tail) - LOAD_ACQ(q->head));
+}
+
+Ulong spsc_cap(SPSC q) {
+  ASSERT_SPSC(q);
+  return q->cap;
+}
+
+/* ----------------------------- Producer ----------------------------- */
+
+/* Push as many as possible, up to `n` entries from `data`, publishing them all with one store.
+ * Return's the number of entries pushed.  Note that this must only be called by the producer. */
+Ulong spsc_push_many(SPSC q, void *const *const data, Ulong n) {
+  ASSERT_SPSC(q);
+  ASSERT(data || !n);
+  Ulong tail = q->tail;
+  Ulong room = (q->cap - (tail - q->head_cache));
+  if (room < n) {
+    q->head_cache = LOAD_ACQ(q->head);
+    room = (q->cap - (tail - q->head_cache));
+    if (room < n) {
+      n = room;
+    }
+  }
+  if (!n) {
+    return 0;
+  }
+  for (Ulong i=0; i<n; ++i) {
+    q->data[(tail + i) & (q->cap - 1)] = data[i];
+  }
+  STORE_REL(q->tail, (tail + n));
+  parking_notify(&q->not_empty);
+  return n;
+}
+
+/* Return's `FALSE` when the queue is full.  Note that this must only be called by the producer. */
+bool spsc_try_push(SPSC q, void *data) {
+  return (spsc_push_many(q, &data, 1) == 1);
+}
+
+/* Push `data`, parking the producer while the queue is full.  Note that this must only be called by the producer. */
+void spsc_push(SPSC q, void *data) {
+  ASSERT_SPSC(q);
+  while (!spsc_try_push(q, data)) {
+    spsc_park(q, &q->not_full, spsc_has_room);
+  }
+}
+
+/* ----------------------------- Consumer ----------------------------- */
+
+/* Pop at most `n` entries into `out`, releasing the slots with one store.  Return's the number of entries popped.
+ * Note that the ownership of popped entries moves to the caller, and that this must only be called by the consumer. */
+Ulong spsc_pop_many(SPSC q, void **const out, Ulong n) {
+  ASSERT_SPSC(q);
+  ASSERT(out || !n);
+  Ulong head  = q->head;
+  Ulong avail = (q->tail_cache - head);
+  if (avail < n) {
+    q->tail_cache = LOAD_ACQ(q->tail);
+    avail = (q->tail_cache - head);
+    if (avail < n) {
+      n = avail;
+    }
+  }
+  if (!n) {
+    return 0;
+  }
+  for (Ulong i=0; i<n; ++i) {
+    out[i] = q->data[(head + i) & (q->cap - 1)];
+  }
+  STORE_REL(q->head, (head + n));
+  parking_notify(&q->not_full);
+  return n;
+}
+
+/* Return's `FALSE` when the queue is empty.  Note that this must only be called by the consumer. */
+bool spsc_try_pop(SPSC q, void **const out) {
+  ASSERT(out);
+  return (spsc_pop_many(q, out, 1) == 1);
+}
+
+/* Same as `spsc_pop_many()`, but parks the consumer until at least one entry can be popped. */
+Ulong spsc_pop_many_wait(SPSC q, void **const out, Ulong n) {
+  ASSERT_SPSC(q);
+  ASSERT(out);
+  ALWAYS_ASSERT(n);
+  Ulong ret;
+  while (!(ret = spsc_pop_many(q, out, n))) {
+    spsc_park(q, &q->not_empty, spsc_has_data);
+  }
+  return ret;
+}
+
+/* Pop a entry, parking the consumer while the queue is empty.  Note that this must only be called by the consumer. */
+void *spsc_pop(SPSC q) {
+  void *ret;
+  spsc_pop_many_wait(q, &ret, 1);
+  return ret;
+}
+
+#endif
@@ -0,0 +1,464 @@
+/** @file thread_pool.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Persistent work-stealing worker pool.  Every worker owns a `WSDEQUE`, where tasks submitted from that worker are pushed,
+  and which it pops from in lifo order.  Tasks submitted from any other thread go into one shared `MPMC` injector queue.  A
+  worker that runs out of its own work takes from the injector, and then steals the oldest task of a random other worker.
+  Workers that find no work anywhere park on a futex, so submitting a task never creates or tears down a thread.
+
+  A pinned pool places every worker on its own cpu in topology order, and keeps one extra injector per numa node, so work
+  submitted with a node hint is taken by workers on that node first.  Stealing also prefers workers on the same node.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+#include "../include/statics.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+/* The capacity of the injector queue.  Submitting into a full injector parks the caller until a worker makes room. */
+#define THREAD_POOL_QUEUE_CAP  (1UL << 16)
+
+/* The initial capacity of every worker deque, they grow as needed. */
+#define THREAD_POOL_DEQUE_CAP  (256)
+
+/* The number of rounds a idle worker, or a thread waiting in `task_group_sync()`, looks for work before it parks. */
+#define THREAD_POOL_SPIN_COUNT  (64)
+
+/* A worker that waits runs other tasks on top of its stack.  Beyond this many nested waits it only runs tasks from
+ * its own deque, which are its own children, so taking unrelated work cannot grow the stack without bound. */
+#define THREAD_POOL_HELP_DEPTH  (32)
+
+#define ASSERT_THREAD_POOL(x)  \
+  DO_WHILE(                    \
+    ASSERT((x));               \
+    ASSERT((x)->queue);        \
+    ASSERT((x)->workers);      \
+  )
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+typedef struct {
+  void (*func)(void *);
+  void *arg;
+  task_group_t *group;  /* When not `NULL`, the group this task is counted in. */
+} ThreadPoolTask;
+
+typedef struct {
+  WSDEQUE deque;
+  THREAD_POOL pool;
+  Uint rand_state;
+  /* The cpu this worker is pinned to, or -1, and the node it's on. */
+  int cpu;
+  int node;
+  thread_t thread;
+} _ALIGNED(_CACHELINE_SIZE) ThreadPoolWorker;
+
+struct THREAD_POOL_T {
+  MPMC queue;
+  ThreadPoolWorker *workers;
+  Ulong nthreads;
+  /* The per-node injectors of a pinned pool, `NULL` otherwise. */
+  MPMC *node_queues;
+  Ulong *node_workers;
+  Ulong nnodes;
+  bool stopping;
+  /* Parking for idle workers. */
+  parking_t idle _ALIGNED(_CACHELINE_SIZE);
+  /* Parking for threads in `task_group_sync()`.  This lives in the pool and not in the group, as the
+   * group can go out of scope as soon as its last task is counted down, before that task could notify. */
+  parking_t sync _ALIGNED(_CACHELINE_SIZE);
+};
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+static mutex_t default_pool_mutex = mutex_init_static;
+static THREAD_POOL default_pool = NULL;
+static Ulong default_pool_nthreads = 0;
+static bool default_pool_pinned = FALSE;
+
+/* The worker the calling thread is, or `NULL` when it's not a worker of any pool. */
+static _THREAD ThreadPoolWorker *current_worker = NULL;
+
+/* The number of tasks the calling worker is running on top of a wait. */
+static _THREAD int help_depth = 0;
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* Return's the worker the calling thread is in `pool`, or `NULL`. */
+static inline ThreadPoolWorker *thread_pool_self(THREAD_POOL pool) {
+  return ((current_worker && current_worker->pool == pool) ? current_worker : NULL);
+}
+
+/* Xorshift, only used to pick steal victims. */
+static inline Uint thread_pool_rand(ThreadPoolWorker *const self) {
+  Uint x = self->rand_state;
+  x ^= (x << 13);
+  x ^= (x >> 17);
+  x ^= (x << 5);
+  return (self->rand_state = x);
+}
+
+/* Queue `task` in `pool`, on the deque of the calling thread when it's a worker of `pool`, otherwise on the injector. */
+static void thread_pool_enqueue(THREAD_POOL pool, ThreadPoolTask *task) {
+  ThreadPoolWorker *self = thread_pool_self(pool);
+  if (self) {
+    wsdeque_push(self->deque, task);
+  }
+  else {
+    mpmc_push(pool->queue, task);
+  }
+  parking_notify(&pool->idle);
+}
+
+/* Steal from any other worker, starting at a random one.  When `same_node` is `TRUE`, only workers on the node of `self` are tried. */
+static ThreadPoolTask *thread_pool_steal(THREAD_POOL pool, ThreadPoolWorker *const self, bool same_node) {
+  void *task;
+  Ulong start = thread_pool_rand(self);
+  for (Ulong i=0; i<pool->nthreads; ++i) {
+    ThreadPoolWorker *victim = &pool->workers[(start + i) % pool->nthreads];
+    if (victim != self && (!same_node || victim->node == self->node) && wsdeque_steal(victim->deque, &task)) {
+      return task;
+    }
+  }
+  return NULL;
+}
+
+/* Find a task for the worker `self` to run.  Its own deque is tried first, then when `steal` is `TRUE`, the injector of its node and
+ * the shared injector, and last all other workers starting at a random one.  In a pinned pool, workers on the same node are stolen
+ * from before any other, and only then is work hinted for other nodes taken.  Return's `NULL` when no task could be found. */
+static ThreadPoolTask *thread_pool_find_task(THREAD_POOL pool, ThreadPoolWorker *const self, bool steal) {
+  void *task;
+  if (wsdeque_pop(self->deque, &task)) {
+    return task;
+  }
+  if (!steal) {
+    return NULL;
+  }
+  if (pool->node_queues && mpmc_try_pop(pool->node_queues[self->node], &task)) {
+    return task;
+  }
+  if (mpmc_try_pop(pool->queue, &task)) {
+    return task;
+  }
+  if (!pool->node_queues) {
+    return thread_pool_steal(pool, self, FALSE);
+  }
+  if ((task = thread_pool_steal(pool, self, TRUE)) || (task = thread_pool_steal(pool, self, FALSE))) {
+    return task;
+  }
+  for (Ulong i=0; i<pool->nnodes; ++i) {
+    if (mpmc_try_pop(pool->node_queues[i], &task)) {
+      return task;
+    }
+  }
+  return NULL;
+}
+
+/* Return's `TRUE` when there is any task queued anywhere in `pool`. */
+static bool thread_pool_has_work(THREAD_POOL pool) {
+  if (mpmc_size(pool->queue)) {
+    return TRUE;
+  }
+  for (Ulong i=0; pool->node_queues && i<pool->nnodes; ++i) {
+    if (mpmc_size(pool->node_queues[i])) {
+      return TRUE;
+    }
+  }
+  for (Ulong i=0; i<pool->nthreads; ++i) {
+    if (wsdeque_size(pool->workers[i].deque)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static void thread_pool_run(ThreadPoolTask *task) {
+  task_group_t *group = task->group;
+  THREAD_POOL pool;
+  task->func(task->arg);
+  free(task);
+  if (group) {
+    pool = group->pool;
+    if (!__atomic_sub_fetch(&group->pending, 1, __ATOMIC_ACQ_REL)) {
+      parking_notify(&pool->sync);
+    }
+  }
+}
+
+static void *thread_pool_worker(void *arg) {
+  ThreadPoolWorker *self = arg;
+  THREAD_POOL pool = self->pool;
+  ThreadPoolTask *task;
+  Uint expected;
+  current_worker = self;
+  /* Pin before running anything, so all memory this worker touches first is allocated on its own node. */
+  if (self->cpu >= 0) {
+    thread_pin_to_cpu(pthread_self(), self->cpu);
+  }
+  while (TRUE) {
+    for (int i=0; i<THREAD_POOL_SPIN_COUNT; ++i) {
+      if ((task = thread_pool_find_task(pool, self, TRUE))) {
+        break;
+      }
+      CPU_RELAX();
+    }
+    if (task) {
+      thread_pool_run(task);
+      continue;
+    }
+    expected = parking_prepare(&pool->idle);
+    if (thread_pool_has_work(pool)) {
+      continue;
+    }
+    /* Only exit once there is no work left anywhere, as our own deque can only be emptied by us or by thieves. */
+    if (__atomic_load_n(&pool->stopping, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+    parking_wait(&pool->idle, expected, NULL);
+  }
+  current_worker = NULL;
+  return NULL;
+}
+
+
+static THREAD_POOL thread_pool_create_internal(Ulong nthreads, bool pinned) {
+  THREAD_POOL pool = xmalloc_aligned(_CACHELINE_SIZE, sizeof(*pool));
+  const cpu_topology_t *cpu;
+  memset(pool, 0, sizeof(*pool));
+  pool->nthreads = (nthreads ? nthreads : thread_pool_online_cpus());
+  pool->queue    = mpmc_create(THREAD_POOL_QUEUE_CAP);
+  pool->workers  = xmalloc_aligned(_CACHELINE_SIZE, (sizeof(*pool->workers) * pool->nthreads));
+  if (pinned) {
+    pool->nnodes       = numa_node_count();
+    pool->node_queues  = xmalloc(sizeof(*pool->node_queues) * pool->nnodes);
+    pool->node_workers = xcalloc(pool->nnodes, sizeof(*pool->node_workers));
+    for (Ulong i=0; i<pool->nnodes; ++i) {
+      pool->node_queues[i] = mpmc_create(THREAD_POOL_QUEUE_CAP);
+    }
+  }
+  for (Ulong i=0; i<pool->nthreads; ++i) {
+    pool->workers[i].deque      = wsdeque_create(THREAD_POOL_DEQUE_CAP);
+    pool->workers[i].pool       = pool;
+    pool->workers[i].rand_state = (Uint)((i + 1) * 2654435761U);
+    pool->workers[i].cpu        = -1;
+    pool->workers[i].node       = 0;
+    if (pinned) {
+      cpu = cpu_topology_get(i);
+      pool->workers[i].cpu  = cpu->id;
+      pool->workers[i].node = cpu->node;
+      ++pool->node_workers[cpu->node];
+    }
+  }
+  /* Start the workers only once all deques exist, as any worker can steal from any other. */
+  for (Ulong i=0; i<pool->nthreads; ++i) {
+    ALWAYS_ASSERT_MSG((thread_create(&pool->workers[i].thread, NULL, thread_pool_worker, &pool->workers[i]) == 0), "Failed to create thread pool worker");
+  }
+  return pool;
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* Return's the number of online cpu's, and at least 1. */
+Ulong thread_pool_online_cpus(void) {
+  long ret = sysconf(_SC_NPROCESSORS_ONLN);
+  return ((ret > 0) ? (Ulong)ret : 1);
+}
+
+/* Create a pool with `nthreads` workers, or when `nthreads` is zero, one worker per online cpu. */
+THREAD_POOL thread_pool_create(Ulong nthreads) {
+  return thread_pool_create_internal(nthreads, FALSE);
+}
+
+/* Create a pool like `thread_pool_create()`, where every worker is pinned to its own cpu, in the order of `cpu_topology_get()`.  So
+ * the workers fill one numa node before the next, and use every physical core of a node before its hardware threads.  Such a pool
+ * also honors the node hint of `thread_pool_submit_node()`. */
+THREAD_POOL thread_pool_create_pinned(Ulong nthreads) {
+  return thread_pool_create_internal(nthreads, TRUE);
+}
+
+/* Free `pool`.  All tasks that have already been submitted, and all tasks they submit in turn, are run before the workers exit, and
+ * this blocks until they have.  Note that no other thread may submit to `pool` after this is called, and that it cannot be called from
+ * a task running in `pool`.  No-op on `NULL`. */
+void thread_pool_free(THREAD_POOL pool) {
+  if (!pool) {
+    return;
+  }
+  __atomic_store_n(&pool->stopping, TRUE, __ATOMIC_RELEASE);
+  parking_notify(&pool->idle);
+  for (Ulong i=0; i<pool->nthreads; ++i) {
+    thread_join(pool->workers[i].thread, NULL);
+  }
+  for (Ulong i=0; i<pool->nthreads; ++i) {
+    wsdeque_free(pool->workers[i].deque);
+  }
+  for (Ulong i=0; pool->node_queues && i<pool->nnodes; ++i) {
+    mpmc_free(pool->node_queues[i]);
+  }
+  mpmc_free(pool->queue);
+  free(pool->node_queues);
+  free(pool->node_workers);
+  free(pool->workers);
+  free(pool);
+}
+
+Ulong thread_pool_nthreads(THREAD_POOL pool) {
+  ASSERT_THREAD_POOL(pool);
+  return pool->nthreads;
+}
+
+/* Run `func` with `arg` on one of the workers of `pool`.  When called from a worker of `pool`, the task is pushed onto that workers own
+ * deque, where it's the next task it runs, unless it's stolen first.  Otherwise, tasks from a single thread are started in submission order. */
+void thread_pool_submit(THREAD_POOL pool, void (*func)(void *), void *arg) {
+  ASSERT_THREAD_POOL(pool);
+  ASSERT(func);
+  ThreadPoolTask *task = xmalloc(sizeof(*task));
+  task->func  = func;
+  task->arg   = arg;
+  task->group = NULL;
+  thread_pool_enqueue(pool, task);
+}
+
+/* Run `func` with `arg` on `pool`, preferably on a worker on numa `node`.  Workers on `node` take the task before any shared work,
+ * while workers elsewhere only take it when they find nothing else to do.  When `pool` is not pinned, or no worker is on `node`,
+ * this is the same as `thread_pool_submit()`. */
+void thread_pool_submit_node(THREAD_POOL pool, int node, void (*func)(void *), void *arg) {
+  ASSERT_THREAD_POOL(pool);
+  ASSERT(func);
+  ThreadPoolWorker *self = thread_pool_self(pool);
+  ThreadPoolTask *task;
+  if (!pool->node_queues || node < 0 || (Ulong)node >= pool->nnodes || !pool->node_workers[node] || (self && self->node == node)) {
+    thread_pool_submit(pool, func, arg);
+    return;
+  }
+  task = xmalloc(sizeof(*task));
+  task->func  = func;
+  task->arg   = arg;
+  task->group = NULL;
+  mpmc_push(pool->node_queues[node], task);
+  parking_notify(&pool->idle);
+}
+
+/* Return's the numa node of the calling thread, which for a worker of a pinned pool is the node it's pinned to. */
+int thread_pool_current_node(void) {
+  return ((current_worker && current_worker->cpu >= 0) ? current_worker->node : numa_current_node());
+}
+
+/* When the calling thread is a pool worker, run one queued task of its pool.  This is how a worker that has to wait for something
+ * can keep making progress, instead of blocking a thread the pool depends on.  Return's `FALSE` when the calling thread is not a
+ * worker, or when there was no task to run. */
+bool thread_pool_help(void) {
+  ThreadPoolTask *task;
+  if (!current_worker || !(task = thread_pool_find_task(current_worker->pool, current_worker, (help_depth < THREAD_POOL_HELP_DEPTH)))) {
+    return FALSE;
+  }
+  ++help_depth;
+  thread_pool_run(task);
+  --help_depth;
+  return TRUE;
+}
+
+/* Set the number of workers the default pool will be created with, where zero means one per online cpu.  Note
+ * that this only has effect when called before the first use of the default pool.  Return's `FALSE` otherwise. */
+bool thread_pool_default_set_nthreads(Ulong nthreads) {
+  bool ret;
+  mutex_action(&default_pool_mutex,
+    if ((ret = !default_pool)) {
+      default_pool_nthreads = nthreads;
+    }
+  );
+  return ret;
+}
+
+/* Make the default pool pin its workers, see `thread_pool_create_pinned()`.  Note that this only has effect when called before the
+ * first use of the default pool.  Return's `FALSE` otherwise. */
+bool thread_pool_default_set_pinned(bool pinned) {
+  bool ret;
+  mutex_action(&default_pool_mutex,
+    if ((ret = !default_pool)) {
+      default_pool_pinned = pinned;
+    }
+  );
+  return ret;
+}
+
+/* Return's the process wide pool, creating it on first use.  The default pool lives until the process exits. */
+THREAD_POOL thread_pool_default(void) {
+  THREAD_POOL pool = __atomic_load_n(&default_pool, __ATOMIC_ACQUIRE);
+  if (!pool) {
+    mutex_action(&default_pool_mutex,
+      if (!(pool = default_pool)) {
+        pool = thread_pool_create_internal(default_pool_nthreads, default_pool_pinned);
+        __atomic_store_n(&default_pool, pool, __ATOMIC_RELEASE);
+      }
+    );
+  }
+  return pool;
+}
+
+/* ----------------------------- Task group ----------------------------- */
+
+/* Initialize `group` for spawning tasks into `pool`.  A group is usually a local variable of the function that forks the work. */
+void task_group_init(task_group_t *const group, THREAD_POOL pool) {
+  ASSERT(group);
+  ASSERT_THREAD_POOL(pool);
+  group->pool    = pool;
+  group->pending = 0;
+}
+
+/* Fork `func` with `arg` as a task counted in `group`, to be joined with `task_group_sync()`. */
+void task_group_spawn(task_group_t *const group, void (*func)(void *), void *arg) {
+  ASSERT(group);
+  ASSERT(func);
+  ThreadPoolTask *task = xmalloc(sizeof(*task));
+  task->func  = func;
+  task->arg   = arg;
+  task->group = group;
+  __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+  thread_pool_enqueue(group->pool, task);
+}
+
+/* Join all tasks spawned in `group`.  When called from a worker of the pool, the worker runs queued tasks while waiting, starting with its
+ * own deque, where the tasks it just spawned usually still are.  It only parks when there is nothing left to run, and the remaining tasks
+ * are all running on other threads.  Any other thread just parks.  After this returns, `group` can be used again. */
+void task_group_sync(task_group_t *const group) {
+  ASSERT(group);
+  ThreadPoolWorker *self = thread_pool_self(group->pool);
+  ThreadPoolTask *task;
+  Uint expected;
+  int spin = 0;
+  while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE)) {
+    if (self && (task = thread_pool_find_task(group->pool, self, (help_depth < THREAD_POOL_HELP_DEPTH)))) {
+      ++help_depth;
+      thread_pool_run(task);
+      --help_depth;
+      spin = 0;
+    }
+    else if (spin++ < THREAD_POOL_SPIN_COUNT) {
+      CPU_RELAX();
+    }
+    else {
+      expected = parking_prepare(&group->pool->sync);
+      if (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE)) {
+        parking_wait(&group->pool->sync, expected, NULL);
+      }
+      spin = 0;
+    }
+  }
+}
+
+#endif
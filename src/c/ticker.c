@@ -0,0 +1,154 @@
+/** @file ticker.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Drift-free fixed rate loops and rate limiting.  Every deadline is in `hiactime_now_ns()` time, the monotonic clock,
+  which is also the clock `hiactime_sleep_until_ns()` sleeps on, so a deadline is never read on one clock and slept
+  to on another.
+
+  A `ticker_t` keeps absolute deadlines, `start + n * period`, so the time spent between two waits, and any lateness
+  of a wakeup, never adds up over time.  A `token_bucket_t` hands out tokens at a fixed rate, with a burst allowance,
+  where blocking takers reserve their tokens up front, so they are served in order and at exactly the rate.
+
+ */
+#include "../include/proto.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* Add the tokens earned since the last refill to `tb`.  Note that `tb->lock` must be held. */
+static void token_bucket_refill(token_bucket_t *const tb, Llong now) {
+  if (now > tb->last) {
+    tb->tokens += ((double)(now - tb->last) * tb->rate);
+    if (tb->tokens > tb->burst) {
+      tb->tokens = tb->burst;
+    }
+    tb->last = now;
+  }
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Ticker ----------------------------- */
+
+/* Init `t` to tick every `period` nanoseconds, starting one period from now.  `policy` decides what happens after an
+ * overrun, see `TICKER_CATCH_UP` and `TICKER_SKIP`. */
+void ticker_init(ticker_t *const t, Llong period, int policy) {
+  ASSERT(t);
+  ALWAYS_ASSERT(period > 0);
+  ALWAYS_ASSERT(policy == TICKER_CATCH_UP || policy == TICKER_SKIP);
+  t->period     = period;
+  t->policy     = policy;
+  t->ticks      = 0;
+  t->overruns   = 0;
+  t->skipped    = 0;
+  t->jitter_sum = 0;
+  t->jitter_max = 0;
+  ticker_reset(t);
+}
+
+/* Restart `t` so the next deadline is one period from now, for instance after the loop was paused. */
+void ticker_reset(ticker_t *const t) {
+  ASSERT(t);
+  t->next = (hiactime_now_ns() + t->period);
+}
+
+/* Wait for the next deadline of `t`.  Return's the number of deadlines that passed since the last call, which is `1`
+ * unless `TICKER_SKIP` dropped some after an overrun. */
+Ulong ticker_wait(ticker_t *const t) {
+  ASSERT(t);
+  Llong now = hiactime_now_ns();
+  Llong late;
+  Ulong missed = 0;
+  if (now < t->next) {
+    hiactime_sleep_until_ns(t->next);
+    late = (hiactime_now_ns() - t->next);
+    t->jitter_sum += late;
+    if (late > t->jitter_max) {
+      t->jitter_max = late;
+    }
+  }
+  else {
+    ++t->overruns;
+    if (t->policy == TICKER_SKIP) {
+      missed = (Ulong)((now - t->next) / t->period);
+      t->skipped += missed;
+    }
+  }
+  ++t->ticks;
+  t->next += ((Llong)(missed + 1) * t->period);
+  return (missed + 1);
+}
+
+/* Return's the mean time a wakeup of `t` came after its deadline. */
+double ticker_jitter_avg_ns(const ticker_t *const t) {
+  ASSERT(t);
+  Ulong woken = (t->ticks - t->overruns);
+  return (woken ? ((double)t->jitter_sum / (double)woken) : 0.0);
+}
+
+/* ----------------------------- Token bucket ----------------------------- */
+
+/* Init `tb` to allow `rate` tokens per second on average, and at most `burst` at once.  It starts out full. */
+void token_bucket_init(token_bucket_t *const tb, double rate, double burst) {
+  ASSERT(tb);
+  ALWAYS_ASSERT(rate > 0 && burst >= 1);
+  tb->rate   = (rate / 1e9);
+  tb->burst  = burst;
+  tb->tokens = burst;
+  tb->last   = hiactime_now_ns();
+  fmutex_init(&tb->lock);
+}
+
+/* Take `n` tokens from `tb` only when they are available right now.  Return's `TRUE` when they were taken. */
+bool token_bucket_try_take(token_bucket_t *const tb, double n) {
+  ASSERT(tb);
+  bool ret = FALSE;
+  FMUTEX_ACTION(&tb->lock,
+    token_bucket_refill(tb, hiactime_now_ns());
+    if (tb->tokens >= n) {
+      tb->tokens -= n;
+      ret = TRUE;
+    }
+  );
+  return ret;
+}
+
+/* Take `n` tokens from `tb`, sleeping until they have been earned.  The tokens are reserved before sleeping, so
+ * concurrent takers queue up behind each other, rather then all waking up for the same tokens. */
+void token_bucket_take(token_bucket_t *const tb, double n) {
+  ASSERT(tb);
+  Llong now = hiactime_now_ns();
+  Llong deadline = now;
+  FMUTEX_ACTION(&tb->lock,
+    token_bucket_refill(tb, now);
+    tb->tokens -= n;
+    if (tb->tokens < 0) {
+      deadline = (now + (Llong)((-tb->tokens / tb->rate) + 0.5));
+    }
+  );
+  if (deadline > now) {
+    hiactime_sleep_until_ns(deadline);
+  }
+}
+
+/* Return's how long until `n` tokens would be available in `tb`, or `0` when they are available now. */
+Llong token_bucket_wait_ns(token_bucket_t *const tb, double n) {
+  ASSERT(tb);
+  Llong ret = 0;
+  FMUTEX_ACTION(&tb->lock,
+    token_bucket_refill(tb, hiactime_now_ns());
+    if (tb->tokens < n) {
+      ret = (Llong)(((n - tb->tokens) / tb->rate) + 0.5);
+    }
+  );
+  return ret;
+}
+
+#endif
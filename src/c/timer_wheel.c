@@ -0,0 +1,384 @@
+/** @file timer_wheel.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Hierarchical timer wheel.  Every level has 64 slots, where one slot in a level covers a full turn of the level
+  below it.  Adding and canceling a timer is `O(1)`, and a timer is moved at most once per level before it fires.
+  Time is measured in ticks of a fixed length from the creation of the wheel, using the monotonic clock.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+#define TIMER_WHEEL_BITS    (6)
+#define TIMER_WHEEL_SLOTS   (1UL << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK    (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS  (6)
+
+/* The digit of `tick` at `level`, this is the slot `tick` maps to on that level. */
+#define TIMER_WHEEL_DIGIT(tick, level)  (((tick) >> ((level) * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK)
+
+/* Timer levels that are not a real level.  A timer in the overflow list is beyond the range of all levels, and
+ * is re-added once the top level wraps around.  A pending timer is due, and is about to have its callback run. */
+#define TIMER_LEVEL_OVERFLOW  (TIMER_WHEEL_LEVELS)
+#define TIMER_LEVEL_PENDING   (TIMER_WHEEL_LEVELS + 1)
+#define TIMER_LEVEL_NONE      (-1)
+
+#define ASSERT_TIMER_WHEEL(x)  \
+  DO_WHILE(                    \
+    ASSERT((x));               \
+    ASSERT((x)->tick_ns > 0);  \
+  )
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+/* Intrusive circular list link, the list head is a link that is not part of any timer. */
+typedef struct TimerLink {
+  struct TimerLink *prev;
+  struct TimerLink *next;
+} TimerLink;
+
+struct TIMER_T {
+  TimerLink link;  /* Must be the first member. */
+  Ulong expires;   /* The tick this timer is due at. */
+  int level;
+  int slot;
+  TIMER_CB callback;
+  void *arg;
+};
+
+struct TIMER_WHEEL_T {
+  Llong base_ns;
+  Llong tick_ns;
+  /* The last tick that has been processed. */
+  Ulong current;
+  Ulong count;
+  /* One bit per non-empty slot on each level, so empty ranges can be skipped without touching the lists. */
+  Ulong occupied[TIMER_WHEEL_LEVELS];
+  TimerLink slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+  TimerLink overflow;
+  /* Released timers are kept here for reuse, linked through `link.next`. */
+  TIMER freelist;
+};
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- List ----------------------------- */
+
+static inline void timer_list_init(TimerLink *const head) {
+  head->prev = head;
+  head->next = head;
+}
+
+static inline bool timer_list_empty(const TimerLink *const head) {
+  return (head->next == head);
+}
+
+static inline void timer_list_append(TimerLink *const head, TimerLink *const link) {
+  link->prev = head->prev;
+  link->next = head;
+  head->prev->next = link;
+  head->prev = link;
+}
+
+static inline void timer_list_unlink(TimerLink *const link) {
+  link->prev->next = link->next;
+  link->next->prev = link->prev;
+}
+
+/* Move all links from `src` to the empty list `dst`, leaving `src` empty. */
+static void timer_list_splice(TimerLink *const src, TimerLink *const dst) {
+  if (timer_list_empty(src)) {
+    return;
+  }
+  dst->next = src->next;
+  dst->prev = src->prev;
+  dst->next->prev = dst;
+  dst->prev->next = dst;
+  timer_list_init(src);
+}
+
+/* ----------------------------- Timer ----------------------------- */
+
+static TIMER timer_get(TIMER_WHEEL tw) {
+  TIMER t;
+  if (tw->freelist) {
+    t = tw->freelist;
+    tw->freelist = (TIMER)t->link.next;
+  }
+  else {
+    t = xmalloc(sizeof(*t));
+  }
+  return t;
+}
+
+static void timer_release(TIMER_WHEEL tw, TIMER t) {
+  t->level     = TIMER_LEVEL_NONE;
+  t->link.next = (TimerLink *)tw->freelist;
+  tw->freelist = t;
+}
+
+/* Link `t` into the list its `expires` maps to, relative to the current tick.  The level is the highest 6-bit digit where
+ * `expires` and the current tick differ, that way the timer is cascaded down once the current tick reaches that digit. */
+static void timer_wheel_link(TIMER_WHEEL tw, TIMER t) {
+  Ulong diff = (t->expires ^ tw->current);
+  int level = (diff ? ((63 - __builtin_clzl(diff)) / TIMER_WHEEL_BITS) : 0);
+  if (level >= TIMER_WHEEL_LEVELS) {
+    t->level = TIMER_LEVEL_OVERFLOW;
+    t->slot  = 0;
+    timer_list_append(&tw->overflow, &t->link);
+  }
+  else {
+    t->level = level;
+    t->slot  = TIMER_WHEEL_DIGIT(t->expires, level);
+    tw->occupied[level] |= (1UL << t->slot);
+    timer_list_append(&tw->slots[level][t->slot], &t->link);
+  }
+}
+
+/* Unlink `t` from whatever list it is in, keeping the occupied bits in sync. */
+static void timer_wheel_unlink(TIMER_WHEEL tw, TIMER t) {
+  timer_list_unlink(&t->link);
+  if (t->level < TIMER_WHEEL_LEVELS && timer_list_empty(&tw->slots[t->level][t->slot])) {
+    tw->occupied[t->level] &= ~(1UL << t->slot);
+  }
+}
+
+/* ----------------------------- Wheel ----------------------------- */
+
+/* Re-add all timers in `list` relative to the current tick, this moves them at least one level down. */
+static void timer_wheel_cascade(TIMER_WHEEL tw, TimerLink *const list) {
+  TimerLink moving;
+  timer_list_init(&moving);
+  timer_list_splice(list, &moving);
+  while (!timer_list_empty(&moving)) {
+    TIMER t = (TIMER)moving.next;
+    timer_list_unlink(&t->link);
+    timer_wheel_link(tw, t);
+  }
+}
+
+/* Advance the wheel by exactly one tick, cascading any higher level slot the tick reaches, then run every timer due at
+ * that tick.  Timers are unlinked and released before their callback is run, so a callback may freely add or cancel timers.
+ * Return's the number of callbacks that ran. */
+static Ulong timer_wheel_tick(TIMER_WHEEL tw) {
+  TimerLink pending;
+  TIMER t;
+  TIMER_CB callback;
+  void *arg;
+  Ulong fired = 0;
+  int top;
+  int slot;
+  ++tw->current;
+  if (!(tw->current & TIMER_WHEEL_MASK)) {
+    /* Find the highest level the wraparound reaches, and cascade from there and down, so that timers moved
+     * down from a higher level are moved again if they land in a slot that is also being cascaded. */
+    top = 1;
+    while (top < TIMER_WHEEL_LEVELS && !TIMER_WHEEL_DIGIT(tw->current, top)) {
+      ++top;
+    }
+    if (top == TIMER_WHEEL_LEVELS) {
+      timer_wheel_cascade(tw, &tw->overflow);
+      --top;
+    }
+    for (int level=top; level>=1; --level) {
+      slot = TIMER_WHEEL_DIGIT(tw->current, level);
+      tw->occupied[level] &= ~(1UL << slot);
+      timer_wheel_cascade(tw, &tw->slots[level][slot]);
+    }
+  }
+  slot = (tw->current & TIMER_WHEEL_MASK);
+  timer_list_init(&pending);
+  timer_list_splice(&tw->slots[0][slot], &pending);
+  tw->occupied[0] &= ~(1UL << slot);
+  for (TimerLink *link=pending.next; link!=&pending; link=link->next) {
+    ((TIMER)link)->level = TIMER_LEVEL_PENDING;
+  }
+  while (!timer_list_empty(&pending)) {
+    t = (TIMER)pending.next;
+    timer_list_unlink(&t->link);
+    callback = t->callback;
+    arg      = t->arg;
+    timer_release(tw, t);
+    --tw->count;
+    callback(arg);
+    ++fired;
+  }
+  return fired;
+}
+
+/* Return's the first tick after the current one where something has to happen, either a timer is due, or a higher level
+ * slot must be cascaded.  The lowest non-empty level always holds the earliest one.  Return's `UlongMAX` when empty. */
+static Ulong timer_wheel_next_tick(TIMER_WHEEL tw) {
+  Ulong digit;
+  Ulong above;
+  Ulong bits;
+  for (int level=0; level<TIMER_WHEEL_LEVELS; ++level) {
+    digit = TIMER_WHEEL_DIGIT(tw->current, level);
+    bits  = ((digit == TIMER_WHEEL_MASK) ? 0 : (tw->occupied[level] & (~0UL << (digit + 1))));
+    if (bits) {
+      above = ((tw->current >> ((level + 1) * TIMER_WHEEL_BITS)) << ((level + 1) * TIMER_WHEEL_BITS));
+      return (above | ((Ulong)__builtin_ctzl(bits) << (level * TIMER_WHEEL_BITS)));
+    }
+  }
+  if (!timer_list_empty(&tw->overflow)) {
+    return (((tw->current >> (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)) + 1) << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS));
+  }
+  return UlongMAX;
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* Create a timer wheel where one tick is `tick_ns` nano-seconds, starting at the current monotonic time.  Timers never
+ * fire early, but can fire up to one tick late, so `tick_ns` is the trade-off between accuracy and the work done per advance. */
+TIMER_WHEEL timer_wheel_create(Llong tick_ns) {
+  ALWAYS_ASSERT(tick_ns > 0);
+  TIMER_WHEEL tw = xmalloc(sizeof(*tw));
+  tw->base_ns  = hiactime_now_ns();
+  tw->tick_ns  = tick_ns;
+  tw->current  = 0;
+  tw->count    = 0;
+  tw->freelist = NULL;
+  for (int level=0; level<TIMER_WHEEL_LEVELS; ++level) {
+    tw->occupied[level] = 0;
+    for (Ulong slot=0; slot<TIMER_WHEEL_SLOTS; ++slot) {
+      timer_list_init(&tw->slots[level][slot]);
+    }
+  }
+  timer_list_init(&tw->overflow);
+  return tw;
+}
+
+/* Free `tw` and all timers in it, without running any callback.  No-op on `NULL`. */
+void timer_wheel_free(TIMER_WHEEL tw) {
+  TIMER t;
+  if (!tw) {
+    return;
+  }
+  for (int level=0; level<TIMER_WHEEL_LEVELS; ++level) {
+    for (Ulong slot=0; slot<TIMER_WHEEL_SLOTS; ++slot) {
+      while (!timer_list_empty(&tw->slots[level][slot])) {
+        t = (TIMER)tw->slots[level][slot].next;
+        timer_list_unlink(&t->link);
+        free(t);
+      }
+    }
+  }
+  while (!timer_list_empty(&tw->overflow)) {
+    t = (TIMER)tw->overflow.next;
+    timer_list_unlink(&t->link);
+    free(t);
+  }
+  while (tw->freelist) {
+    t = tw->freelist;
+    tw->freelist = (TIMER)t->link.next;
+    free(t);
+  }
+  free(tw);
+}
+
+/* Return's the number of timers that are waiting to fire. */
+Ulong timer_wheel_size(TIMER_WHEEL tw) {
+  ASSERT_TIMER_WHEEL(tw);
+  return tw->count;
+}
+
+/* Add a timer that runs `callback` with `arg` once the monotonic time `deadline_ns` has been reached.  A deadline that has already
+ * passed fires on the next tick.  The returned handle is valid until the callback has started to run, or the timer is canceled. */
+TIMER timer_wheel_add_at(TIMER_WHEEL tw, Llong deadline_ns, TIMER_CB callback, void *arg) {
+  ASSERT_TIMER_WHEEL(tw);
+  ASSERT(callback);
+  TIMER t = timer_get(tw);
+  /* Round up, so that a timer never fires before its deadline. */
+  if (deadline_ns <= tw->base_ns) {
+    t->expires = 0;
+  }
+  else {
+    t->expires = (Ulong)(((deadline_ns - tw->base_ns) + (tw->tick_ns - 1)) / tw->tick_ns);
+  }
+  if (t->expires <= tw->current) {
+    t->expires = (tw->current + 1);
+  }
+  t->callback = callback;
+  t->arg      = arg;
+  timer_wheel_link(tw, t);
+  ++tw->count;
+  return t;
+}
+
+/* Add a timer that runs `callback` with `arg` once `timeout_ns` nano-seconds have passed from now. */
+TIMER timer_wheel_add(TIMER_WHEEL tw, Llong timeout_ns, TIMER_CB callback, void *arg) {
+  return timer_wheel_add_at(tw, (hiactime_now_ns() + timeout_ns), callback, arg);
+}
+
+/* Cancel the timer `t`, so its callback will never run.  Note that `t` must still be valid, so this cannot be
+ * called for a timer whose callback has already started to run, including from within that callback. */
+void timer_wheel_cancel(TIMER_WHEEL tw, TIMER t) {
+  ASSERT_TIMER_WHEEL(tw);
+  ASSERT(t);
+  ALWAYS_ASSERT_MSG((t->level != TIMER_LEVEL_NONE), "Canceling a timer that is no longer valid");
+  if (t->level == TIMER_LEVEL_PENDING) {
+    timer_list_unlink(&t->link);
+  }
+  else {
+    timer_wheel_unlink(tw, t);
+  }
+  timer_release(tw, t);
+  --tw->count;
+}
+
+/* Process every tick up to the monotonic time `now_ns`, running the callback of every timer that is due, in tick order.
+ * Runs of ticks where nothing happens are skipped without touching them.  Return's the number of callbacks that ran. */
+Ulong timer_wheel_advance_to(TIMER_WHEEL tw, Llong now_ns) {
+  ASSERT_TIMER_WHEEL(tw);
+  Ulong target;
+  Ulong next;
+  Ulong fired = 0;
+  if (now_ns <= tw->base_ns) {
+    return 0;
+  }
+  target = (Ulong)((now_ns - tw->base_ns) / tw->tick_ns);
+  while (tw->current < target) {
+    next = (tw->count ? timer_wheel_next_tick(tw) : UlongMAX);
+    if (next > target) {
+      tw->current = target;
+      break;
+    }
+    tw->current = (next - 1);
+    fired += timer_wheel_tick(tw);
+  }
+  return fired;
+}
+
+/* Same as `timer_wheel_advance_to()`, using the current monotonic time. */
+Ulong timer_wheel_advance(TIMER_WHEEL tw) {
+  return timer_wheel_advance_to(tw, hiactime_now_ns());
+}
+
+/* Return's the monotonic time in nano-seconds when the wheel next needs to be advanced, or `-1` when it has no timers.  This is exact
+ * when the next timer is within the first level, otherwise it's the time the timer will be cascaded, which is never later then it's due.
+ * This makes it a safe timeout for a poll or sleep in the loop that advances the wheel. */
+Llong timer_wheel_next_ns(TIMER_WHEEL tw) {
+  ASSERT_TIMER_WHEEL(tw);
+  Ulong next;
+  if (!tw->count) {
+    return -1;
+  }
+  next = timer_wheel_next_tick(tw);
+  return (tw->base_ns + ((Llong)next * tw->tick_ns));
+}
+
+#endif
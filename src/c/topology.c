@@ -0,0 +1,258 @@
+/** @file topology.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Cpu and numa topology, read once from `/sys/devices/system/cpu` and `/sys/devices/system/node`, and thread placement on top of it.
+  When sysfs is missing or unreadable, every online cpu is reported as its own core on node 0, so callers never need a special case.
+
+ */
+#define _GNU_SOURCE
+#include "../include/proto.h"
+
+#if !__WIN__
+
+#include <sched.h>
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+#define TOPOLOGY_CPU_PATH   "/sys/devices/system/cpu"
+#define TOPOLOGY_NODE_PATH  "/sys/devices/system/node"
+
+/* The size of the buffer any single sysfs file is read into. */
+#define TOPOLOGY_READ_MAX  (4096)
+
+
+/* ---------------------------------------------------------- Variable's ---------------------------------------------------------- */
+
+
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+
+/* All online cpu's, in placement order. */
+static cpu_topology_t *topology_cpus = NULL;
+static Ulong topology_ncpus = 0;
+static Ulong topology_nnodes = 1;
+
+/* Maps a cpu id to its node, indexed by the id. */
+static int *topology_node_map = NULL;
+static int topology_max_cpu = -1;
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+/* Read the sysfs file `path` into `buf`.  Return's `FALSE` when it could not be read. */
+static bool topology_read(const char *const restrict path, char *const buf, Ulong size) {
+  int fd;
+  long len;
+  if ((fd = open(path, (O_RDONLY | O_CLOEXEC))) < 0) {
+    return FALSE;
+  }
+  len = read(fd, buf, (size - 1));
+  close(fd);
+  if (len <= 0) {
+    return FALSE;
+  }
+  buf[len] = '\0';
+  return TRUE;
+}
+
+/* Read a single integer from the sysfs file `path`, or return `fallback`. */
+static int topology_read_int(const char *const restrict path, int fallback) {
+  char buf[64];
+  if (!topology_read(path, buf, sizeof(buf))) {
+    return fallback;
+  }
+  return (int)strtol(buf, NULL, 10);
+}
+
+/* Parse a sysfs cpu list like `0-3,8-11` from `str`, calling `func` with every cpu in it.  Return's the number of cpu's. */
+static Ulong topology_parse_list(const char *str, void (*func)(int cpu, void *arg), void *arg) {
+  char *end;
+  long first;
+  long last;
+  Ulong n = 0;
+  while (*str) {
+    first = strtol(str, &end, 10);
+    if (end == str) {
+      break;
+    }
+    last = first;
+    str  = end;
+    if (*str == '-') {
+      last = strtol((str + 1), &end, 10);
+      str  = end;
+    }
+    for (long cpu=first; cpu<=last; ++cpu) {
+      func((int)cpu, arg);
+      ++n;
+    }
+    while (*str == ',' || *str == '\n') {
+      ++str;
+    }
+  }
+  return n;
+}
+
+static void topology_add_cpu(int cpu, void _UNUSED *arg) {
+  cpu_topology_t *entry;
+  topology_cpus = xrealloc(topology_cpus, (sizeof(*topology_cpus) * (topology_ncpus + 1)));
+  entry = &topology_cpus[topology_ncpus++];
+  entry->id      = cpu;
+  entry->core    = cpu;
+  entry->package = 0;
+  entry->node    = 0;
+  entry->smt     = 0;
+  if (cpu > topology_max_cpu) {
+    topology_max_cpu = cpu;
+  }
+}
+
+static void topology_set_node(int cpu, void *arg) {
+  if (cpu <= topology_max_cpu) {
+    topology_node_map[cpu] = *(int *)arg;
+  }
+}
+
+static void topology_max_id(int id, void *arg) {
+  if (id > *(int *)arg) {
+    *(int *)arg = id;
+  }
+}
+
+/* Sort by node first, so consecutive entries fill one node before the next.  Within a node, the first hardware thread of every
+ * core comes before any second one, so threads placed in this order only share a physical core once the node has run out. */
+static int topology_compare(const void *a, const void *b) {
+  const cpu_topology_t *x = a;
+  const cpu_topology_t *y = b;
+  if (x->node != y->node) {
+    return ((x->node < y->node) ? -1 : 1);
+  }
+  if (x->smt != y->smt) {
+    return ((x->smt < y->smt) ? -1 : 1);
+  }
+  if (x->package != y->package) {
+    return ((x->package < y->package) ? -1 : 1);
+  }
+  if (x->core != y->core) {
+    return ((x->core < y->core) ? -1 : 1);
+  }
+  return ((x->id < y->id) ? -1 : (x->id > y->id));
+}
+
+static void topology_init(void) {
+  char *buf = xmalloc(TOPOLOGY_READ_MAX);
+  char path[PATH_MAX];
+  int node;
+  int max_node = 0;
+  long n;
+  if (!topology_read(TOPOLOGY_CPU_PATH "/online", buf, TOPOLOGY_READ_MAX) || !topology_parse_list(buf, topology_add_cpu, NULL)) {
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int cpu=0; cpu<((n > 0) ? n : 1); ++cpu) {
+      topology_add_cpu(cpu, NULL);
+    }
+  }
+  topology_node_map = xcalloc((topology_max_cpu + 1), sizeof(*topology_node_map));
+  /* Node membership.  Nodes can be sparse, so every possible one up to the highest is tried. */
+  if (topology_read(TOPOLOGY_NODE_PATH "/possible", buf, TOPOLOGY_READ_MAX)) {
+    topology_parse_list(buf, topology_max_id, &max_node);
+  }
+  for (node=0; node<=max_node; ++node) {
+    snprintf(path, sizeof(path), TOPOLOGY_NODE_PATH "/node%d/cpulist", node);
+    if (topology_read(path, buf, TOPOLOGY_READ_MAX)) {
+      topology_parse_list(buf, topology_set_node, &node);
+    }
+  }
+  for (Ulong i=0; i<topology_ncpus; ++i) {
+    cpu_topology_t *entry = &topology_cpus[i];
+    snprintf(path, sizeof(path), TOPOLOGY_CPU_PATH "/cpu%d/topology/core_id", entry->id);
+    entry->core = topology_read_int(path, entry->id);
+    snprintf(path, sizeof(path), TOPOLOGY_CPU_PATH "/cpu%d/topology/physical_package_id", entry->id);
+    entry->package = topology_read_int(path, 0);
+    entry->node    = topology_node_map[entry->id];
+    if ((Ulong)(entry->node + 1) > topology_nnodes) {
+      topology_nnodes = (entry->node + 1);
+    }
+    /* Count the hardware threads of the same core that came before this one. */
+    for (Ulong j=0; j<i; ++j) {
+      if (topology_cpus[j].core == entry->core && topology_cpus[j].package == entry->package) {
+        ++entry->smt;
+      }
+    }
+  }
+  qsort(topology_cpus, topology_ncpus, sizeof(*topology_cpus), topology_compare);
+  free(buf);
+}
+
+static inline void topology_ensure(void) {
+  pthread_once(&topology_once, topology_init);
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Topology ----------------------------- */
+
+/* Return's the number of online cpu's. */
+Ulong cpu_topology_count(void) {
+  topology_ensure();
+  return topology_ncpus;
+}
+
+/* Return's the cpu at `idx` in placement order, that is grouped by node, and spread over physical cores before
+ * hardware threads.  So the first `n` entries are the best cpu's to pin `n` threads to.  Note that `idx` wraps. */
+const cpu_topology_t *cpu_topology_get(Ulong idx) {
+  topology_ensure();
+  return &topology_cpus[idx % topology_ncpus];
+}
+
+/* Return's the number of numa nodes, which is always at least 1. */
+Ulong numa_node_count(void) {
+  topology_ensure();
+  return topology_nnodes;
+}
+
+/* Return's the node `cpu` belongs to, or 0 when `cpu` is unknown. */
+int numa_node_of_cpu(int cpu) {
+  topology_ensure();
+  return ((cpu >= 0 && cpu <= topology_max_cpu) ? topology_node_map[cpu] : 0);
+}
+
+/* Return's the node of the cpu the calling thread currently runs on.  Note that unless the thread is pinned, this can change at any time. */
+int numa_current_node(void) {
+  return numa_node_of_cpu(sched_getcpu());
+}
+
+/* ----------------------------- Placement ----------------------------- */
+
+/* Pin `thread` to `cpu`.  Return's `FALSE` when the kernel refused, for instance when `cpu` is offline. */
+bool thread_pin_to_cpu(thread_t thread, int cpu) {
+  cpu_set_t set;
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+    return FALSE;
+  }
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return (pthread_setaffinity_np(thread, sizeof(set), &set) == 0);
+}
+
+/* Allow `thread` to run on any cpu of `node`, but no others.  Memory the thread touches first is then allocated on `node`
+ * by the kernel's default first-touch policy.  Return's `FALSE` when `node` has no cpu's, or the kernel refused. */
+bool thread_pin_to_node(thread_t thread, int node) {
+  cpu_set_t set;
+  bool any = FALSE;
+  topology_ensure();
+  CPU_ZERO(&set);
+  for (Ulong i=0; i<topology_ncpus; ++i) {
+    if (topology_cpus[i].node == node && topology_cpus[i].id < CPU_SETSIZE) {
+      CPU_SET(topology_cpus[i].id, &set);
+      any = TRUE;
+    }
+  }
+  return (any && pthread_setaffinity_np(thread, sizeof(set), &set) == 0);
+}
+
+#endif
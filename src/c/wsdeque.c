@@ -0,0 +1,169 @@
+/** @file wsdeque.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Chase-Lev work-stealing deque.  The owning thread pushes and pops at the bottom without any atomic read-modify-write
+  in the common case, while any number of other threads steal from the top with a single CAS.  The buffer grows when
+  full, and old buffers are kept until the deque is freed, as a thief can still be reading from one.
+
+ */
+#define _USE_ALL_BUILTINS
+#include "../include/proto.h"
+
+#if !__WIN__
+
+
+/* ---------------------------------------------------------- Define's ---------------------------------------------------------- */
+
+
+#define ASSERT_WSDEQUE(x)  \
+  DO_WHILE(                \
+    ASSERT((x));           \
+    ASSERT((x)->array);    \
+  )
+
+
+/* ---------------------------------------------------------- Struct's ---------------------------------------------------------- */
+
+
+typedef struct WsdequeArray {
+  long mask;
+  struct WsdequeArray *prev;  /* The buffer this one replaced, kept alive until the deque is freed. */
+  void *data[];
+} WsdequeArray;
+
+struct WSDEQUE_T {
+  /* Thieves take from here. */
+  long top _ALIGNED(_CACHELINE_SIZE);
+  /* Only ever written by the owner. */
+  long bottom _ALIGNED(_CACHELINE_SIZE);
+  WsdequeArray *array;
+};
+
+
+/* ---------------------------------------------------------- Static function's ---------------------------------------------------------- */
+
+
+static WsdequeArray *wsdeque_array_create(long cap, WsdequeArray *prev) {
+  WsdequeArray *array = xmalloc(sizeof(*array) + (_PTRSIZE * cap));
+  array->mask = (cap - 1);
+  array->prev = prev;
+  return array;
+}
+
+/* Owner only.  Double the buffer, copying the live range from `top` to `bottom`. */
+static WsdequeArray *wsdeque_grow(WSDEQUE dq, WsdequeArray *array, long top, long bottom) {
+  WsdequeArray *grown = wsdeque_array_create(((array->mask + 1) * 2), array);
+  for (long i=top; i<bottom; ++i) {
+    grown->data[i & grown->mask] = __atomic_load_n(&array->data[i & array->mask], __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&dq->array, grown, __ATOMIC_RELEASE);
+  return grown;
+}
+
+
+/* ---------------------------------------------------------- Global function's ---------------------------------------------------------- */
+
+
+/* Create a deque with a initial capacity of at least `cap` entries, rounded up to the nearest power of 2. */
+WSDEQUE wsdeque_create(Ulong cap) {
+  long realcap = 2;
+  WSDEQUE dq = xmalloc_aligned(_CACHELINE_SIZE, sizeof(*dq));
+  while ((Ulong)realcap < cap) {
+    realcap <<= 1;
+  }
+  dq->top    = 0;
+  dq->bottom = 0;
+  dq->array  = wsdeque_array_create(realcap, NULL);
+  return dq;
+}
+
+/* Free `dq`.  Note that any entries still in it are not freed, and that no thread may be using it.  No-op on `NULL`. */
+void wsdeque_free(WSDEQUE dq) {
+  WsdequeArray *prev;
+  if (!dq) {
+    return;
+  }
+  while (dq->array) {
+    prev = dq->array->prev;
+    free(dq->array);
+    dq->array = prev;
+  }
+  free(dq);
+}
+
+/* Return's a snapshot of the number of entries in `dq`.  Safe to call from any thread. */
+Ulong wsdeque_size(WSDEQUE dq) {
+  ASSERT_WSDEQUE(dq);
+  long bottom = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+  long top    = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+  return ((bottom > top) ? (Ulong)(bottom - top) : 0);
+}
+
+/* Owner only.  Push `data` onto the bottom of `dq`, growing it when full. */
+void wsdeque_push(WSDEQUE dq, void *data) {
+  ASSERT_WSDEQUE(dq);
+  long bottom = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+  long top    = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+  WsdequeArray *array = __atomic_load_n(&dq->array, __ATOMIC_RELAXED);
+  if ((bottom - top) > array->mask) {
+    array = wsdeque_grow(dq, array, top, bottom);
+  }
+  __atomic_store_n(&array->data[bottom & array->mask], data, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&dq->bottom, (bottom + 1), __ATOMIC_RELAXED);
+}
+
+/* Owner only.  Pop the most recently pushed entry into `*out`.  Return's `FALSE` when `dq` is empty, or when a thief took the last entry. */
+bool wsdeque_pop(WSDEQUE dq, void **const out) {
+  ASSERT_WSDEQUE(dq);
+  ASSERT(out);
+  long bottom = (__atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1);
+  WsdequeArray *array = __atomic_load_n(&dq->array, __ATOMIC_RELAXED);
+  long top;
+  bool ret = TRUE;
+  __atomic_store_n(&dq->bottom, bottom, __ATOMIC_RELAXED);
+  /* Make the reservation of `bottom` visible before reading `top`, this is what orders us against thieves. */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  top = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+  if (top <= bottom) {
+    *out = __atomic_load_n(&array->data[bottom & array->mask], __ATOMIC_RELAXED);
+    /* This is the last entry, so race the thieves for it. */
+    if (top == bottom) {
+      if (!__atomic_compare_exchange_n(&dq->top, &top, (top + 1), FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        ret = FALSE;
+      }
+      __atomic_store_n(&dq->bottom, (bottom + 1), __ATOMIC_RELAXED);
+    }
+  }
+  else {
+    ret = FALSE;
+    __atomic_store_n(&dq->bottom, (bottom + 1), __ATOMIC_RELAXED);
+  }
+  return ret;
+}
+
+/* Any thread.  Steal the oldest entry into `*out`.  Return's `FALSE` when `dq` is empty, or when another thread won the entry. */
+bool wsdeque_steal(WSDEQUE dq, void **const out) {
+  ASSERT_WSDEQUE(dq);
+  ASSERT(out);
+  long top = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+  long bottom;
+  WsdequeArray *array;
+  void *data;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  bottom = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+  if (top >= bottom) {
+    return FALSE;
+  }
+  array = __atomic_load_n(&dq->array, __ATOMIC_ACQUIRE);
+  data  = __atomic_load_n(&array->data[top & array->mask], __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&dq->top, &top, (top + 1), FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    return FALSE;
+  }
+  *out = data;
+  return TRUE;
+}
+
+#endif
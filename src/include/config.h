@@ -65,6 +65,18 @@
 #ifdef _UNUSED
 # undef _UNUSED
 #endif
+#ifdef _ALIGNED
+# undef _ALIGNED
+#endif
+#ifdef _SECTION
+# undef _SECTION
+#endif
+#ifdef _USED
+# undef _USED
+#endif
+#ifdef CPU_RELAX
+# undef CPU_RELAX
+#endif
 #ifdef __ATOMIC_SWAP
 # undef __ATOMIC_SWAP
 #endif
@@ -118,6 +130,7 @@
 #else
 # define _HAS_ATTRIBUTE(attr)      _ATTR_##attr
 # define _ATTR_alloc_size          _GNUC_VER(4, 3)
+# define _ATTR_aligned             _GNUC_VER(2, 7)
 # define _ATTR_always_inline       _GNUC_VER(3, 2)
 # define _ATTR_artificial          _GNUC_VER(4, 3)
 # define _ATTR_cold                _GNUC_VER(4, 3)
@@ -224,6 +237,27 @@
 # define _UNUSED
 #endif
 
+/* Applies to: variables, struct fields and types. */
+#if _HAS_ATTRIBUTE(aligned)
+# define _ALIGNED(x)  __attribute__((__aligned__(x)))
+#else
+# define _ALIGNED(x)
+#endif
+
+/* Applies to: variables and functions.  Places the symbol in the section `x`. */
+#if _HAS_ATTRIBUTE(section)
+# define _SECTION(x)  __attribute__((__section__(x)))
+#else
+# define _SECTION(x)
+#endif
+
+/* Applies to: variables and functions.  Keeps the symbol, even when nothing references it. */
+#if _HAS_ATTRIBUTE(used)
+# define _USED  __attribute__((__used__))
+#else
+# define _USED
+#endif
+
 #if _HAS_ATTRIBUTE(counted_by)
 # define _COUNTED_BY(x)  __attribute__((__counted_by__(x)))
 #else
@@ -242,6 +276,13 @@
 # define PREFETCH(...)  ((void)0)
 #endif
 
+/* Hint to the cpu that we are in a spin-wait loop.  On x86 this is the `pause` instruction. */
+#if _HAS_BUILTIN(ia32_pause)
+# define CPU_RELAX()  __builtin_ia32_pause()
+#else
+# define CPU_RELAX()  ((void)0)
+#endif
+
 /* ----------------------------- String shorthands ----------------------------- */
 
 #if _HAS_BUILTIN(strlen)
@@ -714,7 +755,7 @@
 # define memset(...)             MEMSET(__VA_ARGS__)
 # define memcpy(...)             MEMCPY(__VA_ARGS__)
 # define memmove(...)            MEMMOVE(__VA_ARGS__)
-# define memcmp(...)             MEMCPY(__VA_ARGS__)
+# define memcmp(...)             MEMCMP(__VA_ARGS__)
 # define free(x)                 FREE(x)
 # define malloc(...)             MALLOC(__VA_ARGS__)
 # define realloc(...)            REALLOC(__VA_ARGS__)
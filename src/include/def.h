@@ -31,6 +31,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <fcntl.h>
 #ifndef __WIN__
 # include <unistd.h>
@@ -56,6 +57,11 @@
 # include <sys/inotify.h>
 # include <sys/epoll.h>
 # include <sys/eventfd.h>
+# include <sys/mman.h>
+# include <sys/prctl.h>
+# include <sys/syscall.h>
+# include <sys/uio.h>
+# include <linux/futex.h>
 #endif
 
 /* ----------------------------- fcio ----------------------------- */
@@ -618,11 +624,16 @@
 #ifdef M_PIf
 # undef M_PIf
 #endif
+#ifdef _CACHELINE_SIZE
+# undef _CACHELINE_SIZE
+#endif
 
 /* Size of a ptr in bits. */
 #define _PTR_BITSIZE  __WORDSIZE
 /* Size of a ptr in bytes. */
 #define _PTRSIZE  (sizeof(void *))
+/* Size of a cache-line in bytes.  Used to keep data written by different threads from sharing a line. */
+#define _CACHELINE_SIZE  (64)
 
 /* Ripped from <math.h>. */
 #define M_PIf	3.14159265358979323846f	/* pi */
@@ -851,6 +862,12 @@
 #ifdef FRAME_SWAP_RATE_TIME_NS_INT
 # undef FRAME_SWAP_RATE_TIME_NS_INT
 #endif
+#ifdef TICKER_CATCH_UP
+# undef TICKER_CATCH_UP
+#endif
+#ifdef TICKER_SKIP
+# undef TICKER_SKIP
+#endif
 
 #define RDTSC(low, high)            \
     __asm__ __volatile__("rdtsc"    \
@@ -877,6 +894,11 @@
 
 #define FRAME_SWAP_RATE_TIME_NS_INT(x)  ((Llong)((1e9 / (x)) + 0.5))
 
+/* Overrun policies of a `ticker_t`.  `TICKER_CATCH_UP` keeps every deadline, so after an overrun the missed ticks fire
+ * back to back, `TICKER_SKIP` drops the missed ticks and waits for the next deadline still in the future. */
+#define TICKER_CATCH_UP  (0)
+#define TICKER_SKIP      (1)
+
 /* ----------------------------- Threads ----------------------------- */
 
 #ifdef thread_t
@@ -918,6 +940,21 @@
 #ifdef MUTEX_ACTION
 # undef MUTEX_ACTION
 #endif
+#ifdef LOCKPROF_HIST_BUCKETS
+# undef LOCKPROF_HIST_BUCKETS
+#endif
+#ifdef LOCKPROF_SITE_INIT
+# undef LOCKPROF_SITE_INIT
+#endif
+#ifdef LOCKPROF_MUTEX_ACTION
+# undef LOCKPROF_MUTEX_ACTION
+#endif
+#ifdef LOCKPROF_MUTEX_ACTION_ID
+# undef LOCKPROF_MUTEX_ACTION_ID
+#endif
+#ifdef LOCKPROF_MUTEX_ACTION_IMPL
+# undef LOCKPROF_MUTEX_ACTION_IMPL
+#endif
 #ifdef mutex_init_static
 # undef mutex_init_static
 #endif
@@ -933,6 +970,9 @@
 #ifdef cond_wait
 # undef cond_wait
 #endif
+#ifdef cond_broadcast
+# undef cond_broadcast
+#endif
 #ifdef RWLOCK_INIT
 # undef RWLOCK_INIT
 #endif
@@ -954,6 +994,36 @@
 #ifdef RWLOCK_RDLOCK_ACTION
 # undef RWLOCK_RDLOCK_ACTION
 #endif
+#ifdef FMUTEX_INIT
+# undef FMUTEX_INIT
+#endif
+#ifdef FMUTEX_ACTION
+# undef FMUTEX_ACTION
+#endif
+#ifdef PRWLOCK_RDLOCK_ACTION
+# undef PRWLOCK_RDLOCK_ACTION
+#endif
+#ifdef PRWLOCK_WRLOCK_ACTION
+# undef PRWLOCK_WRLOCK_ACTION
+#endif
+#ifdef SEQLOCK_READ_ACTION
+# undef SEQLOCK_READ_ACTION
+#endif
+#ifdef SEQLOCK_WRITE_ACTION
+# undef SEQLOCK_WRITE_ACTION
+#endif
+#ifdef TICKETLOCK_INIT
+# undef TICKETLOCK_INIT
+#endif
+#ifdef TICKETLOCK_ACTION
+# undef TICKETLOCK_ACTION
+#endif
+#ifdef MCSLOCK_INIT
+# undef MCSLOCK_INIT
+#endif
+#ifdef MCSLOCK_ACTION
+# undef MCSLOCK_ACTION
+#endif
 
 /* Thread shorthand. */
 #define thread_t  pthread_t
@@ -978,15 +1048,49 @@
 #define mutex_destroy             pthread_mutex_destroy
 #define mutex_lock                pthread_mutex_lock
 #define mutex_unlock              pthread_mutex_unlock
-#define mutex_action(mutex, ...)  DO_WHILE(mutex_lock((mutex)); DO_WHILE(__VA_ARGS__); mutex_unlock((mutex));)
-#define MUTEX_ACTION(mutex, ...)  DO_WHILE(mutex_lock((mutex)); DO_WHILE(__VA_ARGS__); mutex_unlock((mutex));)
+#ifdef FCIO_LOCK_PROFILE
+# define mutex_action(mutex, ...)  LOCKPROF_MUTEX_ACTION(#mutex, mutex, __VA_ARGS__)
+# define MUTEX_ACTION(mutex, ...)  LOCKPROF_MUTEX_ACTION(#mutex, mutex, __VA_ARGS__)
+#else
+# define mutex_action(mutex, ...)  DO_WHILE(mutex_lock((mutex)); DO_WHILE(__VA_ARGS__); mutex_unlock((mutex));)
+# define MUTEX_ACTION(mutex, ...)  DO_WHILE(mutex_lock((mutex)); DO_WHILE(__VA_ARGS__); mutex_unlock((mutex));)
+#endif
 #define mutex_init_static         PTHREAD_MUTEX_INITIALIZER
 
+/* ----------------------------- Lock profiling ----------------------------- */
+
+/* The number of power of two cycle buckets in the hold time histogram of a `lockprof_site_t`. */
+#define LOCKPROF_HIST_BUCKETS  (32)
+
+/* Initializer for a `lockprof_site_t` of the lock `lock_name`, tagged with the current location. */
+#define LOCKPROF_SITE_INIT(lock_name)  { .name = (lock_name), .file = __FILE__, .line = __LINE__ }
+
+/* `mutex_action()` when built with `FCIO_LOCK_PROFILE`.  Every expansion is its own site, the lock is first tried, so a
+ * wait is only counted as contended when someone else actually held it.  The locals are suffixed with a unique id, so
+ * nested actions don't shadow each other. */
+#define LOCKPROF_MUTEX_ACTION(name, mutex, ...)  LOCKPROF_MUTEX_ACTION_ID(__COUNTER__, name, mutex, __VA_ARGS__)
+#define LOCKPROF_MUTEX_ACTION_ID(id, ...)        LOCKPROF_MUTEX_ACTION_IMPL(id, __VA_ARGS__)
+#define LOCKPROF_MUTEX_ACTION_IMPL(id, name, mutex, ...)                                     \
+  DO_WHILE(                                                                                  \
+    static lockprof_site_t __lockprof_site_##id = LOCKPROF_SITE_INIT(name);                  \
+    Ulong __lockprof_start_##id = lockprof_cycles();                                         \
+    bool __lockprof_contended_##id = (pthread_mutex_trylock((mutex)) != 0);                  \
+    if (__lockprof_contended_##id) {                                                         \
+      mutex_lock((mutex));                                                                   \
+    }                                                                                        \
+    __lockprof_start_##id = lockprof_acquired(&__lockprof_site_##id, __lockprof_start_##id,  \
+      __lockprof_contended_##id);                                                            \
+    DO_WHILE(__VA_ARGS__);                                                                   \
+    lockprof_released(&__lockprof_site_##id, __lockprof_start_##id);                         \
+    mutex_unlock((mutex));                                                                   \
+  )
+
 /* Condition helper shorthand's. */
-#define cond_init     pthread_cond_init
-#define cond_signal   pthread_cond_signal
-#define cond_destroy  pthread_cond_destroy
-#define cond_wait     pthread_cond_wait
+#define cond_init       pthread_cond_init
+#define cond_signal     pthread_cond_signal
+#define cond_destroy    pthread_cond_destroy
+#define cond_wait       pthread_cond_wait
+#define cond_broadcast  pthread_cond_broadcast
 
 /* Read-Write lock helper shorthand's. */
 #define RWLOCK_INIT     pthread_rwlock_init
@@ -1009,6 +1113,67 @@
     RWLOCK_UNLOCK((rwlock));               \
   )
 
+/* Static initializer for a `fmutex_t`, a zeroed one is unlocked as well. */
+#define FMUTEX_INIT  { 0 }
+
+#define FMUTEX_ACTION(fmutex, ...)  \
+  DO_WHILE(                         \
+    fmutex_lock((fmutex));          \
+    DO_WHILE(__VA_ARGS__);          \
+    fmutex_unlock((fmutex));        \
+  )
+
+#define PRWLOCK_RDLOCK_ACTION(prwlock, ...)  \
+  DO_WHILE(                                  \
+    prwlock_rdlock((prwlock));               \
+    DO_WHILE(__VA_ARGS__);                   \
+    prwlock_rdunlock((prwlock));             \
+  )
+
+#define PRWLOCK_WRLOCK_ACTION(prwlock, ...)  \
+  DO_WHILE(                                  \
+    prwlock_wrlock((prwlock));               \
+    DO_WHILE(__VA_ARGS__);                   \
+    prwlock_wrunlock((prwlock));             \
+  )
+
+/* Run the read in `...` until it saw a consistent state.  Note that the read can run more then once, so it must only copy state out. */
+#define SEQLOCK_READ_ACTION(seqlock, ...)                      \
+  DO_WHILE(                                                    \
+    Uint __seqlock_start;                                      \
+    do {                                                       \
+      __seqlock_start = seqlock_read_begin((seqlock));         \
+      DO_WHILE(__VA_ARGS__);                                   \
+    } while (seqlock_read_retry((seqlock), __seqlock_start));  \
+  )
+
+#define SEQLOCK_WRITE_ACTION(seqlock, ...)  \
+  DO_WHILE(                                 \
+    seqlock_write_lock((seqlock));          \
+    DO_WHILE(__VA_ARGS__);                  \
+    seqlock_write_unlock((seqlock));        \
+  )
+
+/* Static initializers for the fair locks, zeroed ones are unlocked as well. */
+#define TICKETLOCK_INIT  { 0, 0, 0 }
+#define MCSLOCK_INIT     { NULL }
+
+#define TICKETLOCK_ACTION(ticketlock, ...)  \
+  DO_WHILE(                                 \
+    ticketlock_lock((ticketlock));          \
+    DO_WHILE(__VA_ARGS__);                  \
+    ticketlock_unlock((ticketlock));        \
+  )
+
+/* The queue node lives on the stack of the caller for the duration of `...`. */
+#define MCSLOCK_ACTION(mcslock, ...)                \
+  DO_WHILE(                                         \
+    mcs_node_t __mcs_node;                          \
+    mcslock_lock((mcslock), &__mcs_node);           \
+    DO_WHILE(__VA_ARGS__);                          \
+    mcslock_unlock((mcslock), &__mcs_node);         \
+  )
+
 /* ----------------------------- Ptr array's ----------------------------- */
 
 #ifdef ENSURE_PTR_ARRAY_SIZE
@@ -1584,28 +1749,307 @@
 
 /* ----------------------------- log.c ----------------------------- */
 
-#define __fcio_log(type, ...)  fcio_log((type), __LINE__, __func__, __VA_ARGS__)
+/* The log levels, from the least to the most severe. */
+#define FCIO_LOG_INFO_0  (0)  /* Low prio info log. */
+#define FCIO_LOG_INFO_1  (1)  /* Medium prio info log. */
+#define FCIO_LOG_WARN_0  (2)  /* Low prio warning log. */
+#define FCIO_LOG_ERR_NF  (3)  /* Non fatal error. */
+#define FCIO_LOG_ERR_FA  (4)  /* Fatal error, this terminates. */
+
+#define FCIO_LOG_TYPE_FIRST  FCIO_LOG_INFO_0
+#define FCIO_LOG_TYPE_LAST   FCIO_LOG_ERR_FA
+
+/* What a log call does when the async ring is full, see `fcio_log_async_start()`. */
+#define FCIO_LOG_ASYNC_BLOCK  (0)
+#define FCIO_LOG_ASYNC_DROP   (1)
+
+/* The lowest log level that is compiled in, like `FCIO_LOG_WARN_0`.  Define it before including fcio, and every log call
+ * below it compiles to nothing, without ever evaluating its arguments.  Note that `log_ERR_FA()` is never compiled out. */
+#ifndef FCIO_LOG_MIN_LEVEL
+# define FCIO_LOG_MIN_LEVEL  FCIO_LOG_INFO_0
+#endif
+
+/* The module the log calls of a translation unit belong to, below `FCIO_LOG_MODULES`.  Define it before including fcio
+ * to filter the calls of a part of a program on their own, see `fcio_log_set_mask()`. */
+#ifndef FCIO_LOG_MODULE
+# define FCIO_LOG_MODULE  (0)
+#endif
+
+/* The number of modules with their own runtime mask. */
+#define FCIO_LOG_MODULES  (64)
 
-#define log_INFO_0(...)                         \
-  /* Low prio info log. */                      \
-  __fcio_log(0, __VA_ARGS__)
+/* The bit of a log level in the mask of a module. */
+#define FCIO_LOG_MASK(type)  (1U << (type))
+#define FCIO_LOG_MASK_ALL    (0x1FU)
 
-#define log_INFO_1(...)                         \
-  /* Low prio info log. */                      \
-  __fcio_log(1, __VA_ARGS__)
+/* Pass as the module to `fcio_log_set_mask()` and `fcio_log_set_level()` to change every module. */
+#define FCIO_LOG_MODULE_ALL  (-1)
 
-#define log_WARN_0(...)                         \
-  /* Low prio warning log. */                   \
-  __fcio_log(2, __VA_ARGS__)
+/* `TRUE` when log calls of `type` in `module` are enabled at runtime.  This is a single relaxed load, so a disabled
+ * call costs a load and a branch, and never formats anything.  Note that `fcio_log_disabled` holds the levels that are
+ * turned off, so that it starts out all zero, with everything enabled. */
+#define FCIO_LOG_ENABLED(module, type)  \
+  (!(__atomic_load_n(&fcio_log_disabled[(module)], __ATOMIC_RELAXED) & FCIO_LOG_MASK(type)))
 
-#define log_ERR_NF(...)                         \
-  /* Non-Fatal error-log. */                    \
-  __fcio_log(3, __VA_ARGS__)
+#define __fcio_log(type, ...)                                   \
+  (FCIO_LOG_ENABLED(FCIO_LOG_MODULE, (type))                    \
+    ? fcio_log((type), __LINE__, __func__, __VA_ARGS__) : (void)0)
+
+/* A log call below `FCIO_LOG_MIN_LEVEL`.  The call is still type checked against the format, but is never evaluated,
+ * so the compiler drops it completely, arguments and all. */
+#define __fcio_log_discard(type, ...)  \
+  ((void)(0 && (fcio_log((type), __LINE__, __func__, __VA_ARGS__), 0)))
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_INFO_0
+# define log_INFO_0(...)  /* Low prio info log. */  __fcio_log(FCIO_LOG_INFO_0, __VA_ARGS__)
+#else
+# define log_INFO_0(...)  __fcio_log_discard(FCIO_LOG_INFO_0, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_INFO_1
+# define log_INFO_1(...)  /* Medium prio info log. */  __fcio_log(FCIO_LOG_INFO_1, __VA_ARGS__)
+#else
+# define log_INFO_1(...)  __fcio_log_discard(FCIO_LOG_INFO_1, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_WARN_0
+# define log_WARN_0(...)  /* Low prio warning log. */  __fcio_log(FCIO_LOG_WARN_0, __VA_ARGS__)
+#else
+# define log_WARN_0(...)  __fcio_log_discard(FCIO_LOG_WARN_0, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_ERR_NF
+# define log_ERR_NF(...)  /* Non-Fatal error-log. */  __fcio_log(FCIO_LOG_ERR_NF, __VA_ARGS__)
+#else
+# define log_ERR_NF(...)  __fcio_log_discard(FCIO_LOG_ERR_NF, __VA_ARGS__)
+#endif
 
 #define log_ERR_FA(...)                                   \
   /* FATAL error-log.  Note that this will terminate. */  \
   fcio_log_error_fatal(__LINE__, __func__, __VA_ARGS__)
 
+/* ----------------------------- blog.c ----------------------------- */
+
+/* The most arguments a binary log call can take. */
+#define FCIO_BLOG_MAX_ARGS  (16)
+
+/* The argument types a binary log record can hold, as stored in `fcio_blog_site_t.types`. */
+#define FCIO_BLOG_I32   (1)
+#define FCIO_BLOG_U32   (2)
+#define FCIO_BLOG_I64   (3)
+#define FCIO_BLOG_U64   (4)
+#define FCIO_BLOG_F64   (5)
+#define FCIO_BLOG_LDBL  (6)
+#define FCIO_BLOG_STR   (7)
+#define FCIO_BLOG_PTR   (8)
+
+/* The type tag of the argument `x`, as it arrives after the default argument promotions.  `_Generic` is C11, so the
+ * `__extension__` keeps `-std=gnu99 -pedantic` users quiet. */
+#define FCIO_BLOG_TYPE(x)              \
+  __extension__ _Generic((x),          \
+    _Bool:              FCIO_BLOG_I32,  \
+    char:               FCIO_BLOG_I32,  \
+    signed char:        FCIO_BLOG_I32,  \
+    unsigned char:      FCIO_BLOG_I32,  \
+    short:              FCIO_BLOG_I32,  \
+    unsigned short:     FCIO_BLOG_I32,  \
+    int:                FCIO_BLOG_I32,  \
+    unsigned int:       FCIO_BLOG_U32,  \
+    long:               FCIO_BLOG_I64,  \
+    unsigned long:      FCIO_BLOG_U64,  \
+    long long:          FCIO_BLOG_I64,  \
+    unsigned long long: FCIO_BLOG_U64,  \
+    float:              FCIO_BLOG_F64,  \
+    double:             FCIO_BLOG_F64,  \
+    long double:        FCIO_BLOG_LDBL, \
+    char *:             FCIO_BLOG_STR,  \
+    const char *:       FCIO_BLOG_STR,  \
+    default:            FCIO_BLOG_PTR   \
+  )
+
+/* The type tags of all arguments after the format, as an initializer list. */
+#define FCIO_BLOG_TYPES(...)  PP_CAT(FCIO_BLOG_TYPES_, PP_NARG(__VA_ARGS__))(__VA_ARGS__)
+#define FCIO_BLOG_TYPES_1(f)                0
+#define FCIO_BLOG_TYPES_2(f, a)             FCIO_BLOG_TYPE(a)
+#define FCIO_BLOG_TYPES_3(f, a, ...)        FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_2(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_4(f, a, ...)        FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_3(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_5(f, a, ...)        FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_4(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_6(f, a, ...)        FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_5(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_7(f, a, ...)        FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_6(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_8(f, a, ...)        FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_7(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_9(f, a, ...)        FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_8(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_10(f, a, ...)       FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_9(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_11(f, a, ...)       FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_10(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_12(f, a, ...)       FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_11(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_13(f, a, ...)       FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_12(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_14(f, a, ...)       FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_13(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_15(f, a, ...)       FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_14(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_16(f, a, ...)       FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_15(f, __VA_ARGS__)
+#define FCIO_BLOG_TYPES_17(f, a, ...)       FCIO_BLOG_TYPE(a), FCIO_BLOG_TYPES_16(f, __VA_ARGS__)
+
+/* Record a binary log line of `type`.  The format and the argument types are known at compile time, and are put in a
+ * static site, that is listed in the `fcio_blog_sites` section, so `fcio_blog_open()` can write all of them to the log
+ * up front.  So at runtime only the site id, a tsc timestamp and the raw arguments are written, with no formatting. */
+#define FCIO_BLOG(type, ...)                                                                          \
+  DO_WHILE(                                                                                           \
+    static fcio_blog_site_t __blog_site = {                                                           \
+      .format = FCIO_BLOG_FORMAT(__VA_ARGS__),                                                        \
+      .file   = __FILE__,                                                                             \
+      .func   = __func__,                                                                             \
+      .line   = __LINE__,                                                                             \
+      .level  = (type),                                                                               \
+      .nargs  = (PP_NARG(__VA_ARGS__) - 1),                                                           \
+      .types  = { FCIO_BLOG_TYPES(__VA_ARGS__) }                                                      \
+    };                                                                                                \
+    static fcio_blog_site_t *const __blog_site_ptr _SECTION("fcio_blog_sites") _USED = &__blog_site;  \
+    if (FCIO_LOG_ENABLED(FCIO_LOG_MODULE, (type))) {                                                  \
+      fcio_blog_write(&__blog_site, __VA_ARGS__);                                                     \
+    }                                                                                                 \
+  )
+#define FCIO_BLOG_FORMAT(format, ...)  format
+
+/* Like the `log_*()` macros, calls below `FCIO_LOG_MIN_LEVEL` compile to nothing, and leave no site behind. */
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_INFO_0
+# define blog_INFO_0(...)  FCIO_BLOG(FCIO_LOG_INFO_0, __VA_ARGS__)
+#else
+# define blog_INFO_0(...)  __fcio_log_discard(FCIO_LOG_INFO_0, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_INFO_1
+# define blog_INFO_1(...)  FCIO_BLOG(FCIO_LOG_INFO_1, __VA_ARGS__)
+#else
+# define blog_INFO_1(...)  __fcio_log_discard(FCIO_LOG_INFO_1, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_WARN_0
+# define blog_WARN_0(...)  FCIO_BLOG(FCIO_LOG_WARN_0, __VA_ARGS__)
+#else
+# define blog_WARN_0(...)  __fcio_log_discard(FCIO_LOG_WARN_0, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_ERR_NF
+# define blog_ERR_NF(...)  FCIO_BLOG(FCIO_LOG_ERR_NF, __VA_ARGS__)
+#else
+# define blog_ERR_NF(...)  __fcio_log_discard(FCIO_LOG_ERR_NF, __VA_ARGS__)
+#endif
+
+/* ----------------------------- slog.c ----------------------------- */
+
+/* The output format of structured log lines, see `fcio_slog_set_format()`. */
+#define FCIO_SLOG_JSON    (0)
+#define FCIO_SLOG_LOGFMT  (1)
+
+/* The value types a structured log field can hold, as stored in `fcio_slog_field_t.type`. */
+#define FCIO_SLOG_INT     (0)
+#define FCIO_SLOG_UINT    (1)
+#define FCIO_SLOG_DOUBLE  (2)
+#define FCIO_SLOG_STR     (3)
+#define FCIO_SLOG_BOOL    (4)
+
+/* As the length of a string field, means it's nul-terminated, and measured when the line is encoded. */
+#define FCIO_SLOG_STRLEN  (ULONG_MAX)
+
+/* The fields of a structured log call, like `slog_INFO_0("connected", SLOG_STR("host", host), SLOG_INT("port", port))`. */
+#define SLOG_INT(name, value)        ((fcio_slog_field_t){ .key = (name), .type = FCIO_SLOG_INT,    .v.i = (value) })
+#define SLOG_UINT(name, value)       ((fcio_slog_field_t){ .key = (name), .type = FCIO_SLOG_UINT,   .v.u = (value) })
+#define SLOG_DOUBLE(name, value)     ((fcio_slog_field_t){ .key = (name), .type = FCIO_SLOG_DOUBLE, .v.f = (value) })
+#define SLOG_BOOL(name, value)       ((fcio_slog_field_t){ .key = (name), .type = FCIO_SLOG_BOOL,   .v.b = (value) })
+#define SLOG_STR(name, value)        SLOG_STRN(name, value, FCIO_SLOG_STRLEN)
+#define SLOG_STRN(name, value, len)  ((fcio_slog_field_t){ .key = (name), .type = FCIO_SLOG_STR, .v.s = { (value), (len) } })
+
+/* The message always comes first, as the field `msg`.  The trailing empty argument lets a call have no other fields. */
+#define FCIO_SLOG_FIELDS(...)          FCIO_SLOG_FIELDS_I(__VA_ARGS__, )
+#define FCIO_SLOG_FIELDS_I(msg, ...)   SLOG_STR("msg", msg), __VA_ARGS__
+
+#define __fcio_slog(type, ...)                                                                                \
+  (FCIO_LOG_ENABLED(FCIO_LOG_MODULE, (type))                                                                  \
+    ? fcio_slog((type), __LINE__, __func__, (const fcio_slog_field_t[]){ FCIO_SLOG_FIELDS(__VA_ARGS__) },  \
+        PP_NARG(__VA_ARGS__)) : (void)0)
+
+#define __fcio_slog_discard(type, ...)                                                                                \
+  ((void)(0 && (fcio_slog((type), __LINE__, __func__, (const fcio_slog_field_t[]){ FCIO_SLOG_FIELDS(__VA_ARGS__) },  \
+    PP_NARG(__VA_ARGS__)), 0)))
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_INFO_0
+# define slog_INFO_0(...)  __fcio_slog(FCIO_LOG_INFO_0, __VA_ARGS__)
+#else
+# define slog_INFO_0(...)  __fcio_slog_discard(FCIO_LOG_INFO_0, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_INFO_1
+# define slog_INFO_1(...)  __fcio_slog(FCIO_LOG_INFO_1, __VA_ARGS__)
+#else
+# define slog_INFO_1(...)  __fcio_slog_discard(FCIO_LOG_INFO_1, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_WARN_0
+# define slog_WARN_0(...)  __fcio_slog(FCIO_LOG_WARN_0, __VA_ARGS__)
+#else
+# define slog_WARN_0(...)  __fcio_slog_discard(FCIO_LOG_WARN_0, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_ERR_NF
+# define slog_ERR_NF(...)  __fcio_slog(FCIO_LOG_ERR_NF, __VA_ARGS__)
+#else
+# define slog_ERR_NF(...)  __fcio_slog_discard(FCIO_LOG_ERR_NF, __VA_ARGS__)
+#endif
+
+/* ----------------------------- loglimit.c ----------------------------- */
+
+/* A log call of `type` that is sampled and rate limited on its own.  The first `first_n` calls are logged, after which
+ * only one in `one_in` is, or none when `one_in` is zero, and when `per_sec` is not zero, at most `per_sec` a second,
+ * with bursts of up to that many.  All three must be constants.  How many calls were suppressed is reported for every
+ * site once in a while, see `fcio_log_set_limit_interval()`. */
+#define FCIO_LOG_LIMITED(type, first_n, one_in, per_sec, ...)                             \
+  DO_WHILE(                                                                               \
+    static fcio_log_limit_t __log_limit = {                                               \
+      .file     = __FILE__,                                                               \
+      .func     = __func__,                                                               \
+      .line     = __LINE__,                                                               \
+      .level    = (type),                                                                 \
+      .first    = (first_n),                                                              \
+      .every    = (one_in),                                                               \
+      .interval = ((per_sec) ? (1000000000L / (per_sec)) : 0)                             \
+    };                                                                                    \
+    if (FCIO_LOG_ENABLED(FCIO_LOG_MODULE, (type)) && fcio_log_limit(&__log_limit)) {      \
+      fcio_log((type), __LINE__, __func__, __VA_ARGS__);                                  \
+    }                                                                                     \
+  )
+
+/* Like `log_*()`, but `_SAMPLE` logs the first `first_n` calls and then one in `one_in`, and `_RATE` at most `per_sec`
+ * calls a second, see `FCIO_LOG_LIMITED()`. */
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_INFO_0
+# define log_INFO_0_SAMPLE(first_n, one_in, ...)  FCIO_LOG_LIMITED(FCIO_LOG_INFO_0, (first_n), (one_in), 0, __VA_ARGS__)
+# define log_INFO_0_RATE(per_sec, ...)            FCIO_LOG_LIMITED(FCIO_LOG_INFO_0, 0, 1, (per_sec), __VA_ARGS__)
+#else
+# define log_INFO_0_SAMPLE(first_n, one_in, ...)  __fcio_log_discard(FCIO_LOG_INFO_0, __VA_ARGS__)
+# define log_INFO_0_RATE(per_sec, ...)            __fcio_log_discard(FCIO_LOG_INFO_0, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_INFO_1
+# define log_INFO_1_SAMPLE(first_n, one_in, ...)  FCIO_LOG_LIMITED(FCIO_LOG_INFO_1, (first_n), (one_in), 0, __VA_ARGS__)
+# define log_INFO_1_RATE(per_sec, ...)            FCIO_LOG_LIMITED(FCIO_LOG_INFO_1, 0, 1, (per_sec), __VA_ARGS__)
+#else
+# define log_INFO_1_SAMPLE(first_n, one_in, ...)  __fcio_log_discard(FCIO_LOG_INFO_1, __VA_ARGS__)
+# define log_INFO_1_RATE(per_sec, ...)            __fcio_log_discard(FCIO_LOG_INFO_1, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_WARN_0
+# define log_WARN_0_SAMPLE(first_n, one_in, ...)  FCIO_LOG_LIMITED(FCIO_LOG_WARN_0, (first_n), (one_in), 0, __VA_ARGS__)
+# define log_WARN_0_RATE(per_sec, ...)            FCIO_LOG_LIMITED(FCIO_LOG_WARN_0, 0, 1, (per_sec), __VA_ARGS__)
+#else
+# define log_WARN_0_SAMPLE(first_n, one_in, ...)  __fcio_log_discard(FCIO_LOG_WARN_0, __VA_ARGS__)
+# define log_WARN_0_RATE(per_sec, ...)            __fcio_log_discard(FCIO_LOG_WARN_0, __VA_ARGS__)
+#endif
+
+#if FCIO_LOG_MIN_LEVEL <= FCIO_LOG_ERR_NF
+# define log_ERR_NF_SAMPLE(first_n, one_in, ...)  FCIO_LOG_LIMITED(FCIO_LOG_ERR_NF, (first_n), (one_in), 0, __VA_ARGS__)
+# define log_ERR_NF_RATE(per_sec, ...)            FCIO_LOG_LIMITED(FCIO_LOG_ERR_NF, 0, 1, (per_sec), __VA_ARGS__)
+#else
+# define log_ERR_NF_SAMPLE(first_n, one_in, ...)  __fcio_log_discard(FCIO_LOG_ERR_NF, __VA_ARGS__)
+# define log_ERR_NF_RATE(per_sec, ...)            __fcio_log_discard(FCIO_LOG_ERR_NF, __VA_ARGS__)
+#endif
+
 
 /* ----------------------------- hashmap.c ----------------------------- */
 
@@ -1674,11 +2118,230 @@ typedef struct {
 
 typedef struct atomicbool  atomicbool;
 
+/* ----------------------------- atomics.c ----------------------------- */
+
+/* Typed atomics, see the `aflag_*()`, `acounter_*()` and `aptr_*()` helpers in `statics.h`.  Zero initialized is valid for all of them. */
+typedef struct {
+  Uint value;
+} aflag_t;
+
+typedef struct {
+  Ulong value;
+} acounter_t;
+
+typedef struct {
+  void *value;
+} aptr_t;
+
+/* One-shot event, see `event_wait()`.  Zero initialized is unset. */
+typedef struct {
+  Uint state;
+} event_t;
+
+/* Countdown latch, see `latch_init()`. */
+typedef struct {
+  Uint count;
+  Uint waiters;
+} latch_t;
+
+/* Reusable thread barrier, see `barrier_init()`. */
+typedef struct {
+  Uint count;
+  Uint remaining;
+  Uint generation;
+} barrier_t;
+
 /* ----------------------------- queue.c ----------------------------- */
 
 // typedef struct Queue  Queue;
 typedef struct QUEUE_T *  QUEUE;
 
+/* ----------------------------- statics.h ----------------------------- */
+
+/* A futex word that threads can park on.  The low bit is set while there are parked threads, and the rest is
+ * bumped on every wake.  This way a notifier only pays for the wake syscall once per round of parked threads,
+ * and not on every notify while they are still waking up.  Use the `parking_*()` helpers. */
+typedef struct {
+  Uint state;
+} parking_t;
+
+/* ----------------------------- spsc.c ----------------------------- */
+
+typedef struct SPSC_T *SPSC;
+
+/* ----------------------------- mpmc.c ----------------------------- */
+
+typedef struct MPMC_T *MPMC;
+
+/* ----------------------------- thread_pool.c ----------------------------- */
+
+typedef struct THREAD_POOL_T *THREAD_POOL;
+
+/* A set of forked tasks that are joined together, see `task_group_spawn()` and `task_group_sync()`. */
+typedef struct {
+  THREAD_POOL pool;
+  Ulong pending;
+} task_group_t;
+
+/* ----------------------------- wsdeque.c ----------------------------- */
+
+typedef struct WSDEQUE_T *WSDEQUE;
+
+/* ----------------------------- pqueue.c ----------------------------- */
+
+typedef struct PQUEUE_T         *PQUEUE;
+typedef struct PQUEUE_HANDLE_T  *PQUEUE_HANDLE;
+
+/* ----------------------------- timer_wheel.c ----------------------------- */
+
+typedef void (*TIMER_CB)(void *arg);
+typedef struct TIMER_WHEEL_T  *TIMER_WHEEL;
+typedef struct TIMER_T        *TIMER;
+
+/* ----------------------------- topology.c ----------------------------- */
+
+typedef struct {
+  int id;       /* The cpu number, as used for affinity. */
+  int core;     /* The physical core within `package`. */
+  int package;  /* The socket. */
+  int node;     /* The numa node. */
+  int smt;      /* The index of this hardware thread within its core. */
+} cpu_topology_t;
+
+/* ----------------------------- fiber.c ----------------------------- */
+
+typedef struct FIBER_SCHED_T  *FIBER_SCHED;
+typedef struct FIBER_CHAN_T   *FIBER_CHAN;
+
+/* ----------------------------- fmutex.c ----------------------------- */
+
+/* Futex backed adaptive mutex, see `fmutex_lock()`.  Note that it's only ever a single word. */
+typedef struct {
+  Uint state;
+} fmutex_t;
+
+/* ----------------------------- rwlock.c ----------------------------- */
+
+typedef struct PRWLOCK_T *PRWLOCK;
+
+/* A sequence lock, see `seqlock_read_begin()`.  Zero initialized is valid. */
+typedef struct {
+  Uint seq;
+  fmutex_t lock;
+} seqlock_t;
+
+/* ----------------------------- fairlock.c ----------------------------- */
+
+/* Fifo ticket lock, see `ticketlock_lock()`. */
+typedef struct {
+  Uint next;    /* The next ticket to hand out. */
+  Uint owner;   /* The ticket being served. */
+  Uint parked;  /* The number of waiters parked on `owner`. */
+} ticketlock_t;
+
+/* The queue node of a thread waiting for, or holding, a `mcslock_t`.  Aligned so every waiter spins on its own cache line. */
+typedef struct mcs_node_t {
+  struct mcs_node_t *next;
+  Uint locked;
+} _ALIGNED(_CACHELINE_SIZE) mcs_node_t;
+
+/* Fifo queue lock, see `mcslock_lock()`. */
+typedef struct {
+  mcs_node_t *tail;
+} mcslock_t;
+
+/* ----------------------------- lockprof.c ----------------------------- */
+
+/* The counters of one profiled lock call-site, see `LOCKPROF_MUTEX_ACTION()`.  All times are in tsc cycles. */
+typedef struct lockprof_site_t {
+  const char *name;
+  const char *file;
+  int line;
+  Uint registered;
+  Ulong acquisitions;
+  Ulong contended;
+  Ulong wait_cycles;
+  Ulong wait_max;
+  Ulong hold_cycles;
+  Ulong hold_max;
+  Ulong hold_hist[LOCKPROF_HIST_BUCKETS];  /* Bucket `i` counts holds of `[2^i, 2^(i+1))` cycles. */
+  struct lockprof_site_t *next;
+} lockprof_site_t;
+
+/* ----------------------------- ticker.c ----------------------------- */
+
+/* Fixed rate ticker, see `ticker_wait()`.  The statistics can be read directly. */
+typedef struct {
+  Llong period;      /* The period in nanoseconds. */
+  Llong next;        /* The next deadline, in `hiactime_now_ns()` time, like every time of a ticker. */
+  int policy;        /* `TICKER_CATCH_UP` or `TICKER_SKIP`. */
+  Ulong ticks;       /* The number of deadlines that fired. */
+  Ulong overruns;    /* The number of times the caller arrived after the deadline was already past. */
+  Ulong skipped;     /* The number of deadlines dropped by `TICKER_SKIP`. */
+  Llong jitter_sum;  /* The total time woken up after the deadline. */
+  Llong jitter_max;
+} ticker_t;
+
+/* Token bucket rate limiter, see `token_bucket_take()`. */
+typedef struct {
+  double rate;    /* Tokens per nanosecond. */
+  double burst;   /* The most tokens that can be saved up. */
+  double tokens;  /* Can go negative, when takers have reserved tokens ahead of time. */
+  Llong last;     /* When `tokens` was last refilled, in `hiactime_now_ns()` time. */
+  fmutex_t lock;
+} token_bucket_t;
+
+/* ----------------------------- blog.c ----------------------------- */
+
+/* The static description of one binary log call-site, see `FCIO_BLOG()`. */
+typedef struct {
+  const char *format;
+  const char *file;
+  const char *func;
+  int line;
+  int level;
+  Uint id;     /* Assigned by `fcio_blog_open()`. */
+  Uchar nargs;
+  Uchar types[FCIO_BLOG_MAX_ARGS];
+} fcio_blog_site_t;
+
+/* ----------------------------- slog.c ----------------------------- */
+
+/* One key/value field of a structured log line, made with the `SLOG_*()` macros. */
+typedef struct {
+  const char *key;
+  int type;
+  union {
+    Llong i;
+    Ulong u;
+    double f;
+    bool b;
+    struct {
+      const char *data;
+      Ulong len;  /* Or `FCIO_SLOG_STRLEN` when `data` is nul-terminated. */
+    } s;
+  } v;
+} fcio_slog_field_t;
+
+/* ----------------------------- loglimit.c ----------------------------- */
+
+/* The limits and counters of one rate limited log call-site, see `FCIO_LOG_LIMITED()`. */
+typedef struct fcio_log_limit_t {
+  const char *file;
+  const char *func;
+  int line;
+  int level;
+  Ulong first;       /* The number of calls always logged. */
+  Ulong every;       /* After those, one in this many is logged, or none when zero. */
+  Llong interval;    /* The nanoseconds each logged call costs out of a one second burst, or zero for no rate limit. */
+  Llong tat;         /* When the rate limit would be back to a full burst, in `fcio_now_ns()` time. */
+  Ulong calls;
+  Ulong suppressed;
+  Ulong reported;    /* How much of `suppressed` has been reported. */
+  Uint registered;
+  struct fcio_log_limit_t *next;
+} fcio_log_limit_t;
+
 /* ----------------------------- simple_mutually_exclusive_execution.c ----------------------------- */
 
 typedef struct SMUTEX_T *SMUTEX;
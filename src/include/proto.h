@@ -74,6 +74,9 @@ void test_directory_t(const char *const dirpath);
 void *xmalloc(Ulong howmush) __THROW _NODISCARD _RETURNS_NONNULL;
 void *xrealloc(void *ptr, Ulong newsize) __THROW _NODISCARD _RETURNS_NONNULL _NONNULL(1);
 void *xcalloc(Ulong elems, Ulong elemsize) __THROW _NODISCARD _RETURNS_NONNULL;
+#if !__WIN__
+void *xmalloc_aligned(Ulong align, Ulong howmush) __THROW _NODISCARD _RETURNS_NONNULL;
+#endif
 
 
 /* ---------------------------------------------------------- str.c ---------------------------------------------------------- */
@@ -345,8 +348,19 @@ bool isconeof(const char c, const char *const restrict string) __THROW _NODISCAR
 
 void future_free(Future *future);
 void *future_get(Future *future);
+bool future_get_timed(Future *future, Llong deadline_ns, void **const result);
 bool future_try_get(Future *future, void **result);
+bool future_cancel(Future *future);
+bool future_cancel_requested(void);
+Future *future_submit_to(THREAD_POOL pool, void *(*task)(void *), void *arg);
+Future *future_submit_to_node(THREAD_POOL pool, int node, void *(*task)(void *), void *arg);
 Future *future_submit(void *(*task)(void *), void *arg);
+void future_set_thread_per_task(bool use);
+/* ----------------------------- Combinator's ----------------------------- */
+Future *future_ready(void *result);
+Future *future_then(Future *future, void *(*func)(void *result, void *arg), void *arg);
+Future *future_when_all(Future **futures, Ulong n);
+Future *future_when_any(Future **futures, Ulong n);
 
 
 
@@ -383,15 +397,53 @@ void atomicbool_set_true(atomicbool *ab);
 void atomicbool_set_false(atomicbool *ab);
 
 
+/* ---------------------------------------------------------- atomics.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+/* ----------------------------- Wait/notify ----------------------------- */
+
+bool atomic_wait(Uint *const addr, Uint old, Llong timeout_ns);
+void atomic_notify_one(Uint *const addr);
+void atomic_notify_all(Uint *const addr);
+
+/* ----------------------------- Event ----------------------------- */
+
+void event_init(event_t *const e);
+void event_set(event_t *const e);
+void event_reset(event_t *const e);
+bool event_is_set(event_t *const e);
+bool event_wait(event_t *const e, Llong timeout_ns);
+
+/* ----------------------------- Latch ----------------------------- */
+
+void latch_init(latch_t *const l, Uint count);
+void latch_count_down(latch_t *const l, Uint n);
+bool latch_try_wait(latch_t *const l);
+bool latch_wait(latch_t *const l, Llong timeout_ns);
+
+/* ----------------------------- Barrier ----------------------------- */
+
+void barrier_init(barrier_t *const b, Uint count);
+bool barrier_wait(barrier_t *const b);
+#endif
+
+
 /* ---------------------------------------------------------- queue.c ---------------------------------------------------------- */
 
 
 QUEUE queue_create(void);
+QUEUE queue_create_fixed(Ulong cap);
 void  queue_free(QUEUE q);
 void  queue_set_free_func(QUEUE q, void (*free_func)(void *));
 Ulong queue_size(QUEUE q);
+Ulong queue_cap(QUEUE q);
+bool  queue_is_full(QUEUE q);
 void  queue_pop(QUEUE q);
 void  queue_push(QUEUE q, void *data);
+bool  queue_try_push(QUEUE q, void *data);
+Ulong queue_push_many(QUEUE q, void *const *const data, Ulong n);
+Ulong queue_pop_many(QUEUE q, void **const out, Ulong n);
 void *queue_front(QUEUE q);
 
 // Queue *queue_create(void);
@@ -403,6 +455,179 @@ void *queue_front(QUEUE q);
 // Ulong queue_size(Queue *q);
 
 
+/* ---------------------------------------------------------- spsc.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+SPSC  spsc_create(Ulong cap);
+void  spsc_free(SPSC q);
+void  spsc_set_free_func(SPSC q, void (*free_func)(void *));
+Ulong spsc_size(SPSC q);
+Ulong spsc_cap(SPSC q);
+/* ----------------------------- Producer ----------------------------- */
+Ulong spsc_push_many(SPSC q, void *const *const data, Ulong n);
+bool  spsc_try_push(SPSC q, void *data);
+void  spsc_push(SPSC q, void *data);
+/* ----------------------------- Consumer ----------------------------- */
+Ulong spsc_pop_many(SPSC q, void **const out, Ulong n);
+bool  spsc_try_pop(SPSC q, void **const out);
+Ulong spsc_pop_many_wait(SPSC q, void **const out, Ulong n);
+void *spsc_pop(SPSC q);
+#endif
+
+
+/* ---------------------------------------------------------- mpmc.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+MPMC  mpmc_create(Ulong cap);
+void  mpmc_free(MPMC q);
+void  mpmc_set_free_func(MPMC q, void (*free_func)(void *));
+Ulong mpmc_cap(MPMC q);
+Ulong mpmc_size(MPMC q);
+/* ----------------------------- Push ----------------------------- */
+bool  mpmc_try_push(MPMC q, void *data);
+void  mpmc_push(MPMC q, void *data);
+Ulong mpmc_try_push_many(MPMC q, void *const *const data, Ulong n);
+void  mpmc_push_many(MPMC q, void *const *const data, Ulong n);
+/* ----------------------------- Pop ----------------------------- */
+bool  mpmc_try_pop(MPMC q, void **const out);
+void *mpmc_pop(MPMC q);
+Ulong mpmc_try_pop_many(MPMC q, void **const out, Ulong n);
+Ulong mpmc_pop_many(MPMC q, void **const out, Ulong n);
+#endif
+
+
+/* ---------------------------------------------------------- thread_pool.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+Ulong       thread_pool_online_cpus(void);
+THREAD_POOL thread_pool_create(Ulong nthreads);
+THREAD_POOL thread_pool_create_pinned(Ulong nthreads);
+void        thread_pool_free(THREAD_POOL pool);
+Ulong       thread_pool_nthreads(THREAD_POOL pool);
+void        thread_pool_submit(THREAD_POOL pool, void (*func)(void *), void *arg);
+void        thread_pool_submit_node(THREAD_POOL pool, int node, void (*func)(void *), void *arg);
+int         thread_pool_current_node(void);
+bool        thread_pool_help(void);
+bool        thread_pool_default_set_nthreads(Ulong nthreads);
+bool        thread_pool_default_set_pinned(bool pinned);
+THREAD_POOL thread_pool_default(void);
+/* ----------------------------- Task group ----------------------------- */
+void task_group_init(task_group_t *const group, THREAD_POOL pool);
+void task_group_spawn(task_group_t *const group, void (*func)(void *), void *arg);
+void task_group_sync(task_group_t *const group);
+#endif
+
+
+/* ---------------------------------------------------------- topology.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+/* ----------------------------- Topology ----------------------------- */
+
+Ulong                 cpu_topology_count(void);
+const cpu_topology_t *cpu_topology_get(Ulong idx);
+Ulong                 numa_node_count(void);
+int                   numa_node_of_cpu(int cpu);
+int                   numa_current_node(void);
+
+/* ----------------------------- Placement ----------------------------- */
+
+bool thread_pin_to_cpu(thread_t thread, int cpu);
+bool thread_pin_to_node(thread_t thread, int node);
+#endif
+
+
+/* ---------------------------------------------------------- fiber.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+/* ----------------------------- Scheduler ----------------------------- */
+
+FIBER_SCHED fiber_sched_create(Ulong stack_size);
+void        fiber_sched_free(FIBER_SCHED sched);
+void        fiber_sched_run(FIBER_SCHED sched);
+void        fiber_spawn(FIBER_SCHED sched, void (*func)(void *), void *arg);
+void        fiber_sched_post(FIBER_SCHED sched, void (*func)(void *), void *arg);
+
+/* ----------------------------- Fiber ----------------------------- */
+
+bool fiber_in_fiber(void);
+void fiber_yield(void);
+void fiber_sleep_until(Llong deadline_ns);
+void fiber_sleep_ns(Llong ns);
+Uint fiber_wait_fd(int fd, Uint events, Llong timeout_ns);
+
+/* ----------------------------- Channel ----------------------------- */
+
+FIBER_CHAN fiber_chan_create(Ulong cap);
+void       fiber_chan_free(FIBER_CHAN ch);
+bool       fiber_chan_send(FIBER_CHAN ch, void *value);
+bool       fiber_chan_recv(FIBER_CHAN ch, void **const out);
+void       fiber_chan_close(FIBER_CHAN ch);
+#endif
+
+
+/* ---------------------------------------------------------- parallel.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+void  fcio_parallel_for(Ulong begin, Ulong end, Ulong grain, void (*func)(Ulong begin, Ulong end, void *ctx), void *ctx);
+void *fcio_parallel_reduce(Ulong begin, Ulong end, Ulong grain, void *(*map)(Ulong begin, Ulong end, void *ctx), void *(*combine)(void *a, void *b, void *ctx), void *ctx);
+void  fcio_parallel_for_new_cvec(CVEC cv, Ulong grain, void (*func)(void *item, void *ctx), void *ctx);
+void  fcio_parallel_for_cvec(CVec *const v, Ulong grain, void (*func)(void *item, void *ctx), void *ctx);
+void  fcio_parallel_for_directory(directory_t *const dir, Ulong grain, void (*func)(directory_entry_t *entry, void *ctx), void *ctx);
+#endif
+
+
+/* ---------------------------------------------------------- wsdeque.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+WSDEQUE wsdeque_create(Ulong cap);
+void    wsdeque_free(WSDEQUE dq);
+Ulong   wsdeque_size(WSDEQUE dq);
+void    wsdeque_push(WSDEQUE dq, void *data);
+bool    wsdeque_pop(WSDEQUE dq, void **const out);
+bool    wsdeque_steal(WSDEQUE dq, void **const out);
+#endif
+
+
+/* ---------------------------------------------------------- pqueue.c ---------------------------------------------------------- */
+
+
+PQUEUE        pqueue_create(void);
+void          pqueue_free(PQUEUE pq);
+void          pqueue_set_free_func(PQUEUE pq, void (*free_func)(void *));
+Ulong         pqueue_size(PQUEUE pq);
+PQUEUE_HANDLE pqueue_push(PQUEUE pq, Llong key, void *data);
+void         *pqueue_peek(PQUEUE pq, Llong *const key);
+void         *pqueue_pop(PQUEUE pq, Llong *const key);
+bool          pqueue_pop_if_le(PQUEUE pq, Llong limit, void **const data);
+void          pqueue_decrease_key(PQUEUE pq, PQUEUE_HANDLE h, Llong key);
+void          pqueue_update_key(PQUEUE pq, PQUEUE_HANDLE h, Llong key);
+void         *pqueue_remove(PQUEUE pq, PQUEUE_HANDLE h);
+Llong         pqueue_handle_key(PQUEUE_HANDLE h);
+
+
+/* ---------------------------------------------------------- timer_wheel.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+TIMER_WHEEL timer_wheel_create(Llong tick_ns);
+void        timer_wheel_free(TIMER_WHEEL tw);
+Ulong       timer_wheel_size(TIMER_WHEEL tw);
+TIMER       timer_wheel_add_at(TIMER_WHEEL tw, Llong deadline_ns, TIMER_CB callback, void *arg);
+TIMER       timer_wheel_add(TIMER_WHEEL tw, Llong timeout_ns, TIMER_CB callback, void *arg);
+void        timer_wheel_cancel(TIMER_WHEEL tw, TIMER t);
+Ulong       timer_wheel_advance_to(TIMER_WHEEL tw, Llong now_ns);
+Ulong       timer_wheel_advance(TIMER_WHEEL tw);
+Llong       timer_wheel_next_ns(TIMER_WHEEL tw);
+#endif
+
+
 /* ---------------------------------------------------------- blkdev.c ---------------------------------------------------------- */
 
 
@@ -415,28 +640,188 @@ bool blkdev_exists(const char *const restrict path);
 int digits(long n);
 
 
+/* ---------------------------------------------------------- blog.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+void fcio_blog_open(const char *const restrict path) _NONNULL(1);
+void fcio_blog_write(fcio_blog_site_t *const site, const char *const restrict format, ...) _NONNULL(1, 2) _PRINTFLIKE(2, 3);
+void fcio_blog_flush(void);
+void fcio_blog_close(void);
+long fcio_blog_decode(const char *const restrict path, int out_fd) _NONNULL(1);
+#endif
+
+
+/* ---------------------------------------------------------- slog.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+void fcio_slog(int type, Ulong lineno, const char *const restrict function, const fcio_slog_field_t *const fields, Ulong nfields) _NONNULL(3, 4);
+void fcio_slog_set_format(int format);
+#endif
+
+
+/* ---------------------------------------------------------- loglimit.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+bool fcio_log_limit(fcio_log_limit_t *const site) _NONNULL(1);
+void fcio_log_limit_report(void);
+void fcio_log_limit_poll(void);
+void fcio_log_set_limit_interval(Llong interval_ns);
+#endif
+
+
+/* ---------------------------------------------------------- clock.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+Ulong  fcio_cycles(void);
+Llong  fcio_now_ns(void);
+double fcio_cycles_to_ns(Ulong cycles);
+bool   fcio_clock_is_tsc(void);
+#endif
+
+
 /* ---------------------------------------------------------- hiactime.c ---------------------------------------------------------- */
 
 
 #if !__WIN__
+/* ----------------------------- Hiactime sleep until ns ----------------------------- */
+void  hiactime_sleep_until_ns(Llong deadline);
+Llong hiactime_spin_threshold_ns(void);
 /* ----------------------------- Hiactime sleep total duration ----------------------------- */
 void hiactime_sleep_total_duration(const struct timespec *const s, struct timespec *const e, Llong nanoseconds);
 /* ----------------------------- Hiactime nsleep ----------------------------- */
 void hiactime_nsleep(Llong nanoseconds);
 /* ----------------------------- Hiactime nsleep ----------------------------- */
 void hiactime_msleep(double milliseconds);
+/* ----------------------------- Hiactime now ns ----------------------------- */
+Llong hiactime_now_ns(void);
 #endif
 
 
 /* ---------------------------------------------------------- log.c ---------------------------------------------------------- */
 
 
+extern Uchar fcio_log_disabled[FCIO_LOG_MODULES];
+
 /* ----------------------------- Fcio log set file ----------------------------- */
 void fcio_log_set_file(const char *const restrict path) _NONNULL(1);
 /* ----------------------------- Fcio log ----------------------------- */
 void fcio_log(int type, Ulong lineno, const char *const restrict function, const char *const restrict format, ...) _PRINTFLIKE(4, 5);
+/* ----------------------------- Fcio log write ----------------------------- */
+void fcio_log_write(int type, const char *const restrict data, Ulong len) _NONNULL(2);
+/* ----------------------------- Fcio log tag ----------------------------- */
+const char *fcio_log_tag(int type) _RETURNS_NONNULL;
 /* ----------------------------- Fcio log error fatal ----------------------------- */
 void fcio_log_error_fatal(Ulong lineno, const char *const restrict function, const char *const restrict format, ...) _NO_RETURN _PRINTFLIKE(3, 4);
+/* ----------------------------- Fcio log set rotation ----------------------------- */
+void fcio_log_set_rotation(Ulong max_size, Llong max_age_ns, Uint keep, bool compress);
+/* ----------------------------- Fcio log set fsync ----------------------------- */
+void fcio_log_set_fsync(Ulong bytes, Llong interval_ns);
+/* ----------------------------- Fcio log rotate ----------------------------- */
+void fcio_log_rotate(void);
+/* ----------------------------- Fcio log set mask ----------------------------- */
+void fcio_log_set_mask(int module, Uint mask);
+/* ----------------------------- Fcio log set level ----------------------------- */
+void fcio_log_set_level(int module, int type);
+/* ----------------------------- Fcio log get mask ----------------------------- */
+Uint fcio_log_get_mask(int module);
+/* ----------------------------- Fcio log async start ----------------------------- */
+void fcio_log_async_start(Ulong capacity, int policy, Llong flush_ns);
+/* ----------------------------- Fcio log async stop ----------------------------- */
+void fcio_log_async_stop(void);
+/* ----------------------------- Fcio log flush ----------------------------- */
+void fcio_log_flush(void);
+/* ----------------------------- Fcio log async dropped ----------------------------- */
+Ulong fcio_log_async_dropped(void);
+
+
+/* ---------------------------------------------------------- fmutex.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+void fmutex_init(fmutex_t *const m);
+void fmutex_lock(fmutex_t *const m);
+bool fmutex_trylock(fmutex_t *const m);
+void fmutex_unlock(fmutex_t *const m);
+#endif
+
+
+/* ---------------------------------------------------------- rwlock.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+/* ----------------------------- PRWLOCK ----------------------------- */
+
+PRWLOCK prwlock_create(void);
+void    prwlock_free(PRWLOCK l);
+void    prwlock_rdlock(PRWLOCK l);
+void    prwlock_rdunlock(PRWLOCK l);
+void    prwlock_wrlock(PRWLOCK l);
+void    prwlock_wrunlock(PRWLOCK l);
+
+/* ----------------------------- Seqlock ----------------------------- */
+
+void seqlock_init(seqlock_t *const sl);
+Uint seqlock_read_begin(const seqlock_t *const sl);
+bool seqlock_read_retry(const seqlock_t *const sl, Uint start);
+void seqlock_write_lock(seqlock_t *const sl);
+void seqlock_write_unlock(seqlock_t *const sl);
+#endif
+
+
+/* ---------------------------------------------------------- fairlock.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+/* ----------------------------- Ticket lock ----------------------------- */
+
+void ticketlock_init(ticketlock_t *const l);
+void ticketlock_lock(ticketlock_t *const l);
+bool ticketlock_trylock(ticketlock_t *const l);
+void ticketlock_unlock(ticketlock_t *const l);
+
+/* ----------------------------- MCS lock ----------------------------- */
+
+void mcslock_init(mcslock_t *const l);
+void mcslock_lock(mcslock_t *const l, mcs_node_t *const node);
+bool mcslock_trylock(mcslock_t *const l, mcs_node_t *const node);
+void mcslock_unlock(mcslock_t *const l, mcs_node_t *const node);
+#endif
+
+
+/* ---------------------------------------------------------- lockprof.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+Ulong lockprof_cycles(void);
+Ulong lockprof_acquired(lockprof_site_t *const site, Ulong start, bool contended);
+void  lockprof_released(lockprof_site_t *const site, Ulong acquired);
+void  lockprof_dump(void);
+void  lockprof_reset(void);
+#endif
+
+
+/* ---------------------------------------------------------- ticker.c ---------------------------------------------------------- */
+
+
+#if !__WIN__
+/* ----------------------------- Ticker ----------------------------- */
+
+void   ticker_init(ticker_t *const t, Llong period, int policy);
+void   ticker_reset(ticker_t *const t);
+Ulong  ticker_wait(ticker_t *const t);
+double ticker_jitter_avg_ns(const ticker_t *const t);
+
+/* ----------------------------- Token bucket ----------------------------- */
+
+void  token_bucket_init(token_bucket_t *const tb, double rate, double burst);
+bool  token_bucket_try_take(token_bucket_t *const tb, double n);
+void  token_bucket_take(token_bucket_t *const tb, double n);
+Llong token_bucket_wait_ns(token_bucket_t *const tb, double n);
+#endif
 
 
 /* ---------------------------------------------------------- simple_mutually_exclusive_execution.c ---------------------------------------------------------- */
@@ -452,6 +837,7 @@ void   smutex_unlock(SMUTEX sm);
 
 FILE_LISTENER file_listener_create(void);
 void file_listener_kill(FILE_LISTENER fl);
+bool file_listener_pin_to_node(FILE_LISTENER fl, int node);
 void file_listener_add_file(FILE_LISTENER fl,
   const char *const restrict file, FILE_LISTENER_CB cb, void *data, Uint mask);
 void file_listener_rm_file(FILE_LISTENER fl, const char *const restrict file);
@@ -51,6 +51,150 @@ static inline bool has_inveriant_tsc(void) {
 }
 
 
+/* ---------------------------------------------------------- Futex function's ---------------------------------------------------------- */
+
+
+#if !__WIN__
+
+/* ----------------------------- Futex wait ----------------------------- */
+
+/* Park the calling thread for as long as `*addr` holds `expected`, or until `timeout` (relative) expires when
+ * not `NULL`.  Note that this can return spuriously, so the caller must always re-check its condition. */
+static inline long futex_wait(Uint *const addr, Uint expected, const struct timespec *const timeout) {
+  ASSERT(addr);
+  return syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, timeout, NULL, 0);
+}
+
+/* ----------------------------- Futex wake ----------------------------- */
+
+/* Wake at most `count` threads parked on `addr`.  Return's the number of woken threads. */
+static inline long futex_wake(Uint *const addr, int count) {
+  ASSERT(addr);
+  return syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+/* ----------------------------- Parking ----------------------------- */
+
+/* Register as a waiter on `p`, and return the value to pass to `parking_wait()`.  After this the caller must re-check
+ * its condition, and only call `parking_wait()` when it still does not hold.  The registration is a full barrier, and
+ * pairs with the fence in `parking_notify()`, so either the notifier sees the waiter, or the waiter sees the state the
+ * notifier published. */
+static inline Uint parking_prepare(parking_t *const p) {
+  ASSERT(p);
+  return (__atomic_fetch_or(&p->state, 1, __ATOMIC_SEQ_CST) | 1);
+}
+
+/* Park on `p` until notified, unless it was already notified after `parking_prepare()` returned `expected`. */
+static inline void parking_wait(parking_t *const p, Uint expected, const struct timespec *const timeout) {
+  ASSERT(p);
+  futex_wait(&p->state, expected, timeout);
+}
+
+/* Wake all threads parked on `p`, after publishing the state they wait for.  This is one fence and one load when
+ * there are no waiters.  Woken threads that find their condition still false simply register and park again. */
+static inline void parking_notify(parking_t *const p) {
+  ASSERT(p);
+  Uint state;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  state = __atomic_load_n(&p->state, __ATOMIC_RELAXED);
+  /* Clear the waiter bit and bump the rest, if another notifier beat us to it, they will do the wake. */
+  if ((state & 1) && __atomic_compare_exchange_n(&p->state, &state, (state + 1), FALSE, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    futex_wake(&p->state, INT_MAX);
+  }
+}
+
+#endif
+
+
+/* ---------------------------------------------------------- Atomic function's ---------------------------------------------------------- */
+
+
+/* ----------------------------- Flag ----------------------------- */
+
+/* Return's the flag, with acquire order, so everything published before the matching `aflag_set()` is visible. */
+static inline bool aflag_get(aflag_t *const f) {
+  return __atomic_load_n(&f->value, __ATOMIC_ACQUIRE);
+}
+
+/* Return's the flag without any ordering, for polling a stop flag or similar in a hot loop. */
+static inline bool aflag_get_relaxed(aflag_t *const f) {
+  return __atomic_load_n(&f->value, __ATOMIC_RELAXED);
+}
+
+static inline void aflag_set(aflag_t *const f) {
+  __atomic_store_n(&f->value, TRUE, __ATOMIC_RELEASE);
+}
+
+static inline void aflag_clear(aflag_t *const f) {
+  __atomic_store_n(&f->value, FALSE, __ATOMIC_RELEASE);
+}
+
+/* Set the flag, and return what it was before. */
+static inline bool aflag_test_and_set(aflag_t *const f) {
+  return __atomic_exchange_n(&f->value, TRUE, __ATOMIC_ACQ_REL);
+}
+
+#if !__WIN__
+/* Block while the flag is `old`, see `atomic_wait()`.  The flag has to be changed with `aflag_set_notify()` or
+ * `aflag_clear_notify()` for this to ever wake up. */
+static inline bool aflag_wait(aflag_t *const f, bool old, Llong timeout_ns) {
+  return atomic_wait(&f->value, old, timeout_ns);
+}
+
+static inline void aflag_set_notify(aflag_t *const f) {
+  aflag_set(f);
+  atomic_notify_all(&f->value);
+}
+
+static inline void aflag_clear_notify(aflag_t *const f) {
+  aflag_clear(f);
+  atomic_notify_all(&f->value);
+}
+#endif
+
+/* ----------------------------- Counter ----------------------------- */
+
+/* Return's the counter without any ordering, it's meant for statistics and the like. */
+static inline Ulong acounter_get(acounter_t *const c) {
+  return __atomic_load_n(&c->value, __ATOMIC_RELAXED);
+}
+
+static inline void acounter_set(acounter_t *const c, Ulong value) {
+  __atomic_store_n(&c->value, value, __ATOMIC_RELAXED);
+}
+
+/* Add `n` to the counter, and return the new value.  Only the counter itself is atomic, nothing around it is ordered. */
+static inline Ulong acounter_add(acounter_t *const c, Ulong n) {
+  return __atomic_add_fetch(&c->value, n, __ATOMIC_RELAXED);
+}
+
+/* Subtract `n` from the counter, and return the new value.  This is acquire-release, so when used as a reference
+ * count, the thread that takes it to zero sees every write the other holders made before their release. */
+static inline Ulong acounter_sub(acounter_t *const c, Ulong n) {
+  return __atomic_sub_fetch(&c->value, n, __ATOMIC_ACQ_REL);
+}
+
+/* ----------------------------- Pointer ----------------------------- */
+
+static inline void *aptr_load(aptr_t *const p) {
+  return __atomic_load_n(&p->value, __ATOMIC_ACQUIRE);
+}
+
+/* Publish `value`, so everything written to it before is visible to whoever loads it with `aptr_load()`. */
+static inline void aptr_store(aptr_t *const p, void *value) {
+  __atomic_store_n(&p->value, value, __ATOMIC_RELEASE);
+}
+
+static inline void *aptr_exchange(aptr_t *const p, void *value) {
+  return __atomic_exchange_n(&p->value, value, __ATOMIC_ACQ_REL);
+}
+
+/* Replace the pointer with `value` only when it's `*expected`.  On failure `*expected` is updated to the current value. */
+static inline bool aptr_cas(aptr_t *const p, void **const expected, void *value) {
+  return __atomic_compare_exchange_n(&p->value, expected, value, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+
 /* ---------------------------------------------------------- Math function's ---------------------------------------------------------- */
 
 
@@ -0,0 +1,123 @@
+/** @file blog_test.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Round trip of the binary log.  Every line is written with `FCIO_BLOG()`, decoded again with `fcio_blog_decode()`,
+  and compared with what `snprintf()` makes of the same format and arguments.  The cases cover integers of every
+  width and length modifier, strings, `*` widths and precisions, `%%` and doubles.
+
+ */
+#include <fcio/proto.h>
+
+
+#define TEST_PATH      "/tmp/fcio_blog_test.blog"
+#define TEST_OUT_PATH  "/tmp/fcio_blog_test.txt"
+
+#define TEST_MAX   (64)
+#define TEST_LINE  (512)
+
+
+/* Log one line, and format what it should decode to. */
+#define TEST_CASE(...)                                                          \
+  DO_WHILE(                                                                     \
+    ALWAYS_ASSERT(ncases < TEST_MAX);                                           \
+    snprintf(expected[ncases++], TEST_LINE, __VA_ARGS__);                       \
+    blog_INFO_0(__VA_ARGS__);                                                   \
+  )
+
+
+static char expected[TEST_MAX][TEST_LINE];
+static int ncases = 0;
+
+
+static void write_cases(void) {
+  const char *str = "a string";
+  char c = 'x';
+  signed char sc = -128;
+  unsigned char uc = 255;
+  short s = -32768;
+  unsigned short us = 65535;
+  int i = INT_MIN;
+  Uint u = UINT_MAX;
+  long l = LONG_MIN;
+  Ulong ul = ULONG_MAX;
+  long long ll = LLONG_MIN;
+  unsigned long long ull = ULLONG_MAX;
+  float f = 0.1f;
+  double d = 3.141592653589793;
+  /* Integers of every width. */
+  TEST_CASE("char %c %d %hhd %hhu", c, c, c, c);
+  TEST_CASE("schar %hhd %hhu %hhx", sc, sc, sc);
+  TEST_CASE("uchar %hhu %hhd %d", uc, uc, uc);
+  TEST_CASE("short %hd %hu %hx", s, s, s);
+  TEST_CASE("ushort %hu %hd %o", us, us, us);
+  TEST_CASE("int %d %i %u %x %X %o", i, i, i, i, i, i);
+  TEST_CASE("uint %u %d %#x %#o", u, u, u, u);
+  TEST_CASE("long %ld %li %lu %lx", l, l, l, l);
+  TEST_CASE("ulong %lu %ld %#lX", ul, ul, ul);
+  TEST_CASE("llong %lld %llu %llx", ll, ll, ll);
+  TEST_CASE("ullong %llu %lld %llo", ull, ull, ull);
+  TEST_CASE("zero %d %u %ld %lu %x", 0, 0U, 0L, 0UL, 0);
+  TEST_CASE("flags [%+d] [% d] [%05d] [%-5d] [%+05ld]", 42, 42, -42, 42, -7L);
+  /* Strings. */
+  TEST_CASE("str [%s]", str);
+  TEST_CASE("str [%12s] [%-12s] [%.3s] [%*.*s]", str, str, str, 10, 4, str);
+  TEST_CASE("str [%s] [%s]", "", "with \"quotes\" and a %% sign");
+  /* Star widths and precisions. */
+  TEST_CASE("star [%*d] [%-*d] [%*d]", 8, 123, 8, 123, -8, 123);
+  TEST_CASE("star [%.*f] [%*.*f] [%.*e]", 3, d, 12, 2, d, 4, d);
+  TEST_CASE("star [%*ld] [%.*d]", 20, l, 6, 42);
+  /* Percent signs. */
+  TEST_CASE("%%");
+  TEST_CASE("100%% of %d%%", 7);
+  TEST_CASE("%%d [%%%d%%] %%s", 5);
+  /* Doubles. */
+  TEST_CASE("double %f %e %g %E %G", d, d, d, d, d);
+  TEST_CASE("double %.0f %.17g %a", d, d, d);
+  TEST_CASE("float %f %.9g", f, f);
+  TEST_CASE("double [%10.3f] [%-10.3f] [%+.2e] [%010.4f]", -d, -d, d, d);
+  TEST_CASE("double %g %g %g %g", 0.0, -0.0, 1e300, 5e-324);
+  TEST_CASE("mixed %s=%d (%5.1f%%) %lu/%lu", "load", 3, 97.25, 9UL, 10UL);
+}
+
+/* Return's the message of a decoded line, after the `[FUNC]:[...]: ` prefix, without the newline. */
+static char *line_message(char *const line) {
+  char *p = strstr(line, "[FUNC]:[");
+  if (!p || !(p = strstr(p, "]: "))) {
+    return NULL;
+  }
+  p[strcspn(p, "\n")] = '\0';
+  return (p + 3);
+}
+
+int main(void) {
+  char line[TEST_LINE + 128];
+  char *msg;
+  FILE *file;
+  int fd;
+  int failures = 0;
+  fcio_blog_open(TEST_PATH);
+  write_cases();
+  fcio_blog_close();
+  ALWAYS_ASSERT((fd = open(TEST_OUT_PATH, (O_WRONLY | O_CREAT | O_TRUNC), 0644)) != -1);
+  ALWAYS_ASSERT(fcio_blog_decode(TEST_PATH, fd) == ncases);
+  close(fd);
+  ALWAYS_ASSERT(file = fopen(TEST_OUT_PATH, "r"));
+  for (int i=0; i<ncases; ++i) {
+    msg = (fgets(line, sizeof(line), file) ? line_message(line) : NULL);
+    if (!msg || strcmp(msg, expected[i])) {
+      writeferr("blog: got '%s', expected '%s'\n", (msg ? msg : "(nothing)"), expected[i]);
+      ++failures;
+    }
+  }
+  fclose(file);
+  remove(TEST_PATH);
+  remove(TEST_OUT_PATH);
+  if (failures) {
+    writeferr("blog_test: %d failures\n", failures);
+    return 1;
+  }
+  writef("blog_test: all passed\n");
+  return 0;
+}
@@ -0,0 +1,138 @@
+/** @file fairlock_bench.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Acquisition latency benchmark of `ticketlock_t` and `mcslock_t` against `mutex_t` and `fmutex_t`, from 1 up to 32
+  threads.  Every thread measures how long each of its acquisitions took, and the p50, p99 and max over all threads
+  are reported, where the fair locks should keep p99 and max close to `threads * hold time`.
+
+ */
+#include <fcio/proto.h>
+
+
+#define OPS_PER_THREAD  (20000UL)
+#define CRITICAL_WORK   (64)
+
+
+typedef enum {
+  LOCK_PTHREAD,
+  LOCK_FMUTEX,
+  LOCK_TICKET,
+  LOCK_MCS,
+  LOCK_COUNT
+} LockKind;
+
+typedef struct {
+  LockKind kind;
+  mutex_t *pmutex;
+  fmutex_t *fmutex;
+  ticketlock_t *ticket;
+  mcslock_t *mcs;
+  volatile Ulong *counter;
+  Llong *waits;
+} BenchArg;
+
+
+static const char *const lock_names[] = { "mutex_t", "fmutex_t", "ticketlock_t", "mcslock_t" };
+
+
+static void critical(volatile Ulong *counter) {
+  for (int i=0; i<CRITICAL_WORK; ++i) {
+    ++*counter;
+  }
+}
+
+static void *bench_task(void *arg) {
+  BenchArg *ba = arg;
+  Llong start;
+  mcs_node_t node;
+  for (Ulong i=0; i<OPS_PER_THREAD; ++i) {
+    start = hiactime_now_ns();
+    switch (ba->kind) {
+      case LOCK_PTHREAD: {
+        mutex_lock(ba->pmutex);
+        ba->waits[i] = (hiactime_now_ns() - start);
+        critical(ba->counter);
+        mutex_unlock(ba->pmutex);
+        break;
+      }
+      case LOCK_FMUTEX: {
+        fmutex_lock(ba->fmutex);
+        ba->waits[i] = (hiactime_now_ns() - start);
+        critical(ba->counter);
+        fmutex_unlock(ba->fmutex);
+        break;
+      }
+      case LOCK_TICKET: {
+        ticketlock_lock(ba->ticket);
+        ba->waits[i] = (hiactime_now_ns() - start);
+        critical(ba->counter);
+        ticketlock_unlock(ba->ticket);
+        break;
+      }
+      case LOCK_MCS: {
+        mcslock_lock(ba->mcs, &node);
+        ba->waits[i] = (hiactime_now_ns() - start);
+        critical(ba->counter);
+        mcslock_unlock(ba->mcs, &node);
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+  }
+  return NULL;
+}
+
+static int compare_llong(const void *a, const void *b) {
+  Llong x = *(const Llong *)a;
+  Llong y = *(const Llong *)b;
+  return ((x < y) ? -1 : (x > y));
+}
+
+static void bench_run(LockKind kind, int nthreads) {
+  thread_t threads[32];
+  BenchArg args[32];
+  mutex_t pmutex;
+  fmutex_t fmutex = FMUTEX_INIT;
+  ticketlock_t ticket = TICKETLOCK_INIT;
+  mcslock_t mcs = MCSLOCK_INIT;
+  volatile Ulong counter = 0;
+  Ulong total = (OPS_PER_THREAD * (Ulong)nthreads);
+  Llong *waits = xmalloc(sizeof(*waits) * total);
+  mutex_init(&pmutex, NULL);
+  TIMER_START(timer);
+  for (int i=0; i<nthreads; ++i) {
+    args[i].kind    = kind;
+    args[i].pmutex  = &pmutex;
+    args[i].fmutex  = &fmutex;
+    args[i].ticket  = &ticket;
+    args[i].mcs     = &mcs;
+    args[i].counter = &counter;
+    args[i].waits   = &waits[OPS_PER_THREAD * (Ulong)i];
+    ALWAYS_ASSERT(thread_create(&threads[i], NULL, bench_task, &args[i]) == 0);
+  }
+  for (int i=0; i<nthreads; ++i) {
+    thread_join(threads[i], NULL);
+  }
+  TIMER_END(timer, ms);
+  mutex_destroy(&pmutex);
+  ALWAYS_ASSERT(counter == (total * CRITICAL_WORK));
+  qsort(waits, total, sizeof(*waits), compare_llong);
+  writef("%8d  %-12s  %10.3f  %10ld  %10ld  %12ld\n", nthreads, lock_names[kind], ((double)total / ((double)ms * 1e3)),
+    waits[total / 2], waits[(total * 99) / 100], waits[total - 1]);
+  free(waits);
+}
+
+int main(void) {
+  static const int threads[] = { 1, 2, 4, 8, 16, 32 };
+  writef("%8s  %-12s  %10s  %10s  %10s  %12s\n", "threads", "lock", "Mops", "p50 ns", "p99 ns", "max ns");
+  for (Ulong i=0; i<ARRAY_SIZE(threads); ++i) {
+    for (int kind=0; kind<LOCK_COUNT; ++kind) {
+      bench_run(kind, threads[i]);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,266 @@
+/** @file fiber_test.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Checks the fiber runtime.  Round robin yields, with values that have to survive the context switch in callee-saved
+  registers and on the stack, buffered and unbuffered channels and closing them, sleeps waking in deadline order,
+  waiting on a pipe with and without a timeout, and fibers posted from other threads.
+
+ */
+#include <fcio/proto.h>
+
+
+#define YIELD_FIBERS  (4)
+#define YIELD_ROUNDS  (100)
+
+#define CHAN_VALUES  (1000)
+
+#define POST_THREADS  (4)
+#define POST_EACH     (50)
+
+
+#define CHECK(expr)                                                       \
+  DO_WHILE(                                                               \
+    if (!(expr)) {                                                        \
+      writeferr("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);  \
+      ++failures;                                                         \
+    }                                                                     \
+  )
+
+
+static int failures = 0;
+
+static int yield_order[YIELD_FIBERS * YIELD_ROUNDS];
+static int yield_count = 0;
+
+static FIBER_CHAN chan;
+static Ulong chan_sum = 0;
+
+static int sleep_order[3];
+static int sleep_count = 0;
+
+static int pipe_fds[2];
+
+static FIBER_SCHED post_sched;
+static thread_t post_owner;
+static int post_ran = 0;
+
+
+/* ----------------------------- Yield ----------------------------- */
+
+static void yield_task(void *arg) {
+  int id = (int)(Ulong)arg;
+  /* Enough live values that some have to be kept in callee-saved registers, or on the stack, across every switch. */
+  Ulong a = (id + 1);
+  Ulong b = ((id + 1) * 3);
+  Ulong c = ((id + 1) * 7);
+  double d = (id + 0.5);
+  char stack[512];
+  memset(stack, ('a' + id), sizeof(stack));
+  CHECK(fiber_in_fiber());
+  for (int round=0; round<YIELD_ROUNDS; ++round) {
+    yield_order[yield_count++] = id;
+    fiber_yield();
+    a += 1;
+    b += 3;
+    c += 7;
+    d *= 1.0;
+  }
+  CHECK(a == (Ulong)(id + 1 + YIELD_ROUNDS));
+  CHECK(b == (Ulong)(((id + 1) * 3) + (YIELD_ROUNDS * 3)));
+  CHECK(c == (Ulong)(((id + 1) * 7) + (YIELD_ROUNDS * 7)));
+  CHECK(d == (id + 0.5));
+  for (Ulong i=0; i<sizeof(stack); ++i) {
+    if (stack[i] != ('a' + id)) {
+      CHECK(!"stack of a fiber was clobbered");
+      break;
+    }
+  }
+}
+
+static void test_yield(void) {
+  FIBER_SCHED sched = fiber_sched_create(0);
+  CHECK(!fiber_in_fiber());
+  for (int i=0; i<YIELD_FIBERS; ++i) {
+    fiber_spawn(sched, yield_task, (void *)(Ulong)i);
+  }
+  fiber_sched_run(sched);
+  fiber_sched_free(sched);
+  CHECK(yield_count == (YIELD_FIBERS * YIELD_ROUNDS));
+  for (int i=0; i<yield_count; ++i) {
+    if (yield_order[i] != (i % YIELD_FIBERS)) {
+      writeferr("yield: fiber %d ran at step %d, expected fiber %d\n", yield_order[i], i, (i % YIELD_FIBERS));
+      ++failures;
+      break;
+    }
+  }
+}
+
+/* ----------------------------- Channel ----------------------------- */
+
+static void chan_producer(void *arg) {
+  for (Ulong i=1; i<=CHAN_VALUES; ++i) {
+    CHECK(fiber_chan_send(chan, (void *)i));
+  }
+  fiber_chan_close(chan);
+  CHECK(!fiber_chan_send(chan, (void *)1UL));
+}
+
+static void chan_consumer(void *arg) {
+  void *value;
+  Ulong expect = 1;
+  while (fiber_chan_recv(chan, &value)) {
+    CHECK((Ulong)value == expect);
+    chan_sum += (Ulong)value;
+    ++expect;
+  }
+  CHECK(expect == (CHAN_VALUES + 1));
+}
+
+/* Blocks on a full channel until it is closed, which must fail the send. */
+static void chan_blocked_sender(void *arg) {
+  CHECK(fiber_chan_send(chan, (void *)1UL));
+  CHECK(!fiber_chan_send(chan, (void *)2UL));
+}
+
+static void chan_closer(void *arg) {
+  void *value;
+  fiber_yield();
+  fiber_chan_close(chan);
+  /* The buffered value is still there after the close, and then the channel is drained. */
+  CHECK(fiber_chan_recv(chan, &value) && (Ulong)value == 1);
+  CHECK(!fiber_chan_recv(chan, &value));
+}
+
+static void test_chan(Ulong cap) {
+  FIBER_SCHED sched = fiber_sched_create(0);
+  chan     = fiber_chan_create(cap);
+  chan_sum = 0;
+  fiber_spawn(sched, chan_consumer, NULL);
+  fiber_spawn(sched, chan_producer, NULL);
+  fiber_sched_run(sched);
+  fiber_chan_free(chan);
+  CHECK(chan_sum == ((CHAN_VALUES * (CHAN_VALUES + 1)) / 2));
+  chan = fiber_chan_create(1);
+  fiber_spawn(sched, chan_blocked_sender, NULL);
+  fiber_spawn(sched, chan_closer, NULL);
+  fiber_sched_run(sched);
+  fiber_chan_free(chan);
+  fiber_sched_free(sched);
+}
+
+/* ----------------------------- Sleep ----------------------------- */
+
+static void sleep_task(void *arg) {
+  int ms = (int)(Ulong)arg;
+  Llong start = hiactime_now_ns();
+  fiber_sleep_ns(ms * 1000000L);
+  CHECK((hiactime_now_ns() - start) >= (ms * 1000000L));
+  sleep_order[sleep_count++] = ms;
+}
+
+static void test_sleep(void) {
+  FIBER_SCHED sched = fiber_sched_create(0);
+  fiber_spawn(sched, sleep_task, (void *)30UL);
+  fiber_spawn(sched, sleep_task, (void *)10UL);
+  fiber_spawn(sched, sleep_task, (void *)20UL);
+  fiber_sched_run(sched);
+  fiber_sched_free(sched);
+  CHECK(sleep_count == 3);
+  CHECK(sleep_order[0] == 10 && sleep_order[1] == 20 && sleep_order[2] == 30);
+}
+
+/* ----------------------------- Wait fd ----------------------------- */
+
+static void fd_reader(void *arg) {
+  char c = 0;
+  Llong start = hiactime_now_ns();
+  /* Nothing is written yet, so this times out. */
+  CHECK(fiber_wait_fd(pipe_fds[0], EPOLLIN, 5000000) == 0);
+  CHECK((hiactime_now_ns() - start) >= 5000000);
+  /* The writer writes after 20 ms, well after the timeout above. */
+  CHECK(fiber_wait_fd(pipe_fds[0], EPOLLIN, -1) & EPOLLIN);
+  CHECK(read(pipe_fds[0], &c, 1) == 1 && c == 'x');
+  CHECK((hiactime_now_ns() - start) >= 20000000);
+}
+
+static void fd_writer(void *arg) {
+  fiber_sleep_ns(20000000);
+  CHECK(write(pipe_fds[1], "x", 1) == 1);
+}
+
+static void test_wait_fd(void) {
+  FIBER_SCHED sched = fiber_sched_create(0);
+  ALWAYS_ASSERT(pipe(pipe_fds) == 0);
+  fiber_spawn(sched, fd_reader, NULL);
+  fiber_spawn(sched, fd_writer, NULL);
+  fiber_sched_run(sched);
+  fiber_sched_free(sched);
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+/* ----------------------------- Post ----------------------------- */
+
+/* Runs as a fiber on the scheduler's thread, whichever thread posted it. */
+static void post_task(void *arg) {
+  CHECK(fiber_in_fiber());
+  CHECK(pthread_equal(pthread_self(), post_owner));
+  ++post_ran;
+  CHECK(fiber_chan_send(chan, arg));
+}
+
+/* Waits for every posted fiber, keeping the scheduler running while the posts are still coming in. */
+static void post_receiver(void *arg) {
+  void *value;
+  Ulong sum = 0;
+  for (int i=0; i<(POST_THREADS * POST_EACH); ++i) {
+    CHECK(fiber_chan_recv(chan, &value));
+    sum += (Ulong)value;
+  }
+  CHECK(sum == (Ulong)(POST_THREADS * ((POST_EACH * (POST_EACH + 1)) / 2)));
+}
+
+static void *post_thread(void *arg) {
+  for (Ulong i=1; i<=POST_EACH; ++i) {
+    fiber_sched_post(post_sched, post_task, (void *)i);
+    if (!(i % 10)) {
+      hiactime_nsleep(1000000);
+    }
+  }
+  return NULL;
+}
+
+static void test_post(void) {
+  thread_t threads[POST_THREADS];
+  post_sched = fiber_sched_create(0);
+  post_owner = pthread_self();
+  chan       = fiber_chan_create(0);
+  fiber_spawn(post_sched, post_receiver, NULL);
+  for (int i=0; i<POST_THREADS; ++i) {
+    ALWAYS_ASSERT(thread_create(&threads[i], NULL, post_thread, NULL) == 0);
+  }
+  fiber_sched_run(post_sched);
+  for (int i=0; i<POST_THREADS; ++i) {
+    thread_join(threads[i], NULL);
+  }
+  CHECK(post_ran == (POST_THREADS * POST_EACH));
+  fiber_chan_free(chan);
+  fiber_sched_free(post_sched);
+}
+
+int main(void) {
+  test_yield();
+  test_chan(0);
+  test_chan(4);
+  test_sleep();
+  test_wait_fd();
+  test_post();
+  if (failures) {
+    writeferr("fiber_test: %d failures\n", failures);
+    return 1;
+  }
+  writef("fiber_test: all passed\n");
+  return 0;
+}
@@ -0,0 +1,115 @@
+/** @file mpmc_bench.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Contention benchmark of `MPMC` against a `QUEUE` protected by a `mutex_t`, from 1 up to 32 threads.
+  With one thread, that thread pushes and pops, otherwise half of the threads produce and half consume.
+
+ */
+#include <fcio/proto.h>
+
+
+#define OPS_PER_THREAD  (200000UL)
+#define MPMC_CAP        (1024)
+
+
+/* The mutex + `QUEUE` baseline, with a condition to block consumers on when empty. */
+typedef struct {
+  mutex_t mutex;
+  cond_t  cond;
+  QUEUE   queue;
+} LockedQueue;
+
+typedef struct {
+  bool  mpmc;
+  bool  producer;
+  bool  both;
+  MPMC  mq;
+  LockedQueue *lq;
+} BenchArg;
+
+
+static void locked_push(LockedQueue *lq, void *data) {
+  mutex_action(&lq->mutex,
+    queue_push(lq->queue, data);
+    cond_signal(&lq->cond);
+  );
+}
+
+static void *locked_pop(LockedQueue *lq) {
+  void *ret;
+  mutex_action(&lq->mutex,
+    while (!queue_size(lq->queue)) {
+      cond_wait(&lq->cond, &lq->mutex);
+    }
+    ret = queue_front(lq->queue);
+    queue_pop(lq->queue);
+  );
+  return ret;
+}
+
+static void *bench_task(void *arg) {
+  BenchArg *ba = arg;
+  for (Ulong i=1; i<=OPS_PER_THREAD; ++i) {
+    if (ba->producer || ba->both) {
+      if (ba->mpmc) {
+        mpmc_push(ba->mq, (void *)i);
+      }
+      else {
+        locked_push(ba->lq, (void *)i);
+      }
+    }
+    if (!ba->producer || ba->both) {
+      if (ba->mpmc) {
+        ALWAYS_ASSERT(mpmc_pop(ba->mq));
+      }
+      else {
+        ALWAYS_ASSERT(locked_pop(ba->lq));
+      }
+    }
+  }
+  return NULL;
+}
+
+/* Run one configuration and return the number of million operations per second, where a push and a pop is one operation. */
+static double bench_run(bool mpmc, int nthreads) {
+  thread_t threads[32];
+  BenchArg args[32];
+  LockedQueue lq;
+  MPMC mq = mpmc_create(MPMC_CAP);
+  mutex_init(&lq.mutex, NULL);
+  cond_init(&lq.cond, NULL);
+  lq.queue = queue_create();
+  TIMER_START(timer);
+  for (int i=0; i<nthreads; ++i) {
+    args[i].mpmc     = mpmc;
+    args[i].producer = !(i & 1);
+    args[i].both     = (nthreads == 1);
+    args[i].mq       = mq;
+    args[i].lq       = &lq;
+    ALWAYS_ASSERT(thread_create(&threads[i], NULL, bench_task, &args[i]) == 0);
+  }
+  for (int i=0; i<nthreads; ++i) {
+    thread_join(threads[i], NULL);
+  }
+  TIMER_END(timer, ms);
+  mpmc_free(mq);
+  queue_free(lq.queue);
+  mutex_destroy(&lq.mutex);
+  cond_destroy(&lq.cond);
+  return ((double)(OPS_PER_THREAD * (Ulong)((nthreads == 1) ? 1 : (nthreads / 2))) / ((double)ms * 1e3));
+}
+
+int main(void) {
+  static const int threads[] = { 1, 2, 4, 8, 16, 32 };
+  double locked;
+  double lockfree;
+  writef("%8s  %16s  %16s  %8s\n", "threads", "mutex+QUEUE Mops", "MPMC Mops", "speedup");
+  for (Ulong i=0; i<ARRAY_SIZE(threads); ++i) {
+    locked   = bench_run(FALSE, threads[i]);
+    lockfree = bench_run(TRUE,  threads[i]);
+    writef("%8d  %16.3f  %16.3f  %7.2fx\n", threads[i], locked, lockfree, (lockfree / locked));
+  }
+  return 0;
+}
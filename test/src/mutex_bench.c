@@ -0,0 +1,152 @@
+/** @file mutex_bench.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Contention benchmark of `fmutex_t` (which now backs `SMUTEX`) against the previous gate/proof `SMUTEX` with its
+  sleep loop, and `mutex_t`, from 1 up to 32 threads.  Every thread takes the lock, bumps a shared counter and does
+  a little work inside the critical section, the total number of operations is the same for every thread count.
+
+ */
+#include <fcio/proto.h>
+
+
+#define TOTAL_OPS      (1UL << 20)
+#define CRITICAL_WORK  (16)
+
+
+typedef enum {
+  LOCK_LEGACY,
+  LOCK_PTHREAD,
+  LOCK_FMUTEX,
+} LockKind;
+
+/* The previous `SMUTEX`, kept here as the baseline.  Note that it's not actually a correct lock on SMP. */
+typedef struct {
+  volatile Ulong gate;
+  volatile Ulong proof;
+  volatile Ulong holder;
+} LegacySmutex;
+
+typedef struct {
+  LockKind kind;
+  Ulong ops;
+  LegacySmutex *legacy;
+  mutex_t *pmutex;
+  fmutex_t *fmutex;
+  volatile Ulong *counter;
+} BenchArg;
+
+
+static Ulong legacy_try_win(LegacySmutex *sm, volatile Ulong id) {
+  if (!sm->gate) {
+    sm->gate  = (sm->gate + id);
+    sm->proof = sm->gate;
+    if (sm->gate == id && sm->proof == id) {
+      return id;
+    }
+    sm->gate = (sm->gate - id);
+  }
+  return 0;
+}
+
+static void legacy_lock(LegacySmutex *sm) {
+  volatile Ulong attempt = 0;
+  volatile Ulong id = pthread_self();
+  while (1) {
+    if (!sm->holder && legacy_try_win(sm, id) == id) {
+      sm->holder = id;
+      return;
+    }
+    /* The shift is capped, the old one reached past the width of the type. */
+    hiactime_nsleep(50 * (1UL << (((attempt++ & 63) + (id & 63)) & 15)));
+  }
+}
+
+static void legacy_unlock(LegacySmutex *sm) {
+  if (sm->holder) {
+    sm->gate   = (sm->gate - sm->holder);
+    sm->holder = sm->gate;
+  }
+}
+
+static void critical(volatile Ulong *counter) {
+  for (int i=0; i<CRITICAL_WORK; ++i) {
+    ++*counter;
+  }
+}
+
+static void *bench_task(void *arg) {
+  BenchArg *ba = arg;
+  for (Ulong i=0; i<ba->ops; ++i) {
+    switch (ba->kind) {
+      case LOCK_LEGACY: {
+        legacy_lock(ba->legacy);
+        critical(ba->counter);
+        legacy_unlock(ba->legacy);
+        break;
+      }
+      case LOCK_PTHREAD: {
+        mutex_action(ba->pmutex,
+          critical(ba->counter);
+        );
+        break;
+      }
+      case LOCK_FMUTEX: {
+        FMUTEX_ACTION(ba->fmutex,
+          critical(ba->counter);
+        );
+        break;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* Run one configuration and return the number of million lock/unlock pairs per second. */
+static double bench_run(LockKind kind, int nthreads) {
+  thread_t threads[32];
+  BenchArg args[32];
+  LegacySmutex legacy = {0};
+  mutex_t pmutex;
+  fmutex_t fmutex = FMUTEX_INIT;
+  volatile Ulong counter = 0;
+  Ulong ops = (TOTAL_OPS / (Ulong)nthreads);
+  mutex_init(&pmutex, NULL);
+  TIMER_START(timer);
+  for (int i=0; i<nthreads; ++i) {
+    args[i].kind    = kind;
+    args[i].ops     = ops;
+    args[i].legacy  = &legacy;
+    args[i].pmutex  = &pmutex;
+    args[i].fmutex  = &fmutex;
+    args[i].counter = &counter;
+    ALWAYS_ASSERT(thread_create(&threads[i], NULL, bench_task, &args[i]) == 0);
+  }
+  for (int i=0; i<nthreads; ++i) {
+    thread_join(threads[i], NULL);
+  }
+  TIMER_END(timer, ms);
+  mutex_destroy(&pmutex);
+  /* The old `SMUTEX` uses plain stores without any fences, so it's not mutually exclusive on more then one core, and
+   * may lose counts.  That is part of why it was replaced. */
+  if (kind != LOCK_LEGACY) {
+    ALWAYS_ASSERT(counter == (ops * (Ulong)nthreads * CRITICAL_WORK));
+  }
+  return ((double)(ops * (Ulong)nthreads) / ((double)ms * 1e3));
+}
+
+int main(void) {
+  static const int threads[] = { 1, 2, 4, 8, 16, 32 };
+  double legacy;
+  double pthread;
+  double fmutex;
+  writef("%8s  %16s  %16s  %16s\n", "threads", "old SMUTEX Mops", "mutex_t Mops", "fmutex_t Mops");
+  for (Ulong i=0; i<ARRAY_SIZE(threads); ++i) {
+    legacy  = bench_run(LOCK_LEGACY,  threads[i]);
+    pthread = bench_run(LOCK_PTHREAD, threads[i]);
+    fmutex  = bench_run(LOCK_FMUTEX,  threads[i]);
+    writef("%8d  %16.3f  %16.3f  %16.3f\n", threads[i], legacy, pthread, fmutex);
+  }
+  return 0;
+}
@@ -0,0 +1,150 @@
+/** @file rwlock_bench.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Reader scaling benchmark of `rwlock_t`, `PRWLOCK` and `seqlock_t`, from 1 up to 32 reader threads, with one writer
+  that updates the protected state every `WRITE_INTERVAL_US` microseconds the whole time.  Readers check that they
+  never see a torn state, so this doubles as a correctness test.
+
+ */
+#include <fcio/proto.h>
+
+
+#define READS_PER_THREAD   (1000000UL)
+#define WRITE_INTERVAL_US  (100)
+
+
+typedef enum {
+  LOCK_PTHREAD,
+  LOCK_PRWLOCK,
+  LOCK_SEQLOCK,
+} LockKind;
+
+/* The protected state, the readers verify that `b` is always `a * 2`. */
+typedef struct {
+  Ulong a;
+  Ulong b;
+} State;
+
+typedef struct {
+  LockKind kind;
+  rwlock_t *rwlock;
+  PRWLOCK prwlock;
+  seqlock_t *seqlock;
+  State *state;
+  bool *stop;
+} BenchArg;
+
+
+static void *reader_task(void *arg) {
+  BenchArg *ba = arg;
+  State copy = { 0, 0 };
+  for (Ulong i=0; i<READS_PER_THREAD; ++i) {
+    switch (ba->kind) {
+      case LOCK_PTHREAD: {
+        RWLOCK_RDLOCK_ACTION(ba->rwlock,
+          copy = *ba->state;
+        );
+        break;
+      }
+      case LOCK_PRWLOCK: {
+        PRWLOCK_RDLOCK_ACTION(ba->prwlock,
+          copy = *ba->state;
+        );
+        break;
+      }
+      case LOCK_SEQLOCK: {
+        SEQLOCK_READ_ACTION(ba->seqlock,
+          copy.a = __atomic_load_n(&ba->state->a, __ATOMIC_RELAXED);
+          copy.b = __atomic_load_n(&ba->state->b, __ATOMIC_RELAXED);
+        );
+        break;
+      }
+    }
+    ALWAYS_ASSERT(copy.b == (copy.a * 2));
+  }
+  return NULL;
+}
+
+static void write_state(State *state) {
+  Ulong a = (state->a + 1);
+  __atomic_store_n(&state->a, a, __ATOMIC_RELAXED);
+  __atomic_store_n(&state->b, (a * 2), __ATOMIC_RELAXED);
+}
+
+static void *writer_task(void *arg) {
+  BenchArg *ba = arg;
+  while (!__atomic_load_n(ba->stop, __ATOMIC_ACQUIRE)) {
+    switch (ba->kind) {
+      case LOCK_PTHREAD: {
+        RWLOCK_WRLOCK_ACTION(ba->rwlock,
+          write_state(ba->state);
+        );
+        break;
+      }
+      case LOCK_PRWLOCK: {
+        PRWLOCK_WRLOCK_ACTION(ba->prwlock,
+          write_state(ba->state);
+        );
+        break;
+      }
+      case LOCK_SEQLOCK: {
+        SEQLOCK_WRITE_ACTION(ba->seqlock,
+          write_state(ba->state);
+        );
+        break;
+      }
+    }
+    usleep(WRITE_INTERVAL_US);
+  }
+  return NULL;
+}
+
+/* Run one configuration and return the number of million reads per second, over all readers. */
+static double bench_run(LockKind kind, int nthreads) {
+  thread_t threads[32];
+  thread_t writer;
+  BenchArg ba;
+  rwlock_t rwlock;
+  seqlock_t seqlock;
+  State state = { 0, 0 };
+  bool stop = FALSE;
+  RWLOCK_INIT(&rwlock, NULL);
+  seqlock_init(&seqlock);
+  ba.kind    = kind;
+  ba.rwlock  = &rwlock;
+  ba.prwlock = prwlock_create();
+  ba.seqlock = &seqlock;
+  ba.state   = &state;
+  ba.stop    = &stop;
+  ALWAYS_ASSERT(thread_create(&writer, NULL, writer_task, &ba) == 0);
+  TIMER_START(timer);
+  for (int i=0; i<nthreads; ++i) {
+    ALWAYS_ASSERT(thread_create(&threads[i], NULL, reader_task, &ba) == 0);
+  }
+  for (int i=0; i<nthreads; ++i) {
+    thread_join(threads[i], NULL);
+  }
+  TIMER_END(timer, ms);
+  __atomic_store_n(&stop, TRUE, __ATOMIC_RELEASE);
+  thread_join(writer, NULL);
+  prwlock_free(ba.prwlock);
+  RWLOCK_DESTROY(&rwlock);
+  return ((double)(READS_PER_THREAD * (Ulong)nthreads) / ((double)ms * 1e3));
+}
+
+int main(void) {
+  static const int threads[] = { 1, 2, 4, 8, 16, 32 };
+  double pthread;
+  double prwlock;
+  double seqlock;
+  writef("%8s  %16s  %16s  %16s\n", "readers", "rwlock_t Mops", "PRWLOCK Mops", "seqlock_t Mops");
+  for (Ulong i=0; i<ARRAY_SIZE(threads); ++i) {
+    pthread = bench_run(LOCK_PTHREAD, threads[i]);
+    prwlock = bench_run(LOCK_PRWLOCK, threads[i]);
+    seqlock = bench_run(LOCK_SEQLOCK, threads[i]);
+    writef("%8d  %16.3f  %16.3f  %16.3f\n", threads[i], pthread, prwlock, seqlock);
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+/** @file sleep_bench.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Accuracy against cpu time of a plain relative `nanosleep()` and `hiactime_nsleep()`, over a range of sleep lengths.
+  For every length the p50, p99 and max oversleep is reported, together with the cpu time the sleeping thread used,
+  as a percentage of the wall time slept.
+
+ */
+#include <fcio/proto.h>
+
+
+#define SLEEPS  (200)
+
+
+typedef enum {
+  SLEEP_NANOSLEEP,
+  SLEEP_HIACTIME,
+  SLEEP_COUNT
+} SleepKind;
+
+
+static const char *const sleep_names[] = { "nanosleep", "hiactime_nsleep" };
+
+
+static Llong thread_cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ((ts.tv_sec * 1000000000LL) + ts.tv_nsec);
+}
+
+static int compare_llong(const void *a, const void *b) {
+  Llong x = *(const Llong *)a;
+  Llong y = *(const Llong *)b;
+  return ((x < y) ? -1 : (x > y));
+}
+
+static void bench_run(SleepKind kind, Llong ns) {
+  Llong errors[SLEEPS];
+  struct timespec req = { (ns / 1000000000LL), (ns % 1000000000LL) };
+  Llong start;
+  Llong wall = hiactime_now_ns();
+  Llong cpu  = thread_cpu_ns();
+  for (int i=0; i<SLEEPS; ++i) {
+    start = hiactime_now_ns();
+    if (kind == SLEEP_NANOSLEEP) {
+      nanosleep(&req, NULL);
+    }
+    else {
+      hiactime_nsleep(ns);
+    }
+    errors[i] = (hiactime_now_ns() - start - ns);
+  }
+  cpu  = (thread_cpu_ns() - cpu);
+  wall = (hiactime_now_ns() - wall);
+  qsort(errors, SLEEPS, sizeof(*errors), compare_llong);
+  writef("%10ld  %-16s  %10ld  %10ld  %10ld  %8.2f%%\n", ns, sleep_names[kind], errors[SLEEPS / 2],
+    errors[(SLEEPS * 99) / 100], errors[SLEEPS - 1], ((100.0 * (double)cpu) / (double)wall));
+}
+
+int main(void) {
+  static const Llong lengths[] = { 20000, 100000, 500000, 1000000, 5000000 };
+  writef("%10s  %-16s  %10s  %10s  %10s  %9s\n", "sleep ns", "method", "p50 late", "p99 late", "max late", "cpu");
+  for (Ulong i=0; i<ARRAY_SIZE(lengths); ++i) {
+    for (int kind=0; kind<SLEEP_COUNT; ++kind) {
+      bench_run(kind, lengths[i]);
+    }
+  }
+  writef("spin threshold: %ld ns\n", hiactime_spin_threshold_ns());
+  return 0;
+}
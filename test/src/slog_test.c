@@ -0,0 +1,146 @@
+/** @file slog_test.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Checks the structured log encoders through the log file.  Every double is compared with `snprintf("%.15g")`, for a
+  set of edge cases and a run of random bit patterns, and strings that need escaping are checked in both JSON and
+  logfmt.
+
+ */
+#include <fcio/proto.h>
+
+
+#define TEST_PATH     "/tmp/fcio_slog_test.log"
+#define TEST_RANDOM   (1000000)
+
+
+static const double edge_cases[] = {
+  -0.0, 0.1, 0.5, 1.5, 2.5, 1e-5, 1e-4, 123456.789, 1e15, 1e16, 999999999999999.5, 9999999999999995.0, 1e100,
+  1611.373985582665, 6.926845670833675e-07, 0.30000000000000004, 2.2250738585072014e-308, 4.9406564584124654e-324,
+  1.7976931348623157e308, -1234.5678
+};
+
+/* The strings to escape, with what they should become as a JSON string and as a logfmt value. */
+static const char *const escape_cases[][3] = {
+  { "plain",            "\"plain\"",                  "plain"                        },
+  { "",                 "\"\"",                       "\"\""                         },
+  { "two words",        "\"two words\"",              "\"two words\""                },
+  { "a=b",              "\"a=b\"",                    "\"a=b\""                      },
+  { "say \"hi\"",       "\"say \\\"hi\\\"\"",         "\"say \\\"hi\\\"\""           },
+  { "back\\slash",      "\"back\\\\slash\"",          "\"back\\\\slash\""            },
+  { "tab\tnl\ncr\r",    "\"tab\\tnl\\ncr\\r\"",       "\"tab\\tnl\\ncr\\r\""         },
+  { "bell\x07 del",     "\"bell\\u0007 del\"",        "\"bell\\u0007 del\""          },
+  { "utf-8 \xc3\xa5",   "\"utf-8 \xc3\xa5\"",         "\"utf-8 \xc3\xa5\""           },
+  { "long run of clean bytes before the \"quote\"",
+    "\"long run of clean bytes before the \\\"quote\\\"\"",
+    "\"long run of clean bytes before the \\\"quote\\\"\"" }
+};
+
+
+static Ulong test_seed = 0x9E3779B97F4A7C15UL;
+
+static int failures = 0;
+
+
+static double random_double(void) {
+  double value;
+  do {
+    test_seed ^= (test_seed << 13);
+    test_seed ^= (test_seed >> 7);
+    test_seed ^= (test_seed << 17);
+    memcpy(&value, &test_seed, sizeof(value));
+  } while (value != value || __builtin_isinf(value));
+  return value;
+}
+
+/* Return's the value of `key` in the next line of `file`, as it was written in the log. */
+static char *next_value(FILE *const file, const char *const key, char *const line, int size) {
+  char *p;
+  char *end;
+  if (!fgets(line, size, file) || !(p = strstr(line, key))) {
+    return NULL;
+  }
+  p += strlen(key);
+  if (*p == '"') {
+    /* Keep the quotes, and skip over anything escaped. */
+    for (end=(p + 1); *end && *end != '"'; ++end) {
+      if (*end == '\\') {
+        ++end;
+      }
+    }
+    end += !!*end;
+  }
+  else {
+    end = (p + strcspn(p, " ,}\n"));
+  }
+  *end = '\0';
+  return p;
+}
+
+static void check(const char *const got, const char *const expected, const char *const what) {
+  if (!got || strcmp(got, expected)) {
+    writeferr("%s: got '%s', expected '%s'\n", what, (got ? got : "(nothing)"), expected);
+    ++failures;
+  }
+}
+
+static void test_doubles(void) {
+  char line[4096];
+  char expected[64];
+  FILE *file;
+  Ulong seed = test_seed;
+  fcio_slog_set_format(FCIO_SLOG_LOGFMT);
+  for (Ulong i=0; i<ARRAY_SIZE(edge_cases); ++i) {
+    slog_INFO_0("double", SLOG_DOUBLE("v", edge_cases[i]));
+  }
+  for (int i=0; i<TEST_RANDOM; ++i) {
+    slog_INFO_0("double", SLOG_DOUBLE("v", random_double()));
+  }
+  fcio_log_flush();
+  ALWAYS_ASSERT(file = fopen(TEST_PATH, "r"));
+  for (Ulong i=0; i<ARRAY_SIZE(edge_cases); ++i) {
+    snprintf(expected, sizeof(expected), "%.15g", edge_cases[i]);
+    check(next_value(file, " v=", line, sizeof(line)), expected, "double");
+  }
+  test_seed = seed;
+  for (int i=0; i<TEST_RANDOM; ++i) {
+    snprintf(expected, sizeof(expected), "%.15g", random_double());
+    check(next_value(file, " v=", line, sizeof(line)), expected, "double");
+  }
+  fclose(file);
+}
+
+static void test_escapes(int format, int column, const char *const key) {
+  char line[4096];
+  FILE *file;
+  long offset;
+  ALWAYS_ASSERT(file = fopen(TEST_PATH, "r"));
+  fseek(file, 0, SEEK_END);
+  offset = ftell(file);
+  fcio_slog_set_format(format);
+  for (Ulong i=0; i<ARRAY_SIZE(escape_cases); ++i) {
+    slog_INFO_0("escape", SLOG_STR("s", escape_cases[i][0]));
+  }
+  fcio_log_flush();
+  fseek(file, offset, SEEK_SET);
+  for (Ulong i=0; i<ARRAY_SIZE(escape_cases); ++i) {
+    check(next_value(file, key, line, sizeof(line)), escape_cases[i][column], ((format == FCIO_SLOG_JSON) ? "json" : "logfmt"));
+  }
+  fclose(file);
+}
+
+int main(void) {
+  fclose(fopen(TEST_PATH, "w"));
+  fcio_log_set_file(TEST_PATH);
+  test_doubles();
+  test_escapes(FCIO_SLOG_JSON,   1, "\"s\":");
+  test_escapes(FCIO_SLOG_LOGFMT, 2, " s=");
+  remove(TEST_PATH);
+  if (failures) {
+    writeferr("slog_test: %d failures\n", failures);
+    return 1;
+  }
+  writef("slog_test: all passed\n");
+  return 0;
+}
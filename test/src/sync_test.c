@@ -0,0 +1,153 @@
+/** @file sync_test.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Checks the event, latch and barrier of `atomics.c`.  The barrier is run for many rounds, checking that no thread
+  leaves a round early and that exactly one thread per round is the serial one.  The latch must release its waiter
+  only once it reaches zero, and time out otherwise, and the event must follow set/reset.
+
+ */
+#include <fcio/proto.h>
+
+
+#define BARRIER_THREADS  (4)
+#define BARRIER_ROUNDS   (20000)
+
+#define LATCH_COUNT  (4)
+
+
+#define CHECK(expr)                                                     \
+  DO_WHILE(                                                             \
+    if (!(expr)) {                                                      \
+      writeferr("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);  \
+      __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);              \
+    }                                                                   \
+  )
+
+
+static int failures = 0;
+
+static barrier_t barrier;
+static Uint barrier_arrived = 0;
+static Uint barrier_serial[BARRIER_ROUNDS];
+
+static latch_t latch;
+static Uint latch_released = FALSE;
+
+static event_t event;
+
+
+static void sleep_ns(Llong ns) {
+  hiactime_sleep_until_ns(hiactime_now_ns() + ns);
+}
+
+/* ----------------------------- Barrier ----------------------------- */
+
+static void *barrier_task(void *arg) {
+  for (int round=0; round<BARRIER_ROUNDS; ++round) {
+    __atomic_add_fetch(&barrier_arrived, 1, __ATOMIC_RELAXED);
+    if (barrier_wait(&barrier)) {
+      __atomic_add_fetch(&barrier_serial[round], 1, __ATOMIC_RELAXED);
+    }
+    /* Everyone has arrived for this round, and nobody can arrive for the next one before this thread does. */
+    CHECK(__atomic_load_n(&barrier_arrived, __ATOMIC_RELAXED) >= (Uint)((round + 1) * BARRIER_THREADS));
+  }
+  return NULL;
+}
+
+static void test_barrier(void) {
+  thread_t threads[BARRIER_THREADS];
+  barrier_init(&barrier, BARRIER_THREADS);
+  for (int i=0; i<BARRIER_THREADS; ++i) {
+    ALWAYS_ASSERT(thread_create(&threads[i], NULL, barrier_task, NULL) == 0);
+  }
+  for (int i=0; i<BARRIER_THREADS; ++i) {
+    thread_join(threads[i], NULL);
+  }
+  CHECK(barrier_arrived == (BARRIER_ROUNDS * BARRIER_THREADS));
+  for (int round=0; round<BARRIER_ROUNDS; ++round) {
+    if (barrier_serial[round] != 1) {
+      writeferr("barrier: round %d had %u serial threads\n", round, barrier_serial[round]);
+      ++failures;
+      break;
+    }
+  }
+}
+
+/* ----------------------------- Latch ----------------------------- */
+
+static void *latch_task(void *arg) {
+  bool ret = latch_wait(&latch, -1);
+  __atomic_store_n(&latch_released, TRUE, __ATOMIC_RELEASE);
+  CHECK(ret);
+  return NULL;
+}
+
+static void test_latch(void) {
+  thread_t thread;
+  Llong start;
+  latch_init(&latch, LATCH_COUNT);
+  ALWAYS_ASSERT(thread_create(&thread, NULL, latch_task, NULL) == 0);
+  for (int i=1; i<LATCH_COUNT; ++i) {
+    latch_count_down(&latch, 1);
+    sleep_ns(5000000);
+    CHECK(!latch_try_wait(&latch));
+    CHECK(!__atomic_load_n(&latch_released, __ATOMIC_ACQUIRE));
+  }
+  latch_count_down(&latch, 1);
+  thread_join(thread, NULL);
+  CHECK(latch_released);
+  CHECK(latch_try_wait(&latch));
+  CHECK(latch_wait(&latch, 0));
+  /* A latch that never reaches zero times out, after at least the timeout. */
+  latch_init(&latch, 1);
+  start = hiactime_now_ns();
+  CHECK(!latch_wait(&latch, 10000000));
+  CHECK((hiactime_now_ns() - start) >= 10000000);
+  CHECK(!latch_wait(&latch, 0));
+}
+
+/* ----------------------------- Event ----------------------------- */
+
+static void *event_task(void *arg) {
+  sleep_ns(20000000);
+  event_set(&event);
+  return NULL;
+}
+
+static void test_event(void) {
+  thread_t thread;
+  Llong start;
+  event_init(&event);
+  CHECK(!event_is_set(&event));
+  start = hiactime_now_ns();
+  CHECK(!event_wait(&event, 10000000));
+  CHECK((hiactime_now_ns() - start) >= 10000000);
+  /* Set from another thread while waiting. */
+  ALWAYS_ASSERT(thread_create(&thread, NULL, event_task, NULL) == 0);
+  CHECK(event_wait(&event, -1));
+  thread_join(thread, NULL);
+  CHECK(event_is_set(&event));
+  CHECK(event_wait(&event, 0));
+  /* Set stays set, until reset. */
+  event_set(&event);
+  CHECK(event_is_set(&event));
+  event_reset(&event);
+  CHECK(!event_is_set(&event));
+  CHECK(!event_wait(&event, 1000000));
+  event_set(&event);
+  CHECK(event_wait(&event, 0));
+}
+
+int main(void) {
+  test_barrier();
+  test_latch();
+  test_event();
+  if (failures) {
+    writeferr("sync_test: %d failures\n", failures);
+    return 1;
+  }
+  writef("sync_test: all passed\n");
+  return 0;
+}
@@ -0,0 +1,149 @@
+/** @file ticker_test.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Checks the ticker and the token bucket of `ticker.c`.  A ticker must keep its deadlines without drift, and after a
+  stall of a few periods, `TICKER_CATCH_UP` must fire every missed deadline back to back while `TICKER_SKIP` reports
+  them all from one wait.  The token bucket must hand out its burst plus its rate over a fixed window, and a blocking
+  take must wait as long as its tokens take to earn.
+
+ */
+#include <fcio/proto.h>
+
+
+/* Long enough that a slow wakeup on a busy host can't be mistaken for an overrun. */
+#define TICK_PERIOD  (50000000L)
+#define TICK_STALL   ((TICK_PERIOD * 7) / 2)
+#define TICK_COUNT   (10)
+
+/* The rate, burst and length of the window the token bucket is checked over.  The burst is a second worth of tokens,
+ * so a taker that is preempted for a while never loses tokens to a full bucket, and the count only depends on the rate. */
+#define BUCKET_RATE    (1000.0)
+#define BUCKET_BURST   (1000.0)
+#define BUCKET_WINDOW  (500000000L)
+
+
+#define CHECK(expr)                                                       \
+  DO_WHILE(                                                               \
+    if (!(expr)) {                                                        \
+      writeferr("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);  \
+      ++failures;                                                         \
+    }                                                                     \
+  )
+
+
+static int failures = 0;
+
+
+static void sleep_ns(Llong ns) {
+  hiactime_sleep_until_ns(hiactime_now_ns() + ns);
+}
+
+/* ----------------------------- Ticker ----------------------------- */
+
+static void test_ticker_drift(void) {
+  ticker_t t;
+  Llong start = hiactime_now_ns();
+  ticker_init(&t, TICK_PERIOD, TICKER_CATCH_UP);
+  for (int i=0; i<TICK_COUNT; ++i) {
+    CHECK(ticker_wait(&t) == 1);
+  }
+  /* The work between waits and the lateness of every wakeup never add up. */
+  CHECK((hiactime_now_ns() - start) >= (TICK_PERIOD * TICK_COUNT));
+  CHECK((hiactime_now_ns() - start) <  (TICK_PERIOD * (TICK_COUNT + 1)));
+  CHECK(t.ticks == TICK_COUNT);
+  CHECK(t.overruns == 0);
+  CHECK(t.skipped == 0);
+  CHECK(t.jitter_max >= 0 && ticker_jitter_avg_ns(&t) >= 0);
+}
+
+/* Stall for three and a half periods after the first tick, so the deadlines of the second, third and fourth tick are
+ * all past, and the fifth is half a period away. */
+static void test_ticker_catch_up(void) {
+  ticker_t t;
+  Llong start;
+  ticker_init(&t, TICK_PERIOD, TICKER_CATCH_UP);
+  CHECK(ticker_wait(&t) == 1);
+  sleep_ns(TICK_STALL);
+  /* Every missed deadline fires right away, one per wait. */
+  for (int i=0; i<3; ++i) {
+    start = hiactime_now_ns();
+    CHECK(ticker_wait(&t) == 1);
+    CHECK((hiactime_now_ns() - start) < (TICK_PERIOD / 4));
+  }
+  CHECK(t.overruns == 3);
+  /* Then it is back on the original schedule. */
+  start = hiactime_now_ns();
+  CHECK(ticker_wait(&t) == 1);
+  CHECK((hiactime_now_ns() - start) >= (TICK_PERIOD / 4));
+  CHECK(t.ticks == 5);
+  CHECK(t.overruns == 3);
+  CHECK(t.skipped == 0);
+}
+
+static void test_ticker_skip(void) {
+  ticker_t t;
+  Llong start;
+  ticker_init(&t, TICK_PERIOD, TICKER_SKIP);
+  CHECK(ticker_wait(&t) == 1);
+  sleep_ns(TICK_STALL);
+  /* One wait reports all three deadlines that passed. */
+  start = hiactime_now_ns();
+  CHECK(ticker_wait(&t) == 3);
+  CHECK((hiactime_now_ns() - start) < (TICK_PERIOD / 4));
+  CHECK(t.overruns == 1);
+  CHECK(t.skipped == 2);
+  /* And the next one waits for the next deadline still in the future. */
+  start = hiactime_now_ns();
+  CHECK(ticker_wait(&t) == 1);
+  CHECK((hiactime_now_ns() - start) >= (TICK_PERIOD / 4));
+  CHECK(t.ticks == 3);
+  CHECK(t.overruns == 1);
+  CHECK(t.skipped == 2);
+  /* After a reset the stall is forgotten. */
+  sleep_ns(TICK_STALL);
+  ticker_reset(&t);
+  CHECK(ticker_wait(&t) == 1);
+  CHECK(t.overruns == 1);
+}
+
+/* ----------------------------- Token bucket ----------------------------- */
+
+static void test_token_bucket(void) {
+  token_bucket_t tb;
+  Ulong taken = 0;
+  Llong start;
+  Llong elapsed;
+  double expected;
+  token_bucket_init(&tb, BUCKET_RATE, BUCKET_BURST);
+  start = hiactime_now_ns();
+  while ((elapsed = (hiactime_now_ns() - start)) < BUCKET_WINDOW) {
+    taken += token_bucket_try_take(&tb, 1);
+  }
+  expected = (BUCKET_BURST + ((BUCKET_RATE * (double)elapsed) / 1e9));
+  if ((double)taken < (expected - 2) || (double)taken > (expected + 2)) {
+    writeferr("token bucket: took %lu tokens in %ld ns, expected %.1f\n", taken, elapsed, expected);
+    ++failures;
+  }
+  /* The bucket is empty now, so taking a tenth of a second worth of tokens has to wait that long. */
+  CHECK(!token_bucket_try_take(&tb, 2));
+  CHECK(token_bucket_wait_ns(&tb, (BUCKET_RATE / 10)) > 0);
+  start = hiactime_now_ns();
+  token_bucket_take(&tb, (BUCKET_RATE / 10));
+  elapsed = (hiactime_now_ns() - start);
+  CHECK(elapsed >= 98000000 && elapsed < 150000000);
+}
+
+int main(void) {
+  test_ticker_drift();
+  test_ticker_catch_up();
+  test_ticker_skip();
+  test_token_bucket();
+  if (failures) {
+    writeferr("ticker_test: %d failures\n", failures);
+    return 1;
+  }
+  writef("ticker_test: all passed\n");
+  return 0;
+}
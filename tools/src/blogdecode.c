@@ -0,0 +1,26 @@
+/** @file blogdecode.c
+
+  @author  Melwin Svensson.
+  @date    18-10-2026.
+
+  Decode a binary log, written by `fcio_blog_open()` and `FCIO_BLOG()`, into text lines on stdout.
+
+  Usage: blogdecode <log>...
+
+ */
+#include <fcio/proto.h>
+
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    writeferr("Usage: %s <log>...\n", argv[0]);
+    return 1;
+  }
+  for (int i=1; i<argc; ++i) {
+    if (fcio_blog_decode(argv[i], STDOUT_FILENO) == -1) {
+      writeferr("%s: '%s' is not a readable binary log.\n", argv[0], argv[i]);
+      return 1;
+    }
+  }
+  return 0;
+}